@@ -16,6 +16,8 @@
  *  06-15-12   		DS  	network and local calls
  *  09-19-12   		DS  	check if NULL was already defined;
  *							typically in stddef
+ *  10-18-26   		DS  	Linux host headers; Compiler.h spelled as it's
+ *							named, for case sensitive file systems
  *
  *  Copyright (c) 2009 - 2021 Dave Sandler
  *
@@ -67,8 +69,26 @@
 #ifndef	_DTYPES_H
 	#define	_DTYPES_H
 
+	/*
+	 * the host's own headers come first. its timer_t and stack_t
+	 *	are renamed on the way in; pico has types of those names.
+	 */
+	#if defined(LINUX)
+		#ifndef _GNU_SOURCE
+			#define _GNU_SOURCE
+		#endif
+		#define timer_t	posix_timer_t
+		#define stack_t	posix_stack_t
+		#include <pthread.h>
+		#include <sched.h>
+		#include <signal.h>
+		#include <time.h>
+		#include <unistd.h>
+		#undef timer_t
+		#undef stack_t
+	#endif
         #include <stdint.h>
-        #include "compiler.h"
+        #include "Compiler.h"
 	/*
 	 * data scope - 08/12/15; no longer used
 	 *	but preserved for legacy applications
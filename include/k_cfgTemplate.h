@@ -67,6 +67,44 @@
 	 * tcb related stuff
 	 */
 	#define N_TASKS         	8
+	#define OS_N_PRIO			16		/* priority levels, power of 2 up to 256 */
+	#define OS_TMR_SLOTS		32		/* timer wheel slots, power of 2		 */
+	#define OS_TMR_LEVELS		3		/* wheels; beyond SLOTS^LEVELS ticks */
+										/* a timer cascades round the top	 */
+	#define PICO_TICKLESS		0		/* 1: stop the tick while idle. An app	 */
+										/* supplied os_sleep must leave the	 */
+										/* tick timer running, and wake for	 */
+										/* an interrupt while they are off	 */
+	#define PICO_RR				0		/* 1: round-robin within a priority	 */
+	#define OS_RR_QUANTUM		1		/* dispatches (or cycles) per turn	 */
+	#define OS_RR_CYCLES		0		/* 1: quantum counts os_cycle_count()*/
+	#define PICO_EDF			0		/* 1: earliest deadline first class	 */
+	#define OS_EDF_PRIO			8		/* priority level run by deadline	 */
+	#define PICO_PERIODIC		0		/* 1: os_create_periodic_task()		 */
+	#define PICO_SMP			0		/* 1: a scheduler loop per core		 */
+	#define OS_N_CORES			1		/* cores, up to 32 with PICO_SMP	 */
+	#define PICO_STATS			0		/* 1: run time per task, hooks, idle;*/
+										/* the port supplies os_cycle_count()*/
+	#define PICO_TRACE			0		/* 1: event trace ring; picotrace.h	 */
+										/* has OS_TRACE_SIZE and friends	 */
+/*	#define OS_CYCLE_HZ		CPU_CLOCK_HZ */	/* os_cycle_count() rate		 */
+	#define OS_TASK_HASH		0		/* task handle buckets, power of 2;	 */
+										/* 0 scans tcb[]. 256 past 64 tasks	 */
+/*	#define OS_TASK_IDX_T	uint16_t */	/* task table index type. default is */
+										/* the narrowest holding N_TASKS	 */
+	#define PICO_ISR			0		/* 1: interrupt events, os_isr_post()*/
+	#define OS_ISR_EVENTS		32		/* event ids, up to 256; 0 is first	 */
+	#define PICO_NOTIFY			0		/* 1: task notifications, event flags*/
+	#define PICO_ARENA			0		/* 1: task arenas, picopool.c		 */
+/*	#define OS_HEAP_FL_MAX	20 */		/* picoheap.c: the largest block is	 */
+										/* 2^this bytes						 */
+/*	#define OS_HEAP_SL_LOG2	4 */		/* 2^this free lists per power of two*/
+/*	#define OS_HEAP_CHECK	1 */		/* guard words around heap blocks	 */
+/*	#define OS_TICK_FRACTION 1 */		/* the port has os_tick_fraction();	 */
+										/* portable.h sets it for the targets*/
+/*	#define OS_TICK_COUNTS	(CPU_CLOCK_HZ / TICK_RATE_HZ) */
+										/* its counts a tick; os_time_now()	 */
+										/* runs at TICK_RATE_HZ * this		 */
 
 	#define	CPU_CLOCK_HZ		((uint32_t)50000000)
 	#define	TICK_RATE_HZ		((uint32_t) 100)
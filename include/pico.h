@@ -18,6 +18,29 @@
  * 9-06-12			 DS	    os_seconds made persistent
  * 9-21-12			 DS	    unlink UIP from the PIC32 and TCP/IP. simple conditional
  *							build switch
+ * 10-18-26			 DS	    bitmap indexed ready list, configurable priority levels
+ * 10-18-26			 DS	    task timers hold absolute deadlines on a timer wheel
+ * 10-18-26			 DS	    hierarchical timer wheels, OS_TMR_LEVELS
+ * 10-18-26			 DS	    tickless idle
+ * 10-18-26			 DS	    round-robin within a priority level
+ * 10-18-26			 DS	    earliest deadline first scheduling class
+ * 10-18-26			 DS	    periodic tasks with absolute release times
+ * 10-18-26			 DS	    priority ordered wait queues, mutex priority inheritance
+ * 10-18-26			 DS	    SMP; a ready list per core, work stealing, affinity
+ * 10-18-26			 DS	    hook registry; period, phase, priority, enable
+ * 10-18-26			 DS	    O(1) tcb free list, task index type, task handle hash
+ * 10-18-26			 DS	    PICO_STATS; run time per task, hooks and idle
+ * 10-18-26			 DS	    PICO_TRACE event trace ring, os_get_task_index()
+ * 10-18-26			 DS	    os_time_now() 64 bit time base, unit conversions
+ * 10-18-26			 DS	    PICO_ISR events; interrupts hand work to tasks
+ * 10-18-26			 DS	    PICO_NOTIFY task notifications; OS_SYNC_ codes here
+ * 10-18-26			 DS	    PICO_ARENA per task scratch arenas
+ * 10-18-26			 DS	    locks held and waited on, for transitive inheritance
+ * 10-18-26			 DS	    task_ready(); a task on a core is ready by running
+ * 10-18-26			 DS	    inst_link; OS_TASK_HASH chains one task per function
+ * 10-18-26			 DS	    os_pi_t count; locks handed to the first waiter
+ * 10-18-26			 DS	    API change: os_add_hook() takes a t_hook_list_t *,
+ *							and os_release_hook() no longer takes a list
  *
  *  Copyright (c) 2009 - 2021 Dave Sandler
  *
@@ -77,16 +100,139 @@
 	 * tcb related stuff
 	 */
 	#define FOREVER         				while( 1 == 1)
-	#define PRIOMASK						         0x0F
+	#ifndef OS_N_PRIO
+		#define OS_N_PRIO						   16
+	#endif
+	#if ((OS_N_PRIO < 2) || (OS_N_PRIO > 256) || (OS_N_PRIO & (OS_N_PRIO - 1)))
+		#error OS_N_PRIO must be a power of 2 from 2 to 256
+	#endif
+	#define PRIOMASK					(OS_N_PRIO - 1)
 	#define OS_LO_PRIO						     PRIOMASK
-	#define OS_MED_PRIO						            8
+	#define OS_MED_PRIO					(OS_N_PRIO / 2)
 	#define OS_HI_PRIO						            0
+	#define OS_PRIO_WORDS		   ((OS_N_PRIO + 31) / 32)
+	#define OS_HOOK_PRIO						      128
 	#define TCB_FREE						         0x80
 	#define TCB_TIMING						         0x40
 	#define TCB_TIMINGMASK					         0xC0
 	#define TCB_TIMEOUT						         0x20
 	#define TCB_TMRSTAT						         0x60
+	#define TCB_READY						         0x10
+	#define TCB_GPFOREVER					         0x08
+	#define TCB_EDF							         0x04
+	#define TCB_RUN_READY					            1	/* PICO_SMP; on a core, and ready	*/
+	#define TCB_RUN_BLOCKED					            2	/* on a core, and since blocked		*/
+	#ifndef OS_TMR_SLOTS
+		#define OS_TMR_SLOTS					   32
+	#endif
+	#if ((OS_TMR_SLOTS < 2) || (OS_TMR_SLOTS & (OS_TMR_SLOTS - 1)))
+		#error OS_TMR_SLOTS must be a power of 2
+	#endif
+	#define OS_TMR_MASK				(OS_TMR_SLOTS - 1)
+	#if (OS_TMR_SLOTS > 1024)
+		#error OS_TMR_SLOTS is at most 1024
+	#endif
+	#define OS_TMR_BITS				((OS_TMR_SLOTS >= 1024) ? 10 : (OS_TMR_SLOTS >= 512) ? 9 : \
+									 (OS_TMR_SLOTS >= 256) ? 8 : (OS_TMR_SLOTS >= 128) ? 7 : \
+									 (OS_TMR_SLOTS >= 64) ? 6 : (OS_TMR_SLOTS >= 32) ? 5 : \
+									 (OS_TMR_SLOTS >= 16) ? 4 : (OS_TMR_SLOTS >= 8) ? 3 : \
+									 (OS_TMR_SLOTS >= 4) ? 2 : 1)
+	/*
+	 * wheels of OS_TMR_SLOTS slots each. a slot of wheel n spans
+	 *	OS_TMR_SLOTS^n ticks, and is cascaded onto the wheels below as
+	 *	its ticks come round.
+	 */
+	#ifndef OS_TMR_LEVELS
+		#define OS_TMR_LEVELS					    3
+	#endif
+	#if ((OS_TMR_LEVELS < 2) || (OS_TMR_LEVELS > 8))
+		#error OS_TMR_LEVELS must be 2 to 8
+	#endif
+	#ifndef PICO_TICKLESS
+		#define PICO_TICKLESS						0
+	#endif
+	#ifndef PICO_RR
+		#define PICO_RR								0
+	#endif
+	#ifndef OS_RR_QUANTUM
+		#define OS_RR_QUANTUM						1
+	#endif
+	#ifndef OS_RR_CYCLES
+		#define OS_RR_CYCLES						0
+	#endif
+	#ifndef PICO_EDF
+		#define PICO_EDF							0
+	#endif
+	#ifndef OS_EDF_PRIO
+		#define OS_EDF_PRIO					  OS_MED_PRIO
+	#endif
+	#ifndef PICO_PERIODIC
+		#define PICO_PERIODIC						0
+	#endif
+	#ifndef PICO_SMP
+		#define PICO_SMP							0
+	#endif
+	#ifndef OS_N_CORES
+		#define OS_N_CORES							1
+	#endif
+	#if ((OS_N_CORES < 1) || (OS_N_CORES > 32) || (!PICO_SMP && (OS_N_CORES != 1)))
+		#error OS_N_CORES must be 1, or up to 32 with PICO_SMP
+	#endif
+	#if (PICO_SMP && PICO_TICKLESS)
+		#error PICO_TICKLESS is not supported with PICO_SMP
+	#endif
+	#define OS_CORE_ALL	(0xFFFFFFFFUL >> (32 - OS_N_CORES))
+	#ifndef PICO_STATS
+		#define PICO_STATS							0
+	#endif
+	#ifndef PICO_TRACE
+		#define PICO_TRACE							0
+	#endif
+	#define OS_CYCLE_COUNT	(PICO_STATS || PICO_TRACE || (PICO_RR && OS_RR_CYCLES))
+	#ifndef OS_CYCLE_HZ
+		#define OS_CYCLE_HZ				 CPU_CLOCK_HZ
+	#endif
+	#ifndef PICO_ISR
+		#define PICO_ISR							0
+	#endif
+	#ifndef OS_ISR_EVENTS
+		#define OS_ISR_EVENTS					   32
+	#endif
+	#if ((OS_ISR_EVENTS < 1) || (OS_ISR_EVENTS > 256))
+		#error OS_ISR_EVENTS must be 1 to 256
+	#endif
+	#define OS_ISR_WORDS		((OS_ISR_EVENTS + 31) / 32)
+	#ifndef PICO_NOTIFY
+		#define PICO_NOTIFY							0
+	#endif
+	#ifndef PICO_ARENA
+		#define PICO_ARENA							0
+	#endif
+	#ifndef OS_TICK_FRACTION
+		#define OS_TICK_FRACTION					0
+	#endif
+	#ifndef OS_TICK_COUNTS
+		#define OS_TICK_COUNTS						1
+	#endif
+	#if (N_TASKS < 1)
+		#error N_TASKS must be at least 1
+	#endif
+	#ifndef OS_TASK_HASH
+		#if (N_TASKS > 64)
+			#define OS_TASK_HASH				  256
+		#else
+			#define OS_TASK_HASH					0
+		#endif
+	#endif
+	#if (OS_TASK_HASH & (OS_TASK_HASH - 1))
+		#error OS_TASK_HASH must be 0 or a power of 2
+	#endif
+	#if (PICO_EDF && (OS_EDF_PRIO > PRIOMASK))
+		#error OS_EDF_PRIO must be a priority level below OS_N_PRIO
+	#endif
 	#define TCB_NULL_ENV							 0xFF
+	#define TCB_NOTIFY_PENDING						 0x01
+	#define TCB_NOTIFY_WAITING						 0x02
 
 	#define	ME				                  current_task
 	#define	NO_TIMEOUT		                 ((timer_t)-1)
@@ -96,9 +242,41 @@
 	#define SYSTICKHZ                        TICK_RATE_HZ
 	#define SYSTICKMIN                   (60*TICK_RATE_HZ)
 	#define SYSTICKHR                  (3600*TICK_RATE_HZ)
-	#define SYSTICKMS       		    (SYSTICKHZ / 1000)
-	#define SYSTICKUS        		 (SYSTICKHZ / 1000000)
-	#define SYSTICKNS        	  (SYSTICKHZ / 1000000000)
+	#define TICK_MAX_DELAY		((timer_t)0x7FFFFFFFUL)
+	/*
+	 * return codes of the calls a wait macro makes
+	 */
+	#define OS_SYNC_OK			0
+	#define OS_SYNC_WAIT		1
+	#define OS_SYNC_TIMEOUT		2
+	#define OS_SYNC_ERR			3
+	/*
+	 * unit conversions, done by the compiler for a constant. Ticks
+	 *	round up, so a delay is never short.
+	 */
+	#define os_ms_to_ticks(ms)	((timer_t)(((uint64_t)(ms) * SYSTICKHZ + 999UL) / 1000UL))
+	#define os_us_to_ticks(us)	((timer_t)(((uint64_t)(us) * SYSTICKHZ + 999999UL) / 1000000UL))
+	#define os_ticks_to_ms(t)	((uint32_t)((uint64_t)(t) * 1000UL / SYSTICKHZ))
+	/*
+	 * os_time_t counts OS_TIME_HZ; OS_TICK_COUNTS of the port's
+	 *	sub-tick counter a tick. os_time_scale() takes x * num / den
+	 *	in two parts so the product can't overflow.
+	 */
+	#define OS_TIME_HZ		((uint64_t)SYSTICKHZ * OS_TICK_COUNTS)
+	#define os_time_scale(x, num, den) \
+		(((x) / (den)) * (num) + ((x) % (den)) * (num) / (den))
+	#define os_time_from_ticks(t)	((os_time_t)(t) * OS_TICK_COUNTS)
+	#define os_time_from_ms(ms)	os_time_scale((os_time_t)(ms), OS_TIME_HZ, 1000ULL)
+	#define os_time_from_us(us)	os_time_scale((os_time_t)(us), OS_TIME_HZ, 1000000ULL)
+	#define os_time_from_ns(ns)	os_time_scale((os_time_t)(ns), OS_TIME_HZ, 1000000000ULL)
+	#define os_time_to_ticks(t)	((os_time_t)(t) / OS_TICK_COUNTS)
+	#define os_time_to_ms(t)	os_time_scale((os_time_t)(t), 1000ULL, OS_TIME_HZ)
+	#define os_time_to_us(t)	os_time_scale((os_time_t)(t), 1000000ULL, OS_TIME_HZ)
+	#define os_time_to_ns(t)	os_time_scale((os_time_t)(t), 1000000000ULL, OS_TIME_HZ)
+	/*
+	 * wrap safe test of tick count 'now' against deadline 'd'
+	 */
+	#define tick_reached(now, d)	(0 == ((timer_t)((now) - (d)) & 0x80000000UL))
 	/*
 	 * data types
 	 */
@@ -107,12 +285,26 @@
 	#define register
 
 	typedef uint32_t timer_t;
+	typedef uint64_t os_time_t;
 
 	typedef uint8_t  s_link_t;
 	typedef uint32_t stack_t;
 
 	typedef	uint8_t os_error;
 
+	/*
+	 * index into the task table; wide enough to count to N_TASKS
+	 */
+	#if defined(OS_TASK_IDX_T)
+		typedef OS_TASK_IDX_T os_task_idx_t;
+	#elif (N_TASKS < 0x100)
+		typedef uint8_t  os_task_idx_t;
+	#elif (N_TASKS < 0x10000UL)
+		typedef uint16_t os_task_idx_t;
+	#else
+		typedef uint32_t os_task_idx_t;
+	#endif
+
 	typedef struct link
 	{
 	    struct link OS_DATA *next;
@@ -130,6 +322,21 @@
 	    s_link_t	tail;
 	} k_queue_t;
 
+	/*
+	 * the ready list is one FIFO per priority level. a set bit in
+	 *	prio_map marks a non-empty level, MSB first, so a count of
+	 *	leading zeros yields the highest ready priority. past 32
+	 *	levels, grp_map marks the non-empty prio_map words.
+	 */
+	typedef struct
+	{
+	#if (OS_N_PRIO > 32)
+	    uint32_t	grp_map;
+	#endif
+	    uint32_t	prio_map[OS_PRIO_WORDS];
+	    k_list_t	band[OS_N_PRIO];
+	} k_ready_t;
+
 	#define Q_NULL  (k_list_t *)0
 	#define SL_NULL (k_slist_t *)0
 	#define sl_NULL (s_link_t)-1;
@@ -139,20 +346,140 @@
 	typedef struct
 	{
 	    k_list_t tcb_link;
+	    k_list_t tmr_link;
 	    timer_t  timer;
 	    timer_t  gptimer;
 	    uint8_t  flags;
+	    uint8_t  prio;
+	    uint8_t  base_prio;
 	    uint8_t  task_env;
+	    uint8_t  tmr_level;					/* wheel tmr_link is on				*/
+	    struct os_pi_s *pi_held;			/* mutexes and write locks held		*/
+	    struct os_pi_s *pi_wait;			/* the one it waits for				*/
+	    k_list_t *pi_queue;					/* and the queue it waits on		*/
+	#if (PICO_NOTIFY)
+	    uint8_t  notify_state;				/* TCB_NOTIFY_ bits					*/
+	    uint8_t  wait_mode;					/* os_flags_wait() mode				*/
+	    uint32_t notify;					/* notification value				*/
+	    uint32_t wait_bits;					/* flags waited for, then got		*/
+	#endif
+	#if (PICO_ARENA)
+	    struct os_pool_s *arena_pool;		/* where its arena comes from		*/
+	    uint8_t *arena;						/* a block of it, while in use		*/
+	    uint16_t arena_used;
+	    uint16_t arena_peak;
+	#endif
+	#if (PICO_EDF)
+	    timer_t  deadline;
+	    timer_t  rel_deadline;
+	    uint16_t dl_miss;
+	#endif
+	#if (PICO_PERIODIC)
+	    timer_t  period;
+	    timer_t  release;
+	    timer_t  jitter;
+	    timer_t  jitter_max;
+	    uint16_t overruns;
+	#endif
+	#if (PICO_SMP)
+	    uint8_t  core;
+	    volatile uint8_t running;
+	    uint32_t affinity;
+	#endif
+	#if (PICO_STATS)
+	    uint64_t run_cycles;				/* os_cycle_count() units			*/
+	    uint32_t run_max;					/* longest single dispatch			*/
+	    uint32_t run_count;					/* dispatches						*/
+	#endif
+	#if (PICO_RR)
+	#if (OS_RR_CYCLES)
+	    uint32_t rr_used;
+	#else
+	    uint16_t rr_used;
+	#endif
+	#endif
 	    tcb_pt_t tcbpt;
 	    int      ( *p_thread )( tcb_pt_t * );
+	#if (OS_TASK_HASH)
+	    k_list_t hash_link;					/* oldest task of each p_thread		*/
+	    k_list_t inst_link;					/* the rest, behind the oldest		*/
+	#endif
 	} tcb_entry_t;
 
+	/*
+	 * what priority inheritance needs of a mutex or a write lock:
+	 *	its waiters, in priority order, its owner, and a link on the
+	 *	owner's list of the locks it holds. a reader/writer lock's
+	 *	readers wait on a queue of their own. a lock let go of is
+	 *	handed to the first waiter, which owns it with a count of 0
+	 *	until it runs and takes it.
+	 */
+	typedef struct os_pi_s
+	{
+	    k_list_t        wait;
+	    k_list_t       *rd_wait;			/* a rwlock's readers; NULL for a mutex	*/
+	    tcb_entry_t    *owner;				/* NULL while no one task holds it	*/
+	    struct os_pi_s *next;				/* the owner's next held lock		*/
+	    uint8_t         count;				/* takes by the owner				*/
+	} os_pi_t;
+
+	/*
+	 * where a core's scheduler loop spends its time, in os_cycle_count()
+	 *	units. timer_hooks run in the tick interrupt, so their time is
+	 *	also counted in whatever they interrupted, and kept on core 0.
+	 */
+	typedef struct
+	{
+	    uint64_t   tasks;					/* running tasks					*/
+	    uint64_t   timers;					/* in service_os_timers()			*/
+	    uint64_t   loop_hooks;
+	    uint64_t   timer_hooks;
+	    uint64_t   idle;					/* passes with nothing to run		*/
+	    uint32_t   passes;
+	    uint32_t   last;					/* count at the last lap taken		*/
+	} os_stats_t;
+
 	typedef struct
 	{
-	    k_slist_t  t_hook_link;
+	    k_list_t   t_hook_link;				/* by due call, then priority		*/
 	    void     ( *p_timerhook )( void );
+	    timer_t    due;						/* list call the hook runs on next	*/
+	    uint16_t   period;					/* calls between invocations		*/
+	    uint8_t    prio;					/* lowest first among hooks due		*/
+	    uint8_t    enabled;
 	} t_hook_entry_t;
 
+	typedef struct
+	{
+	    k_list_t   hooks;
+	    timer_t    count;					/* calls of os_hook_handler()		*/
+	} t_hook_list_t;
+
+	#if (PICO_ISR)
+	/*
+	 * interrupt events. An interrupt sets the event's bit in map,
+	 *	MSB first like the ready list, and the scheduler loop takes
+	 *	each word whole. Past 32 events grp marks the words set.
+	 */
+	typedef void (*os_isr_fn)( uint8_t, uint32_t );
+	typedef struct
+	{
+	    k_list_t	wait;					/* tasks in os_isr_wait()			*/
+	    os_isr_fn	fn;						/* run by the loop, if bound		*/
+	    uint32_t volatile arg;				/* the last one posted				*/
+	    uint8_t		pending;				/* taken by os_isr_take()			*/
+	} os_isr_t;
+
+	typedef struct
+	{
+	#if (OS_ISR_EVENTS > 32)
+	    uint32_t volatile grp;
+	#endif
+	    uint32_t volatile map[OS_ISR_WORDS];
+	    os_isr_t	ev[OS_ISR_EVENTS];
+	} k_isr_t;
+	#endif
+
 	#ifdef USES_UIP
 		#include "uip.h"
 		#define UIP_TIMER_MS           500
@@ -210,36 +537,164 @@
 	_SCOPE_ tcb_entry_t *os_get_tcb( void );
 	_SCOPE_ void 	     os_release_tcb( tcb_entry_t * );
 	_SCOPE_ tcb_entry_t *os_get_task_handle(int (*)(tcb_pt_t *));
+	_SCOPE_ os_task_idx_t os_get_task_index( tcb_entry_t * );
+	#if (PICO_EDF)
+		_SCOPE_ tcb_entry_t *os_create_edf_task( uint8_t, int ( *)(tcb_pt_t *), timer_t );
+		#define			 get_deadline_misses( t )	t->dl_miss
+	#endif
+	#if (PICO_PERIODIC)
+		_SCOPE_ tcb_entry_t *os_create_periodic_task( uint8_t, uint8_t, int ( *)(tcb_pt_t *), timer_t, timer_t );
+		_SCOPE_ void		 os_wait_next_period( tcb_entry_t * );
+		_SCOPE_ void		 os_period_started( tcb_entry_t * );
+		#define			 get_release_jitter( t )	t->jitter
+		#define			 get_max_jitter( t )		t->jitter_max
+		#define			 get_overruns( t )			t->overruns
+	#endif
 
 	#define				 os_suspend( q )	os_suspend_task( q, (k_list_t *)ME )
+	#if (PICO_NOTIFY)
+		/*
+		 * task notifications. os_notify() acts on a task's value
+		 *	and wakes the task if it's waiting in PT_WAIT_NOTIFY().
+		 */
+		#define OS_NOTIFY_BITS						0	/* or the value in				*/
+		#define OS_NOTIFY_INC						1	/* add one; the value is unused	*/
+		#define OS_NOTIFY_WRITE						2	/* overwrite					*/
+		#define OS_NOTIFY_WRITE_NEW					3	/* write if the last was taken	*/
+		_SCOPE_ uint8_t		 os_notify( tcb_entry_t *, uint32_t, uint8_t );
+		_SCOPE_ uint8_t		 os_notify_take( uint32_t *, uint32_t, timer_t );
+		/*
+		 * void PT_WAIT_NOTIFY(pt,value,clear,timeout)
+		 *	wait for a notification. on return, unless
+		 *	task_timer_expired(ME), *value (if not NULL) has the
+		 *	value, and the bits in clear are cleared from it.
+		 */
+		#define PT_WAIT_NOTIFY(pt, value, clear, timeout)		\
+		    do													\
+		    {													\
+		        ME->flags &= ~TCB_TIMEOUT;						\
+		        LC_SET((pt)->lc);								\
+		        if (OS_SYNC_WAIT == os_notify_take(value, clear, timeout))	\
+		        {												\
+		            return PT_WAITING;							\
+		        }												\
+		    } while (0)
+	#endif
+	#if (PICO_ISR)
+		/*
+		 * interrupt events. An interrupt posts an event, and the
+		 *	scheduler loop hands it to its task; see os_isr_post().
+		 */
+		_SCOPE_ void		 os_isr_post( uint8_t, uint32_t );
+		_SCOPE_ void		 os_isr_bind( uint8_t, os_isr_fn );
+		_SCOPE_ uint8_t		 os_isr_take( uint8_t, timer_t );
+		_SCOPE_ uint32_t	 os_isr_arg( uint8_t );
+		/*
+		 * void os_isr_wait(pt,id,timeout)
+		 *	wait for the event. on return it has happened, unless
+		 *	task_timer_expired(ME).
+		 */
+		#define os_isr_wait(pt, id, timeout)					\
+		    do													\
+		    {													\
+		        ME->flags &= ~TCB_TIMEOUT;						\
+		        LC_SET((pt)->lc);								\
+		        if (OS_SYNC_WAIT == os_isr_take(id, timeout))	\
+		        {												\
+		            return PT_WAITING;							\
+		        }												\
+		    } while (0)
+	#endif
+	_SCOPE_ void		 os_wait_prio( k_list_t *, tcb_entry_t *, timer_t );
+	_SCOPE_ tcb_entry_t *os_wake_first( k_list_t * );
+	_SCOPE_ void		 os_wake_all( k_list_t * );
+	_SCOPE_ void		 os_set_task_prio( tcb_entry_t *, uint8_t );
+	_SCOPE_ void		 os_pi_reprio( tcb_entry_t * );
+	_SCOPE_ void		 os_pi_acquire( tcb_entry_t *, os_pi_t * );
+	_SCOPE_ void		 os_pi_release( tcb_entry_t *, os_pi_t * );
+	_SCOPE_ void		 os_pi_handoff( os_pi_t * );
+	#if (PICO_SMP)
+		_SCOPE_ void	 os_start_sched_core( uint8_t );
+		_SCOPE_ void	 os_set_task_affinity( tcb_entry_t *, uint32_t );
+		#define			 gettask_core( t )		t->core
+		/*
+		 * supplied by the port. the kernel lock must be recursive.
+		 */
+		extern  uint8_t	 os_core_id( void );
+		extern  void	 os_kernel_lock( void );
+		extern  void	 os_kernel_unlock( void );
+		extern  void	 os_core_lock( uint8_t );
+		extern  void	 os_core_unlock( uint8_t );
+		extern  void	 os_start_cores( void );
+		extern  void	 os_core_idle( uint8_t );
+		#define			 K_LOCK()				os_kernel_lock()
+		#define			 K_UNLOCK()				os_kernel_unlock()
+	#else
+		#define			 K_LOCK()
+		#define			 K_UNLOCK()
+	#endif
+	#if (PICO_STATS)
+		_SCOPE_ os_stats_t *os_get_stats( uint8_t );
+		_SCOPE_ void	 os_stats_reset( void );
+		#define			 gettask_cycles( t )	t->run_cycles
+		#define			 gettask_max( t )		t->run_max
+		#define			 gettask_runs( t )		t->run_count
+	#endif
 	_SCOPE_ void		 os_add_timerhook( t_hook_entry_t *, void ( *)(void));
 	_SCOPE_ void		 os_add_schedhook( t_hook_entry_t *, void ( *)(void));
-	_SCOPE_ void		 os_hook_handler(t_hook_entry_t *);
+	_SCOPE_ void		 os_add_timerhook_rate( t_hook_entry_t *, void ( *)(void), uint16_t, uint16_t, uint8_t );
+	_SCOPE_ void		 os_add_schedhook_rate( t_hook_entry_t *, void ( *)(void), uint16_t, uint16_t, uint8_t );
+	_SCOPE_ void		 os_hook_handler( t_hook_list_t * );
 	_SCOPE_ void		 os_release_timerhook( t_hook_entry_t *);
 	_SCOPE_ void		 os_release_schedhook( t_hook_entry_t *);
-	_SCOPE_ void		 os_add_hook( t_hook_entry_t *, t_hook_entry_t *, void ( *)(void));
-	_SCOPE_ void		 os_release_hook( t_hook_entry_t *, t_hook_entry_t *);
+	_SCOPE_ void		 os_add_hook( t_hook_list_t *, t_hook_entry_t *, void ( *)(void));
+	_SCOPE_ void		 os_add_hook_rate( t_hook_list_t *, t_hook_entry_t *, void ( *)(void),
+										   uint16_t, uint16_t, uint8_t );
+	_SCOPE_ void		 os_release_hook( t_hook_entry_t * );
+	_SCOPE_ void		 os_enable_hook( t_hook_entry_t * );
+	_SCOPE_ void		 os_disable_hook( t_hook_entry_t * );
 	/*
 	 *	Timing related API services
 	 */
 	_SCOPE_ void	os_delay( tcb_entry_t *, timer_t );
-	#define			get_task_timer( t )		t->timer
+	_SCOPE_ void	os_start_task_timer( tcb_entry_t * );
+	_SCOPE_ void	os_stop_task_timer( tcb_entry_t * );
+	_SCOPE_ void	os_set_gptimer( tcb_entry_t *, timer_t );
+	#define			get_task_timer( t )		(timer_t)(t->timer - current_tick)
 	#define			set_task_timer( t, d )	t->timer = d
-	#define start_task_timer(t) \
-		t->flags |= TCB_TIMING; \
-		t->flags &= ~TCB_TIMEOUT
+	#define			start_task_timer(t)		os_start_task_timer(t)
 	#define			get_timer_status( t )	(t->timer & TCB_TMRSTAT)
 	#define			get_os_ticks( )			current_tick
 	#define			task_timer_expired(t)	(0 != (t->flags & TCB_TIMEOUT))
-	#define			setgptimer( t, d )	    t->gptimer = d
-	#define			gp_timer_expired(t)	    (0 ==  t->gptimer)
+	#define			setgptimer( t, d )	    os_set_gptimer(t, d)
+	#define gp_timer_expired(t) \
+		((0 == (t->flags & TCB_GPFOREVER)) && tick_reached(current_tick, t->gptimer))
 	#define			gettask_env( t )		t->task_env
+	#define			gettask_prio( t )		t->prio
+	#if (PICO_SMP)
+		#define		task_ready( t ) \
+			((TCB_READY == (t->flags & TCB_READY)) || (TCB_RUN_READY == t->running))
+	#else
+		#define		task_ready( t )			(TCB_READY == (t->flags & TCB_READY))
+	#endif
 	/*
 	 * low-level functions
 	 */
 	_SCOPE_ void	    os_init( void );
 	_SCOPE_ void 	    service_os_timers( void );
 	_SCOPE_ void        os_timerHook( void );
+	#if (PICO_TICKLESS)
+		_SCOPE_ void    os_tick_catchup( timer_t );
+		extern  timer_t os_tick_oneshot( timer_t );
+		extern  timer_t os_tick_periodic( void );
+	#endif
+	#if (OS_CYCLE_COUNT)
+		extern  uint32_t os_cycle_count( void );
+	#endif
+	#if (OS_TICK_FRACTION)
+		extern  os_time_t os_tick_fraction( void );
+	#endif
+	_SCOPE_ os_time_t	os_time_now( void );
 	_SCOPE_ void        os_delay_ms( uint16_t );
 	_SCOPE_ void        os_delay_us( uint32_t );
 	_SCOPE_ void        os_tick_delay( uint16_t );
@@ -251,12 +706,29 @@
 	_SCOPE_ void 	    kq_slinsert( k_slist_t *, k_slist_t * );
 	_SCOPE_ k_slist_t  *kq_sldelete( k_slist_t * );
 	_SCOPE_ void        kq_slndelete( k_slist_t *, k_slist_t * );
+	_SCOPE_ void 	    kq_qinsert_safe( k_list_t *, k_list_t * );
+	_SCOPE_ void        kq_ndelete_safe( k_list_t * );
 	_SCOPE_ uint16_t   calc_fletcher16(uint8_t const *buf, uint16_t len);
+	#ifndef os_clz32
+		_SCOPE_ uint8_t    os_clz32( uint32_t );
+	#endif
+	#ifndef os_atomic_or32
+		_SCOPE_ void	   os_atomic_or32( uint32_t volatile *, uint32_t );
+	#endif
+	#ifndef os_atomic_xchg32
+		_SCOPE_ uint32_t   os_atomic_xchg32( uint32_t volatile *, uint32_t );
+	#endif
 
 	/*
 	 *	kernel data, ...
 	 */
-	_SCOPE_ tcb_entry_t	*current_task;
+	#if (PICO_SMP)
+		_SCOPE_ tcb_entry_t	*k_current[OS_N_CORES];
+		_SCOPE_ uint8_t		 os_n_cores;
+		#define				 current_task	k_current[os_core_id()]
+	#else
+		_SCOPE_ tcb_entry_t	*current_task;
+	#endif
 	_SCOPE_ timer_t	volatile current_tick;
 	_SCOPE_	uint32_t	 os_seconds;
 	/*
@@ -0,0 +1,110 @@
+/********************************************************************
+ * 	DESC
+ *
+ *  MODULE NAME:	picocque.h
+ *
+ *  AUTHOR:        	Dave Sandler
+ *
+ *  DESCRIPTION:    This header file contains prototypes and variables
+ *                  	that require a scope outside of the home .C module.
+ *
+ *
+ *  EDIT HISTORY:
+ *  DATE    VERSION  INIT   DESCRIPTION OF CHANGE
+ *  ------  -------  ----   ----------------------
+ * 10-18-26			 DS	    Creation. split out of picosem.c
+ *
+ *  Copyright (c) 2009 - 2021 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License 
+ *  as published by the Free Software Foundation, either version 3 
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contiki-OS protothreads license:
+ *  Copyright (c) 2004-2005, Swedish Institute of Computer Science.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the Institute nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ *  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *  OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *  HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *******************************************************************/
+
+#ifndef	_PICOCQ_H
+	#define	_PICOCQ_H
+	#include "pico.h"
+	#include "picoque.h"
+
+	#ifndef FALSE
+		#define FALSE	0
+	#endif
+
+	typedef uint16_t cq_size_t;
+	typedef uint8_t  cq_type_t;
+
+	/*
+	 * data types. a circular queue that overwrites its oldest item
+	 *	once full.
+	 */
+	typedef struct
+	{
+	    cq_size_t  qsize;
+	    cq_size_t  head;
+	    cq_size_t  tail;
+	    cq_type_t *buff;
+	    uint8_t    isfull;
+	} os_cqueue_t;
+
+	/*
+	 ********************************************************************
+	 *
+	 *   routines exposed by this module
+	 */
+	#ifdef PICOCQ_C
+		#define _SCOPE_ 	/**/
+	#else
+		#define _SCOPE_ extern	/**/
+	#endif
+
+	_SCOPE_ void     os_cque_init(os_cqueue_t *, cq_size_t, uint8_t *);
+	_SCOPE_ uint8_t  os_cque_add(os_cqueue_t *, cq_type_t *);
+	_SCOPE_ uint8_t  os_cque_remove(os_cqueue_t *, cq_type_t *);
+	_SCOPE_ uint8_t  os_cque_peek(os_cqueue_t *, cq_type_t *);
+	_SCOPE_ void     os_cque_flush(os_cqueue_t *);
+	#define		     os_cque_empty(cq)	(!(cq)->isfull && ((cq)->head == (cq)->tail))
+	#define		     os_cque_full(cq)	((cq)->isfull)
+	#undef _SCOPE_
+#endif
+/*
+ ********************************************************/
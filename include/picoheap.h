@@ -0,0 +1,168 @@
+/********************************************************************
+ * 	DESC
+ *
+ *  MODULE NAME:	picoheap.h
+ *
+ *  AUTHOR:        	Dave Sandler
+ *
+ *  DESCRIPTION:    This header file contains prototypes and variables
+ *                  	that require a scope outside of the home .C module.
+ *
+ *
+ *  EDIT HISTORY:
+ *  DATE    VERSION  INIT   DESCRIPTION OF CHANGE
+ *  ------  -------  ----   ----------------------
+ * 10-18-26			 DS	    Creation. two level segregated fit heaps
+ * 10-18-26			 DS	    the largest size os_heap_alloc() serves
+ *
+ *  Copyright (c) 2009 - 2021 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License 
+ *  as published by the Free Software Foundation, either version 3 
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contiki-OS protothreads license:
+ *  Copyright (c) 2004-2005, Swedish Institute of Computer Science.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the Institute nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ *  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *  OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *  HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *******************************************************************/
+
+#ifndef	_PICOHEAP_H
+	#define	_PICOHEAP_H
+	#include "pico.h"
+
+	/*
+	 * a free block of size bytes is kept on one of OS_HEAP_SL lists
+	 *	for its power of two. OS_HEAP_FL_MAX bounds the largest block,
+	 *	at 2^OS_HEAP_FL_MAX bytes; a bigger region is added in parts.
+	 *	os_heap_alloc() serves up to 2^OS_HEAP_FL_MAX - OS_HEAP_ALIGN
+	 *	bytes, in fixed time but for the top 1/OS_HEAP_SL of that,
+	 *	which searches the last list.
+	 *	OS_HEAP_CHECK puts guard words around each block allocated.
+	 */
+	#ifndef OS_HEAP_SL_LOG2
+		#define OS_HEAP_SL_LOG2					4
+	#endif
+	#ifndef OS_HEAP_FL_MAX
+		#define OS_HEAP_FL_MAX					20
+	#endif
+	#ifndef OS_HEAP_CHECK
+		#define OS_HEAP_CHECK					0
+	#endif
+
+	#if defined(BYTE_ALIGNMENT) && (BYTE_ALIGNMENT >= 16)
+		#define OS_HEAP_ALIGN_LOG2				4
+	#elif defined(BYTE_ALIGNMENT) && (BYTE_ALIGNMENT >= 8)
+		#define OS_HEAP_ALIGN_LOG2				3
+	#else
+		#define OS_HEAP_ALIGN_LOG2				2
+	#endif
+	#define OS_HEAP_ALIGN						(1UL << OS_HEAP_ALIGN_LOG2)
+	#define OS_HEAP_SL							(1U << OS_HEAP_SL_LOG2)
+	#define OS_HEAP_FL							(OS_HEAP_FL_MAX - OS_HEAP_SL_LOG2 - OS_HEAP_ALIGN_LOG2 + 1)
+	#if (OS_HEAP_SL_LOG2 > 5) || (OS_HEAP_FL_MAX > 31) || (OS_HEAP_FL < 1) || (OS_HEAP_FL > 32)
+		#error OS_HEAP_SL_LOG2 or OS_HEAP_FL_MAX out of range
+	#endif
+
+	/*
+	 * data types. a block's header is in front of what's allocated;
+	 *	the size is of what follows it, with two flags in its low
+	 *	bits. prev_phys is good while the block in front is free.
+	 */
+	typedef struct k_heap_blk_s
+	{
+	    struct k_heap_blk_s *prev_phys;
+	    uint32_t             size;
+	#if (OS_HEAP_CHECK)
+	    uint32_t             guard;
+	    uint32_t             asked;		/* bytes asked for; the tail guard follows */
+	#endif
+	} k_heap_blk_t;
+
+	typedef struct
+	{
+	    uint32_t      fl_map;			/* lists in use, per power of two	*/
+	    uint32_t      sl_map[OS_HEAP_FL];
+	    k_heap_blk_t *free[OS_HEAP_FL][OS_HEAP_SL];
+	    void         *regions;
+	    uint32_t      size;				/* bytes in blocks, all regions		*/
+	    uint32_t      used;				/* bytes allocated now				*/
+	    uint32_t      peak;				/* the most ever allocated at once	*/
+	    uint16_t      failed;			/* allocations that found no block	*/
+	    uint16_t      corrupt;			/* frees refused; bad guards, twice */
+	} os_heap_t;
+
+	/*
+	 * os_heap_stats() walks the heap for these. frag is the percent
+	 *	of the free bytes outside the largest free block.
+	 */
+	typedef struct
+	{
+	    uint32_t size;
+	    uint32_t used;
+	    uint32_t peak;
+	    uint32_t free;
+	    uint32_t largest;
+	    uint16_t used_blocks;
+	    uint16_t free_blocks;
+	    uint16_t failed;
+	    uint16_t corrupt;
+	    uint8_t  frag;
+	} os_heap_stats_t;
+
+	/*
+	 ********************************************************************
+	 *
+	 *   routines exposed by this module
+	 */
+	#ifdef PICOHEAP_C
+		#define _SCOPE_ 	/**/
+	#else
+		#define _SCOPE_ extern	/**/
+	#endif
+
+	_SCOPE_ void     os_heap_init(os_heap_t *);
+	_SCOPE_ uint32_t os_heap_add(os_heap_t *, void *, uint32_t);
+	_SCOPE_ void    *os_heap_alloc(os_heap_t *, uint32_t);
+	_SCOPE_ uint8_t  os_heap_free(os_heap_t *, void *);
+	_SCOPE_ void     os_heap_stats(os_heap_t *, os_heap_stats_t *);
+	_SCOPE_ uint16_t os_heap_check(os_heap_t *);
+	#undef _SCOPE_
+#endif
+/*
+ ********************************************************/
@@ -13,6 +13,11 @@
  *  DATE    VERSION  INIT   DESCRIPTION OF CHANGE
  *  ------  -------  ----   ----------------------
  *	09-28-12 		DAS		modified to use protothreads
+ *	10-18-26 		DS		os_msg_receive fixed, with a timeout; message
+ *							pools, and replies
+ *	10-18-26 		DS		priority mailboxes; mailbox limits with a
+ *							drop policy
+ *	10-18-26 		DS		OS_MBOX_LEVELS
  *
  *  Copyright (c) 2009 - 2021 Dave Sandler
  *
@@ -67,17 +72,64 @@
 	#include "pico.h"
 	#include "picosem.h"
 
+	typedef struct os_mail_s os_mail_t;
+	typedef struct os_msg_pool_s os_msg_pool_t;
+
+	/*
+	 * a message. the buffer at message goes with it; the sender
+	 *	gives it up on os_msg_send(), and the receiver owns it until
+	 *	it replies or frees it. nothing is copied.
+	 */
 	typedef struct
 	{
-	    k_list_t msg_list;
-	    uint8_t  *message;
+	    k_list_t       msg_list;
+	    uint8_t       *message;
+	    os_mail_t     *reply;			/* where an answer goes, or OS_NO_REPLY	*/
+	    os_msg_pool_t *pool;			/* where it's freed to; 0 if not pooled	*/
+	    uint16_t       length;			/* bytes used in message				*/
+	    uint8_t        prio;			/* 0 is most urgent; see os_mbox_init_prio */
 	} os_msg_t;
 
-	typedef struct
+	/*
+	 * a mailbox. messages queue first in, first out; receivers wait
+	 *	in priority order, and the first is woken by a send. a
+	 *	priority mailbox keeps a queue for each message priority,
+	 *	and a bitmap of the ones in use, like the ready list.
+	 */
+	#define OS_MBOX_LEVELS			32	/* most priorities, one per prio_map bit */
+
+	struct os_mail_s
 	{
-	    k_list_t msg_queue;
-	    os_sem_t mbox_sem;
-	} os_mail_t;
+	    k_list_t  msg_queue;
+	    k_list_t  mbox_wait;
+	    k_list_t *prio_q;				/* levels queues, or 0 for one			*/
+	    uint32_t  prio_map;				/* 0x80000000 >> prio per queue in use	*/
+	    uint16_t  count;
+	    uint16_t  limit;				/* most messages held; 0 for no limit	*/
+	    uint16_t  dropped;				/* messages the policy dropped			*/
+	    uint8_t   levels;
+	    uint8_t   policy;
+	};
+
+	/*
+	 * what a send to a full mailbox does. a message dropped goes back
+	 *	to its pool.
+	 */
+	#define OS_MBOX_REJECT			0	/* os_msg_send() fails; the sender keeps it */
+	#define OS_MBOX_DROP_OLDEST		1	/* the oldest of the least urgent goes	*/
+	#define OS_MBOX_DROP_LOWEST		2	/* as above, if the new one is more		*/
+										/* urgent; otherwise it's rejected		*/
+
+	/*
+	 * a pool of count messages, each with a buffer of size bytes.
+	 *	the free messages are a list linked through msg_list.next.
+	 */
+	struct os_msg_pool_s
+	{
+	    k_list_t *free;
+	    uint16_t  size;
+	    uint16_t  avail;
+	};
 
 	#ifdef PICOMSG_C
 		#define _SCOPE_ /**/
@@ -88,33 +140,37 @@
 	/*
 	 *********************************************************
 	 *
-	 * void os_msg_receive(pt,*mbox,*msg,timeout)
-	 *	wait for a message
+	 * void os_msg_receive(pt,*mbox,msg,timeout)
+	 *	wait for a message. on return, msg is the message taken,
+	 *	or 0 if task_timer_expired(ME). msg must keep its value
+	 *	across waits; make it static.
 	 */
-	#define os_msg_receive(pt, mbox, msg, timeout)                      \
-	    do																\
-	    {																\
-	            os_delay(ME, timeout);									\
-	            LC_SET((pt)->lc);										\
-	            if(!mbox->mbox_sem.sem_count && !(task_timer_expired(ME)))	\
-	            {														\
-	                os_suspend((k_list_t *)&mbox->mbox_sem);				\
-	                return PT_WAITING;									\
-	            }														\
-		} while (0);                                                    \
-	    if (sem.sem_count)												\
-	    {																\
-	        sem.sem_count--;												\
-	        msg = (os_msg_t *)kq_qdelete((k_list_t *)mbox)  				\
-		}
-	           
+	#define os_msg_receive(pt, mbox, msg, timeout)					\
+	    do															\
+	    {															\
+	        ME->flags &= ~TCB_TIMEOUT;								\
+	        LC_SET((pt)->lc);										\
+	        if (OS_SYNC_WAIT == os_msg_take(mbox, &(msg), timeout))	\
+	        {														\
+	            return PT_WAITING;									\
+	        }														\
+	    } while (0)
+
 	/*
 	 *	Messaging related API services
 	 */
-	_SCOPE_ void os_mbox_init( os_mail_t * );
-	_SCOPE_ void os_msg_init( os_msg_t * );
-	_SCOPE_ void os_msg_send( os_msg_t *, os_mail_t * );
-	#define 	 os_msg_peek(m)  os_sem_peek(&m->mbox_sem)
+	_SCOPE_ void     os_mbox_init( os_mail_t * );
+	_SCOPE_ void     os_mbox_init_prio( os_mail_t *, k_list_t *, uint8_t );
+	_SCOPE_ void     os_mbox_limit( os_mail_t *, uint16_t, uint8_t );
+	_SCOPE_ void     os_msg_init( os_msg_t * );
+	_SCOPE_ uint8_t  os_msg_send( os_msg_t *, os_mail_t * );
+	_SCOPE_ uint8_t  os_msg_request( os_msg_t *, os_mail_t *, os_mail_t * );
+	_SCOPE_ uint8_t  os_msg_reply( os_msg_t * );
+	_SCOPE_ uint8_t  os_msg_take( os_mail_t *, os_msg_t **, timer_t );
+	_SCOPE_ void     os_msg_pool_init( os_msg_pool_t *, os_msg_t *, uint8_t *, uint16_t, uint16_t );
+	_SCOPE_ os_msg_t *os_msg_alloc( os_msg_pool_t * );
+	_SCOPE_ void     os_msg_free( os_msg_t * );
+	#define 	 os_msg_peek(m)  ((m)->count)
 	#define		 OS_NO_REPLY	(os_mail_t *)0
 
 	#undef _SCOPE_
@@ -0,0 +1,178 @@
+/********************************************************************
+ * 	DESC
+ *
+ *  MODULE NAME:	picopool.h
+ *
+ *  AUTHOR:        	Dave Sandler
+ *
+ *  DESCRIPTION:    This header file contains prototypes and variables
+ *                  	that require a scope outside of the home .C module.
+ *
+ *
+ *  EDIT HISTORY:
+ *  DATE    VERSION  INIT   DESCRIPTION OF CHANGE
+ *  ------  -------  ----   ----------------------
+ * 10-18-26			 DS	    Creation. fixed block memory pools
+ * 10-18-26			 DS	    PICO_ARENA task arenas drawn from a pool
+ *
+ *  Copyright (c) 2009 - 2021 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License 
+ *  as published by the Free Software Foundation, either version 3 
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contiki-OS protothreads license:
+ *  Copyright (c) 2004-2005, Swedish Institute of Computer Science.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the Institute nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ *  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *  OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *  HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *******************************************************************/
+
+#ifndef	_PICOPOOL_H
+	#define	_PICOPOOL_H
+	#include "pico.h"
+
+	/*
+	 * blocks are aligned to BYTE_ALIGNMENT, from k_cfg.h, and hold
+	 *	at least a pointer, which links them while they're free.
+	 */
+	#ifdef BYTE_ALIGNMENT
+		#define OS_POOL_ALIGN		BYTE_ALIGNMENT
+	#else
+		#define OS_POOL_ALIGN		4
+	#endif
+	#define OS_POOL_BLOCK(size)		\
+		((((size) < sizeof(void *) ? sizeof(void *) : (size)) + OS_POOL_ALIGN - 1) & ~(OS_POOL_ALIGN - 1))
+
+	/*
+	 * data types. a pool of count blocks of size bytes. blocks freed
+	 *	are kept on a list; blocks never used are taken from next, so
+	 *	a pool needs no setting up before its first use.
+	 */
+	typedef struct os_pool_s
+	{
+	    k_list_t  pool_wait;			/* tasks waiting, in priority order	*/
+	    void     *free;					/* blocks freed, linked				*/
+	    uint8_t  *next;					/* the first block never used		*/
+	    uint8_t  *end;
+	    uint16_t  size;					/* OS_POOL_BLOCK() of the size asked */
+	    uint16_t  count;
+	    uint16_t  used;					/* blocks allocated now				*/
+	    uint16_t  high_water;			/* the most ever allocated at once	*/
+	    uint16_t  failed;				/* allocations that found none free	*/
+	} os_pool_t;
+
+	/*
+	 *********************************************************
+	 *
+	 * OS_POOL_DEFINE(name,size,count)
+	 *	define os_pool_t name, and its blocks, aligned, at
+	 *	compile time. it's ready to use; os_pool_init() isn't
+	 *	needed. put static in front for a pool of one module.
+	 */
+	#define OS_POOL_DEFINE(name, size, count)						\
+		static uint8_t name##_blocks[OS_POOL_BLOCK(size) * (count)]	\
+		    __attribute__ ((aligned(OS_POOL_ALIGN)));					\
+		os_pool_t name =											\
+		{															\
+		    { &name.pool_wait, &name.pool_wait },					\
+		    0,														\
+		    name##_blocks,											\
+		    name##_blocks + sizeof(name##_blocks),					\
+		    OS_POOL_BLOCK(size),									\
+		    (count),												\
+		    0, 0, 0													\
+		}
+
+	/*
+	 ********************************************************************
+	 *
+	 *   routines exposed by this module
+	 */
+	#ifdef PICOPOOL_C
+		#define _SCOPE_ 	/**/
+	#else
+		#define _SCOPE_ extern	/**/
+	#endif
+
+	/*
+	 *********************************************************
+	 *
+	 * void os_pool_wait(pt,pool,blk,timeout)
+	 *	wait for a block. on return, blk is the block, or 0 if
+	 *	task_timer_expired(ME). blk must keep its value across
+	 *	waits; make it static.
+	 */
+	#define os_pool_wait(pt, pool, blk, timeout)					\
+	    do														\
+	    {														\
+	        ME->flags &= ~TCB_TIMEOUT;							\
+	        LC_SET((pt)->lc);									\
+	        if (OS_SYNC_WAIT == os_pool_take(&(pool), (void **)&(blk), timeout))	\
+	        {													\
+	            return PT_WAITING;								\
+	        }													\
+	    } while (0)
+
+	_SCOPE_ void     os_pool_init(os_pool_t *, void *, uint16_t, uint16_t);
+	_SCOPE_ void    *os_pool_alloc(os_pool_t *);
+	_SCOPE_ void     os_pool_free(os_pool_t *, void *);
+	_SCOPE_ uint8_t  os_pool_take(os_pool_t *, void **, timer_t);
+	_SCOPE_ void    *os_pool_alloc_isr(os_pool_t *);
+	_SCOPE_ void     os_pool_free_isr(os_pool_t *, void *);
+	_SCOPE_ void     os_pool_wake(os_pool_t *);
+	#define		     os_pool_avail(p)	((uint16_t)((p)->count - (p)->used))
+
+	#if (PICO_ARENA)
+	/*
+	 * a task's arena. the task's first os_arena_alloc() takes a block
+	 *	of its pool, and later ones are cut from it in turn. it goes
+	 *	back when the protothread ends, exits or restarts, so state
+	 *	a task keeps across waits takes memory only while it's busy.
+	 *	os_arena(ME) finds the first allocation again after a wait.
+	 */
+	_SCOPE_ void     os_arena_attach(tcb_entry_t *, os_pool_t *);
+	_SCOPE_ void    *os_arena_alloc(uint16_t);
+	_SCOPE_ void     os_arena_reset(tcb_entry_t *);
+	#define		     os_arena(t)		((void *)(t)->arena)
+	#define		     os_arena_used(t)	((t)->arena_used)
+	#define		     os_arena_peak(t)	((t)->arena_peak)
+	#endif
+	#undef _SCOPE_
+#endif
+/*
+ ********************************************************/
@@ -13,6 +13,10 @@
  *  DATE    VERSION  INIT   DESCRIPTION OF CHANGE
  *  ------  -------  ----   ----------------------
  * 4-26-07			 DS	    Creation
+ * 10-18-26			 DS	    bulk and in place reads and writes. os_que_full
+ *							 without a divide; os_que_free takes a pointer
+ * 10-18-26			 DS	    os_ring_t, a lock free single producer and
+ *							 single consumer ring
  *
  *  Copyright (c) 2009 - 2021 Dave Sandler
  *
@@ -87,6 +91,25 @@
 	    q_type_t *buff;
 	} os_queue_t;
 
+	/*
+	 * a ring of a power of two items, for one producer and one
+	 *	consumer: an ISR and a task, or two cores. head and tail
+	 *	run free and are masked to index; each end writes only
+	 *	its own, ordered after the items, so neither end turns
+	 *	interrupts off. each end also keeps the last value it saw
+	 *	of the other's, and reads it again only when that looks
+	 *	full or empty.
+	 */
+	typedef struct
+	{
+	    q_type_t *buff;
+	    q_size_t  mask;					/* items - 1						*/
+	    q_size_t  head OS_CACHE_ALIGN;	/* the producer's: items put		*/
+	    q_size_t  tail_seen;
+	    q_size_t  tail OS_CACHE_ALIGN;	/* the consumer's: items got		*/
+	    q_size_t  head_seen;
+	} os_ring_t;
+
 	/*
 	 ********************************************************************
 	 *
@@ -112,8 +135,41 @@
 	#define		     os_que_put(q, i) 	os_que_add(q, (q_type_t *)&i)
 	#define		     os_que_get(q, i) 	os_que_remove(q, (q_type_t *)&i)
 	#define		     os_que_empty(q)	(q->inptr == q->outptr)
-	#define		     os_que_full(q)		(((q->inptr + 1) % q->qsize) == q->outptr)
-	#define  		 os_que_free(q) 	(q_size_t)(q.outptr - q.inptr - 1)
+	#define		     os_que_full(q)		(((q->inptr + 1 == q->qsize) ? 0 : q->inptr + 1) == q->outptr)
+	#define		     os_que_count(q)	(q_size_t)((q->inptr >= q->outptr) ? (q->inptr - q->outptr) : \
+										 (q->qsize - q->outptr + q->inptr))
+	#define  		 os_que_free(q) 	(q_size_t)(q->qsize - 1 - os_que_count(q))
+
+	/*
+	 * in bulk, and in place. os_que_write() and os_que_read() copy in at
+	 *	most two spans. os_que_reserve() gives the free space that runs
+	 *	on from the write index, for a producer, DMA say, to fill and
+	 *	then os_que_commit(); os_que_peek_span() the data that runs on
+	 *	from the read index, to use and then os_que_consume(). with one
+	 *	producer and one consumer, each moves only its own index.
+	 */
+	_SCOPE_ q_size_t os_que_write(os_queue_t *, const q_type_t *, q_size_t);
+	_SCOPE_ q_size_t os_que_read(os_queue_t *, q_type_t *, q_size_t);
+	_SCOPE_ q_size_t os_que_reserve(os_queue_t *, q_type_t **);
+	_SCOPE_ void     os_que_commit(os_queue_t *, q_size_t);
+	_SCOPE_ q_size_t os_que_peek_span(os_queue_t *, q_type_t **);
+	_SCOPE_ void     os_que_consume(os_queue_t *, q_size_t);
+
+	/*
+	 * the lock free ring. os_ring_put() and os_ring_write() are the
+	 *	producer's, os_ring_get() and os_ring_read() the consumer's.
+	 *	the count is a snapshot; from either end it's no more than
+	 *	the other end may have changed since.
+	 */
+	_SCOPE_ void     os_ring_init(os_ring_t *, q_size_t, q_type_t *);
+	_SCOPE_ uint8_t  os_ring_put(os_ring_t *, const q_type_t *);
+	_SCOPE_ uint8_t  os_ring_get(os_ring_t *, q_type_t *);
+	_SCOPE_ q_size_t os_ring_write(os_ring_t *, const q_type_t *, q_size_t);
+	_SCOPE_ q_size_t os_ring_read(os_ring_t *, q_type_t *, q_size_t);
+	#define		     os_ring_size(r)	(q_size_t)((r)->mask + 1)
+	#define		     os_ring_count(r)	(q_size_t)(os_load_acq16(&(r)->head) - os_load_acq16(&(r)->tail))
+	#define		     os_ring_empty(r)	(0 == os_ring_count(r))
+	#define		     os_ring_full(r)	(os_ring_count(r) > (r)->mask)
 	#undef _SCOPE_
 #endif
 /*
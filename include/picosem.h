@@ -13,6 +13,18 @@
  *  DATE    VERSION  INIT   DESCRIPTION OF CHANGE
  *  ------  -------  ----   ----------------------
  *	09-27-2012		DS		modified to use protothreads
+ *	10-18-2026		DS		priority inheritance mutex, reader/writer lock,
+ *							barrier and latch
+ *	10-18-2026		DS		os_sem_wait takes the kernel lock for PICO_SMP
+ *	10-18-2026		DS		os_sem_wait leaves the task ready when the
+ *							count is there at once
+ *	10-18-2026		DS		event flag groups with PICO_NOTIFY
+ *	10-18-2026		DS		mutexes and rwlocks carry an os_pi_t;
+ *							inheritance follows a chain of owners
+ *							and is given back as waiters leave.
+ *							os_sem_wait arms its timeout only to wait
+ *	10-18-2026		DS		the count of a mutex moves into its os_pi_t;
+ *							an unlock hands it to the first waiter
  *
  *  Copyright (c) 2009 - 2021 Dave Sandler
  *
@@ -72,7 +84,53 @@
 	    uint8_t   sem_count;
 	} os_sem_t;
 
-	#ifdef PICO_C
+	/*
+	 * the wait queues below are kept in priority order; see
+	 *	os_wait_prio(). os_pi_t is in pico.h.
+	 */
+	typedef struct
+	{
+	    os_pi_t      pi;			/* waiters, owner and its nested locks */
+	} os_mutex_t;
+
+	typedef struct
+	{
+	    os_pi_t      pi;			/* writers waiting, and the writer */
+	    k_list_t     rd_wait;
+	    uint8_t      readers;
+	} os_rwlock_t;
+
+	typedef struct
+	{
+	    k_list_t  bar_wait;
+	    uint8_t   count;			/* tasks that meet at the barrier */
+	    uint8_t   arrived;
+	} os_barrier_t;
+
+	typedef struct
+	{
+	    k_list_t  latch_wait;
+	    uint16_t  count;
+	} os_latch_t;
+
+	#if (PICO_NOTIFY)
+	/*
+	 * an event flag group. a waiter's mask and mode are kept in
+	 *	its TCB, so os_flags_set() wakes only the tasks it satisfies.
+	 */
+	typedef struct
+	{
+	    k_list_t  flg_wait;
+	    uint32_t  flags;
+	} os_flags_t;
+
+	#define OS_FLAGS_ANY		0x00	/* any of the bits				*/
+	#define OS_FLAGS_ALL		0x01	/* all of the bits				*/
+	#define OS_FLAGS_CLEAR		0x02	/* consume the bits waited for	*/
+	#define OS_FLAGS_DONE		0x80	/* internal; set by os_flags_set */
+	#endif
+
+	#ifdef PICOSEM_C
 		#define _SCOPE_ /**/
 	#else
 		#define _SCOPE_ extern
@@ -82,16 +140,21 @@
 	 *********************************************************
 	 *
 	 * void os_sem_wait(pt,*sem,timeout)
-	 *	wait on a semaphore
+	 *	wait on a semaphore. os_sem_signal() stops the timeout
+	 *	of the tasks it wakes, so one that finds the count gone
+	 *	waits again for the whole timeout.
 	 */
 	#define os_sem_wait(pt, sem, timeout)                    \
 	    do												\
 	    {												\
-	        os_delay(ME, timeout);						\
+	        ME->flags &= ~TCB_TIMEOUT;					\
 	        LC_SET((pt)->lc);							\
+	        K_LOCK();									\
 	        if(!sem.sem_count && !(task_timer_expired(ME)))\
 	        {											\
+	            os_delay(ME, timeout);					\
 	            os_suspend( (k_list_t *)&sem );			\
+	            K_UNLOCK();								\
 	            return PT_WAITING;						\
 	        }											\
 		} while (0);                                         \
@@ -99,12 +162,127 @@
 	    {												\
 	        sem.sem_count--;								\
 	    }												\
+	    if (!task_ready(ME))								\
+	    {												\
+	        os_resume_task(ME);							\
+	    }												\
+	    K_UNLOCK();										\
+	/*
+	 *********************************************************
+	 *
+	 * void os_mutex_lock(pt,mtx,timeout)
+	 *	lock a mutex. on return, the task owns mtx unless
+	 *	task_timer_expired(ME).
+	 */
+	#define os_mutex_lock(pt, mtx, timeout)						\
+	    do													\
+	    {													\
+	        ME->flags &= ~TCB_TIMEOUT;						\
+	        LC_SET((pt)->lc);								\
+	        if (OS_SYNC_WAIT == os_mutex_take(&(mtx), timeout))	\
+	        {												\
+	            return PT_WAITING;							\
+	        }												\
+	    } while (0)
+
+	/*
+	 *********************************************************
+	 *
+	 * void os_rwlock_read(pt,rw,timeout)
+	 * void os_rwlock_write(pt,rw,timeout)
+	 *	take a reader/writer lock for shared or sole use. on
+	 *	return, the task holds rw unless task_timer_expired(ME).
+	 */
+	#define os_rwlock_lock(pt, rw, write, timeout)				\
+	    do													\
+	    {													\
+	        ME->flags &= ~TCB_TIMEOUT;						\
+	        LC_SET((pt)->lc);								\
+	        if (OS_SYNC_WAIT == os_rwlock_take(&(rw), write, timeout))	\
+	        {												\
+	            return PT_WAITING;							\
+	        }												\
+	    } while (0)
+	#define os_rwlock_read(pt, rw, timeout)		os_rwlock_lock(pt, rw, 0, timeout)
+	#define os_rwlock_write(pt, rw, timeout)	os_rwlock_lock(pt, rw, 1, timeout)
+
+	/*
+	 *********************************************************
+	 *
+	 * void os_barrier_wait(pt,bar)
+	 * void os_latch_wait(pt,latch)
+	 *	wait for the rest of the tasks to reach the barrier, or
+	 *	for the latch to count down to zero.
+	 */
+	#define os_sync_block(pt, call)								\
+	    do													\
+	    {													\
+	        PT_YIELD_FLAG = 0;								\
+	        if (OS_SYNC_WAIT == (call))						\
+	        {												\
+	            LC_SET((pt)->lc);							\
+	            if (0 == PT_YIELD_FLAG)						\
+	            {											\
+	                return PT_WAITING;						\
+	            }											\
+	        }												\
+	    } while (0)
+	#define os_barrier_wait(pt, bar)	os_sync_block(pt, os_barrier_arrive(&(bar)))
+	#define os_latch_wait(pt, latch)	os_sync_block(pt, os_latch_check(&(latch)))
+
+	#if (PICO_NOTIFY)
+	/*
+	 *********************************************************
+	 *
+	 * void os_flags_wait(pt,grp,bits,mode,timeout)
+	 *	wait for any (OS_FLAGS_ANY) or all (OS_FLAGS_ALL) of bits
+	 *	in an event flag group; or in OS_FLAGS_CLEAR to consume
+	 *	them. on return, os_flags_result() holds the bits that were
+	 *	set, unless task_timer_expired(ME).
+	 */
+	#define os_flags_wait(pt, grp, bits, mode, timeout)			\
+	    do													\
+	    {													\
+	        ME->flags &= ~TCB_TIMEOUT;						\
+	        LC_SET((pt)->lc);								\
+	        if (OS_SYNC_WAIT == os_flags_take(&(grp), bits, mode, timeout))	\
+	        {												\
+	            return PT_WAITING;							\
+	        }												\
+	    } while (0)
+	#define os_flags_result()			(ME->wait_bits)
+	#endif
+
 	/*
 	 *	Semaphore related API services
 	 */
 	_SCOPE_ void os_sem_init( os_sem_t * );
 	_SCOPE_ void os_sem_signal( os_sem_t * );
 	_SCOPE_ uint8_t os_sem_peek( os_sem_t * );
+	/*
+	 *	Mutex, reader/writer lock, barrier and latch services
+	 */
+	_SCOPE_ void    os_mutex_init( os_mutex_t * );
+	_SCOPE_ uint8_t os_mutex_take( os_mutex_t *, timer_t );
+	_SCOPE_ uint8_t os_mutex_unlock( os_mutex_t * );
+	_SCOPE_ void    os_rwlock_init( os_rwlock_t * );
+	_SCOPE_ uint8_t os_rwlock_take( os_rwlock_t *, uint8_t, timer_t );
+	_SCOPE_ uint8_t os_rwlock_unlock( os_rwlock_t * );
+	_SCOPE_ void    os_barrier_init( os_barrier_t *, uint8_t );
+	_SCOPE_ uint8_t os_barrier_arrive( os_barrier_t * );
+	_SCOPE_ void    os_latch_init( os_latch_t *, uint16_t );
+	_SCOPE_ void    os_latch_count_down( os_latch_t * );
+	_SCOPE_ uint8_t os_latch_check( os_latch_t * );
+	#if (PICO_NOTIFY)
+	/*
+	 *	Event flag group services
+	 */
+	_SCOPE_ void     os_flags_init( os_flags_t * );
+	_SCOPE_ void     os_flags_set( os_flags_t *, uint32_t );
+	_SCOPE_ uint32_t os_flags_clear( os_flags_t *, uint32_t );
+	_SCOPE_ uint32_t os_flags_peek( os_flags_t * );
+	_SCOPE_ uint8_t  os_flags_take( os_flags_t *, uint32_t, uint8_t, timer_t );
+	#endif
 
 	#undef _SCOPE_
 
@@ -0,0 +1,161 @@
+/********************************************************************
+ * 	DESC
+ *
+ *  MODULE NAME:	picotrace.h
+ *
+ *  AUTHOR:        	Dave Sandler
+ *
+ *  DESCRIPTION:    This header file contains prototypes and variables
+ *                  	that require a scope outside of the home .C module.
+ *
+ *
+ *  EDIT HISTORY:
+ *  DATE    VERSION  INIT   DESCRIPTION OF CHANGE
+ *  ------  -------  ----   ----------------------
+ * 10-18-26			 DS	    Creation. binary scheduler event trace
+ * 10-18-26			 DS	    TR_ISR, interrupt events handed to tasks
+ * 10-18-26			 DS	    N_TASKS must leave OS_TRACE_NO_TASK free
+ *
+ *  Copyright (c) 2009 - 2021 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License 
+ *  as published by the Free Software Foundation, either version 3 
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contiki-OS protothreads license:
+ *  Copyright (c) 2004-2005, Swedish Institute of Computer Science.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the Institute nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ *  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *  OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *  HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *******************************************************************/
+
+#ifndef	_PICOTRACE_H
+	#define	_PICOTRACE_H
+	#include "pico.h"
+
+	#ifndef OS_TRACE_SIZE
+		#define OS_TRACE_SIZE					  256
+	#endif
+	#if ((OS_TRACE_SIZE < 2) || (OS_TRACE_SIZE & (OS_TRACE_SIZE - 1)))
+		#error OS_TRACE_SIZE must be a power of 2
+	#endif
+	#ifndef OS_TRACE_MASK
+		#define OS_TRACE_MASK		   (~(uint32_t)0)
+	#endif
+	/*
+	 * put the ring in RAM the startup code leaves alone, e.g.
+	 *	__attribute__((section(".noinit"))), to keep it over a reset
+	 */
+	#ifndef OS_TRACE_SECTION
+		#define OS_TRACE_SECTION
+	#endif
+	#define OS_TRACE_MAGIC				   0x43525450UL	/* "PTRC"	*/
+	#define OS_TRACE_VERSION							1
+	#define OS_TRACE_NO_TASK					   0xFFFF
+	#if (N_TASKS > OS_TRACE_NO_TASK)
+		#error PICO_TRACE keeps task indexes in 16 bits; N_TASKS must be under 65536
+	#endif
+
+	/*
+	 * events. a set bit (1 << event) in the trace mask records one
+	 */
+	#define TR_BOOT									0	/* ring kept over a reset		*/
+	#define TR_DISPATCH								1	/* task called					*/
+	#define TR_RETURN								2	/* task returned				*/
+	#define TR_RESUME								3	/* task made ready				*/
+	#define TR_SUSPEND								4	/* task put on a wait queue		*/
+	#define TR_TIMER								5	/* task timer expired			*/
+	#define TR_SEM_SIGNAL							6	/* obj is the semaphore			*/
+	#define TR_MSG_SEND								7	/* obj is the mailbox			*/
+	#define TR_QUE_WRITE							8	/* obj is the queue				*/
+	#define TR_QUE_READ								9
+	#define TR_HOOK_ENTER						   10	/* obj is the hook function		*/
+	#define TR_HOOK_EXIT						   11
+	#define TR_SLEEP							   12	/* obj is the ticks to sleep	*/
+	#define TR_WAKE								   13
+	#define TR_ISR								   14	/* obj is the event id			*/
+
+	/*
+	 * data types. one record is 12 bytes, little endian on the wire.
+	 */
+	typedef struct
+	{
+	    uint32_t	stamp;							/* os_cycle_count()				*/
+	    uint32_t	obj;							/* address, low 32 bits			*/
+	    uint16_t	task;							/* tcb index, or OS_TRACE_NO_TASK	*/
+	    uint8_t		event;
+	    uint8_t		core;
+	} os_trace_rec_t;
+
+	/*
+	 * sent ahead of the records by os_trace_dump()
+	 */
+	typedef struct
+	{
+	    uint32_t	magic;
+	    uint16_t	version;
+	    uint16_t	rec_size;
+	    uint32_t	cycle_hz;						/* os_cycle_count() rate		*/
+	    uint32_t	count;							/* records that follow			*/
+	    uint32_t	lost;							/* overwritten before a drain	*/
+	} os_trace_hdr_t;
+
+	/*
+	 ********************************************************************
+	 *
+	 *   routines exposed by this module
+	 */
+	#ifdef PICOTRACE_C
+		#define _SCOPE_ 	/**/
+	#else
+		#define _SCOPE_ extern	/**/
+	#endif
+
+	#if (PICO_TRACE)
+		_SCOPE_ void	 os_trace_init( void );
+		_SCOPE_ void	 os_trace( uint8_t, tcb_entry_t *, const void * );
+		_SCOPE_ uint32_t os_trace_mask( uint32_t );
+		_SCOPE_ uint16_t os_trace_read( os_trace_rec_t *, uint16_t );
+		_SCOPE_ uint32_t os_trace_dump( void ( *)(const uint8_t *, uint16_t) );
+		#define			 OS_TRACE( e, t, o )	os_trace( e, t, (const void *)(o) )
+	#else
+		#define			 OS_TRACE( e, t, o )
+	#endif
+	#undef _SCOPE_
+#endif
+/*
+ ********************************************************/
@@ -15,6 +15,16 @@
  * 4-26-07			 DS	    Creation
  * 9-30-10			 DS	    Modify for the PIC32MX and Microchip libs
  * 9-19-12			 DS	    expand core selection switches
+ * 10-18-26			 DS	    count leading zeros for the ready map
+ * 10-18-26			 DS	    Linux host target
+ * 10-18-26			 DS	    Linux tick signal masking, idle residency
+ * 10-18-26			 DS	    Linux virtual time
+ * 10-18-26			 DS	    sub-tick counts for os_time_now()
+ * 10-18-26			 DS	    atomic or and exchange for interrupt events
+ * 10-18-26			 DS	    ordered index loads and stores, cache line
+ * 10-18-26			 DS	    os_irq_save() and os_irq_restore() on every port
+ * 10-18-26			 DS	    atomic add for the trace ring
+ * 10-18-26			 DS	    AVR ring index loads and stores with interrupts off
  *
  *  Copyright (c) 2009 - 2021 Dave Sandler
  *
@@ -92,6 +102,10 @@
 		#include	"interrupt.h"
 	#elif defined(CORTEXM0)
 		#include <asf.h>
+	#elif defined(LINUX)
+		/*
+		 * system headers come in through dtypes.h
+		 */
 	#else
 		#error Unknown processor or compiler.
 	#endif
@@ -225,9 +239,192 @@
 		#define EI()	CLEAR_INTERRUPT_MASK()
 		#define clr_wdt() wdt_reset_count()
 	#endif
+
+	#ifdef	LINUX
+		/*
+		 * the tick is a signal. DI() holds it off, and EI() runs
+		 *	any tick that came meanwhile. With PICO_SMP the tick is
+		 *	a thread, and the kernel lock keeps it out.
+		 */
+		#if ((1 == OS_HOST_TICK) && !PICO_SMP)
+			#define DI()	os_irq_disable()
+			#define EI()	os_irq_enable()
+		#else
+			#define DI()
+			#define EI()
+		#endif
+		#define clr_wdt() os_wdt_reset()
+
+		/*
+		 * idle residency: time spent in os_sleep() against time up
+		 *	since os_sleep_init(), in nanoseconds
+		 */
+		typedef struct
+		{
+			uint64_t	asleep;
+			uint64_t	awake;
+			uint32_t	sleeps;
+		} os_sleep_stats_t;
+
+		extern void os_irq_disable(void);
+		extern void os_irq_enable(void);
+		extern void os_get_sleep_stats(os_sleep_stats_t *);
+
+		/*
+		 * virtual time; simulated interrupts and their schedule
+		 */
+		#if (2 == OS_HOST_TICK)
+			typedef void (*os_sim_isr_fn)(uint32_t);
+			typedef struct
+			{
+				const char	   *name;
+				os_sim_isr_fn	isr;
+			} os_sim_isr_t;
+
+			extern uint8_t	os_sim_event(uint64_t, uint64_t, os_sim_isr_fn, uint32_t);
+			extern int		os_sim_script(const char *, const os_sim_isr_t *);
+			extern void		os_sim_until(uint64_t);
+			extern uint64_t	os_sim_now(void);
+			extern void		os_sim_seed(uint32_t);
+			extern uint32_t	os_sim_random(void);
+		#endif
+	#endif
 	#define ENTER_CRITICAL()		DI()
 	#define EXIT_CRITICAL()			EI()
 	#define portNOP()
+
+	/*
+	 *********************************************************
+	 *
+	 * 	Sub-tick counts for os_time_now(). Where the port has
+	 *	os_tick_fraction(), the tick timer's counts in a tick, as
+	 *	each port programs its reload. The Linux host counts
+	 *	nanoseconds.
+	 */
+	#ifndef OS_TICK_FRACTION
+		#if (defined(CORTEXM3) || defined(CORTEXM0))
+			#define OS_TICK_FRACTION	1
+			#define OS_TICK_COUNTS		(CPU_CLOCK_HZ / TICK_RATE_HZ)
+		#elif defined(PIC32MX)
+			#define OS_TICK_FRACTION	1
+			#define OS_TICK_COUNTS		(CPU_CLOCK_HZ / (64UL * TICK_RATE_HZ))
+		#elif (defined(PIC24E) || defined(DSPIC30))
+			#define OS_TICK_FRACTION	1
+			#define OS_TICK_COUNTS		(CPU_CLOCK_HZ / 8UL / TICK_RATE_HZ)
+		#elif defined(LINUX)
+			#define OS_TICK_FRACTION	1
+			#define OS_TICK_COUNTS		(1000000000UL / TICK_RATE_HZ)
+		#endif
+	#endif
+
+	/*
+	 *********************************************************
+	 *
+	 * 	Count leading zeros of a 32 bit word (x != 0). The gcc
+	 *	based tool chains map this to CLZ where the core has one,
+	 *	otherwise pico.c supplies a portable os_clz32().
+	 */
+	#if defined(__GNUC__)
+		#if (__SIZEOF_INT__ >= 4)
+			#define os_clz32(x)		((uint8_t)__builtin_clz(x))
+		#else
+			#define os_clz32(x)		((uint8_t)__builtin_clzl(x))
+		#endif
+	#endif
+
+	/*
+	 *********************************************************
+	 *
+	 * 	Interrupts off, and back as they were. Unlike DI() and
+	 *	EI() these nest, and may be used from an ISR: the state
+	 *	saved is put back, not turned on. On the Cortex-M it is
+	 *	PRIMASK, not the BASEPRI that DI() sets, so a WFI still
+	 *	wakes for any interrupt; the 16 bit PICs raise the CPU
+	 *	priority to 7, as their DI() is empty.
+	 */
+	#if (defined(CORTEXM3) || defined(CORTEXM0))
+		typedef uint32_t os_irq_t;
+		#define os_irq_save()		__extension__ ({ uint32_t _s; __asm volatile (	\
+										" mrs %0, primask \n"						\
+										" cpsid i         \n" : "=r" (_s) :: "memory"); _s; })
+		#define os_irq_restore(s)	__asm volatile (" msr primask, %0 \n" :: "r" (s) : "memory")
+	#elif (defined(PIC32MX) || defined(PIC32MZ))
+		typedef uint32_t os_irq_t;
+		#define os_irq_save()		__builtin_disable_interrupts()
+		#define os_irq_restore(s)	do { if ((s) & 1) { __builtin_enable_interrupts(); } } while (0)
+	#elif (defined(PIC24E) || defined(PIC24F) || defined(DSPIC30) || defined(DSPIC33) || defined(DSPIC33C))
+		typedef uint16_t os_irq_t;
+		#define os_irq_save()		__extension__ ({ uint16_t _s; SET_AND_SAVE_CPU_IPL(_s, 7); _s; })
+		#define os_irq_restore(s)	RESTORE_CPU_IPL(s)
+	#elif defined(__AVR__)
+		#include	<avr/io.h>
+		#include	<avr/interrupt.h>
+		typedef uint8_t os_irq_t;
+		#define os_irq_save()		__extension__ ({ uint8_t _s = SREG; cli(); _s; })
+		#define os_irq_restore(s)	(SREG = (s))
+	#elif defined(LINUX)
+		typedef uint8_t os_irq_t;
+		extern os_irq_t os_irq_save(void);
+		extern void		os_irq_restore(os_irq_t);
+	#elif (PICO_ISR || PICO_TICKLESS || PICO_TRACE)
+		#error PICO_ISR, PICO_TICKLESS and PICO_TRACE need os_irq_save() and os_irq_restore() on this port
+	#endif
+
+	/*
+	 *********************************************************
+	 *
+	 * 	Atomic or, exchange and add of a 32 bit word, for the
+	 *	interrupt event bitmap and the trace ring. The add
+	 *	gives the value before. The gcc builtins are used where
+	 *	the core has exclusive loads and stores, or the host
+	 *	does; elsewhere pico.c does them between os_irq_save()
+	 *	and os_irq_restore(), for the few instructions they take.
+	 */
+	#if (defined(__GNUC__) && (defined(CORTEXM3) || defined(PIC32MX) || defined(PIC32MZ) || defined(LINUX)))
+		#define os_atomic_or32(p, v)	((void)__atomic_fetch_or((p), (v), __ATOMIC_RELEASE))
+		#define os_atomic_xchg32(p, v)	__atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+		#define os_atomic_add32(p, v)	__atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+	#endif
+
+	/*
+	 *********************************************************
+	 *
+	 * 	Ordered load and store of a 16 bit index, for a ring
+	 *	shared between an ISR, or another core, and a task. The
+	 *	store releases the items written before it; the load
+	 *	acquires them. The 16 bit cores are in order with one
+	 *	bus master, and do it in one access, so a compiler
+	 *	barrier is all they need. The AVR takes two byte
+	 *	accesses, which an ISR could fall between, so there
+	 *	the access is made with interrupts off.
+	 *
+	 *	OS_CACHE_ALIGN starts a member on a cache line of its
+	 *	own, where the host would otherwise bounce a line
+	 *	between the cores a ring's two ends run on.
+	 */
+	#if (defined(__GNUC__) && (defined(CORTEXM3) || defined(CORTEXM0) || defined(PIC32MX) || defined(PIC32MZ) || defined(LINUX)))
+		#define os_load_acq16(p)		__atomic_load_n((p), __ATOMIC_ACQUIRE)
+		#define os_store_rel16(p, v)	__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+	#elif (defined(__GNUC__) && defined(__AVR__))
+		#define os_load_acq16(p)		__extension__ ({ uint16_t _v; os_irq_t _s = os_irq_save(); \
+										  _v = *(volatile uint16_t *)(p); os_irq_restore(_s); \
+										  __asm__ __volatile__ ("" ::: "memory"); _v; })
+		#define os_store_rel16(p, v)	do { os_irq_t _s = os_irq_save(); \
+										  *(volatile uint16_t *)(p) = (v); os_irq_restore(_s); } while (0)
+	#elif defined(__GNUC__)
+		#define os_load_acq16(p)		__extension__ ({ uint16_t _v = *(volatile uint16_t *)(p); \
+										  __asm__ __volatile__ ("" ::: "memory"); _v; })
+		#define os_store_rel16(p, v)	do { __asm__ __volatile__ ("" ::: "memory"); \
+										  *(volatile uint16_t *)(p) = (v); } while (0)
+	#else
+		#define os_load_acq16(p)		(*(volatile uint16_t *)(p))
+		#define os_store_rel16(p, v)	(*(volatile uint16_t *)(p) = (v))
+	#endif
+	#if (defined(__GNUC__) && defined(LINUX))
+		#define OS_CACHE_ALIGN			__attribute__ ((aligned(64)))
+	#else
+		#define OS_CACHE_ALIGN
+	#endif
 #endif /* safety check for duplicate .h file */
 /*
  *  END OF portable.h
@@ -244,6 +244,25 @@ struct pt
 		os_delay(ME, delay);    \
 		PT_WAIT_UNTIL(pt, task_timer_expired(ME));
 
+/**
+ * Block and wait for the task's next period.
+ *
+ * This macro blocks a periodic task until its next release. Releases
+ * are kept in absolute ticks, so time spent running or waiting to
+ * run does not add up as drift. The task gives up the processor
+ * even when it overran and is due again at once. See
+ * os_create_periodic_task().
+ *
+ * \param pt A pointer to the protothread control structure.
+ *
+ * \hideinitializer
+ */
+
+	#define PT_WAIT_NEXT_PERIOD(pt) \
+		os_wait_next_period(ME);    \
+		PT_YIELD_UNTIL(pt, task_timer_expired(ME)); \
+		os_period_started(ME);
+
 /**
  * Block and wait while condition is true.
  *
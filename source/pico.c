@@ -26,6 +26,64 @@
  *							timer updates only when time's elapsed.
  *   09-28-12   DS  	doxygen documentation support
  *   05-30-13   DS  	fix os_tick_delay(). immediate fall through meant no delay.
+ *   10-18-26   DS  	ready list indexed by a priority bitmap. resume, suspend
+ *							and dispatch no longer walk the list.
+ *   10-18-26   DS  	task timers hold absolute deadlines on a timer wheel.
+ *							service_os_timers touches only the expiring timers
+ *							instead of every tcb on every tick.
+ *   10-18-26   DS  	tickless idle. os_seconds is kept here rather than in
+ *							each port's tick interrupt.
+ *   10-18-26   DS  	PICO_RR round-robin. a task that yields, or that uses
+ *							up its quantum, goes to the back of its priority.
+ *   10-18-26   DS  	PICO_EDF scheduling class. tasks at OS_EDF_PRIO are
+ *							ordered by absolute deadline, and misses counted.
+ *   10-18-26   DS  	PICO_PERIODIC tasks. releases are kept in absolute
+ *							ticks, with release jitter and overruns counted.
+ *   10-18-26   DS  	priority ordered wait queues, and os_set_task_prio()
+ *							for priority inheritance.
+ *   10-18-26   DS  	PICO_SMP. a ready list per core, with idle cores
+ *							stealing work from busy ones, and task affinity.
+ *   10-18-26   DS  	hooks run at a period and phase, in due order, by
+ *							priority. kq_slndelete() no longer spins.
+ *   10-18-26   DS  	free tcbs are kept on a list, and tasks hashed by
+ *							function, so spawn and os_get_task_handle()
+ *							do not scan tcb[]. os_task_idx_t for N_TASKS.
+ *   10-18-26   DS  	PICO_STATS. run time per task, and per core in the
+ *							timers, hooks and idle, by os_cycle_count().
+ *   10-18-26   DS  	PICO_TRACE tracepoints for dispatch, resume, suspend,
+ *							timer expiry, hooks and tickless sleep.
+ *   10-18-26   DS  	os_time_now(). os_tick_delay() waits with
+ *							tick_reached(), as a tick may be missed.
+ *   10-18-26   DS  	PICO_ISR. interrupts post events to a bitmap, and
+ *							the loop hands them to tasks in id order.
+ *   10-18-26   DS  	PICO_NOTIFY. a notification value in each task.
+ *   10-18-26   DS  	PICO_ARENA. a task's arena goes back to its pool
+ *							when the protothread ends, exits or restarts.
+ *   10-18-26   DS  	OS_TMR_LEVELS wheels replace the overflow list. a
+ *							cascade moves one slot, and empty wheels are
+ *							stepped over.
+ *   10-18-26   DS  	tickless idle checks for work and sleeps with
+ *							interrupts off. the atomic fallbacks save and
+ *							restore the mask.
+ *   10-18-26   DS  	os_time_now() keeps its last time with interrupts
+ *							off.
+ *   10-18-26   DS  	os_create_periodic_task() refuses a period of 0.
+ *   10-18-26   DS  	os_pi_reprio(). inheritance follows the chain of
+ *							owners, and a waiter leaving its queue gives
+ *							its priority back.
+ *   10-18-26   DS  	PICO_SMP. a task on a core has TCB_READY clear,
+ *							and k_smp_run() puts it back under K_LOCK.
+ *   10-18-26   DS  	OS_TASK_HASH buckets chain the oldest task of each
+ *							function, the others behind it, so a lookup
+ *							walks functions rather than tasks.
+ *   10-18-26   DS  	os_notify_take() clears TCB_TIMEOUT as it takes a
+ *							notification.
+ *   10-18-26   DS  	os_tick_catchup() masks with os_irq_save().
+ *   10-18-26   DS  	os_pi_acquire(), os_pi_release() and os_pi_handoff().
+ *							a lock let go of goes to its first waiter.
+ *							os_release_tcb() lets go of a task's locks.
+ *   10-18-26   DS  	os_add_hook_rate() and os_release_hook() take the
+ *							kernel lock, then mask with os_irq_save().
  *
  *  Copyright (c) 2009 - 2021 Dave Sandler
  *
@@ -95,9 +153,12 @@
  *   System Includes
  */
 
+#include	<stddef.h>
 #include	"pico.h"
 #include	"picosem.h"
 #include	"picomsg.h"
+#include	"picopool.h"
+#include	"picotrace.h"
 
 #ifdef USES_UIP
 #include 	"uip.h"
@@ -123,6 +184,16 @@
  *
  *   Constants
  */
+#define	k_tmr_owner(n)	((tcb_entry_t *)((uint8_t *)(n) - offsetof(tcb_entry_t, tmr_link)))
+#if (OS_TASK_HASH)
+	#define	k_hash_owner(n)	((tcb_entry_t *)((uint8_t *)(n) - offsetof(tcb_entry_t, hash_link)))
+	#define	k_inst_owner(n)	((tcb_entry_t *)((uint8_t *)(n) - offsetof(tcb_entry_t, inst_link)))
+	#define	k_task_hash(f)	((((uintptr_t)(f) ^ ((uintptr_t)(f) >> 9)) >> 2) & (OS_TASK_HASH - 1))
+#endif
+#if (!PICO_SMP)
+	#define	k_rq_lock(t)	(&k_ready_list[0])
+	#define	k_rq_unlock(rq)
+#endif
 
 /*
  *********************************************************************
@@ -137,12 +208,31 @@
  * @{
  */
 
-static 	k_list_t       	k_ready_list;	/* !< list of tasks ready to run	                */
-static	k_list_t		k_wait_list;	/* !< list of tasks waiting to run	                */
-static	t_hook_entry_t *k_thook_list;	/* !< list of functions to be executed every tick	*/
-static	t_hook_entry_t *k_loop_list;	/* !< list of tasks executed every kernel pass      */
+static 	k_ready_t      	k_ready_list[OS_N_CORES];	/* !< per priority lists of tasks ready to run	*/
+static	k_list_t		k_tmr_wheel[OS_TMR_LEVELS][OS_TMR_SLOTS];	/* !< task timers by deadline */
+static	os_task_idx_t	k_tmr_count[OS_TMR_LEVELS];	/* !< timers on each wheel			*/
+static	t_hook_list_t	k_thook_list;	/* !< functions executed on timer ticks				*/
+static	t_hook_list_t	k_loop_list;	/* !< functions executed on kernel passes			*/
+static	uint16_t		k_hook_gen;		/* !< counts hooks added and released				*/
 static 	tcb_entry_t    	tcb[N_TASKS];	/* !< pico taskc ontrol blocks						*/
-static	timer_t		 	last_tick;		/* !< last captured timer value 					*/
+static	k_list_t		k_free_list;	/* !< unused tcbs, through tcb_link					*/
+#if (OS_TASK_HASH)
+static	k_list_t		k_task_hash[OS_TASK_HASH];	/* !< tasks by p_thread, through hash_link */
+#endif
+static	timer_t		 	last_tick;		/* !< last tick serviced by the timer wheel			*/
+static	uint16_t		sec_prescale;	/* !< ticks to the next os_seconds increment		*/
+static	uint32_t volatile k_tick_epoch;	/* !< times current_tick has wrapped				*/
+static	uint8_t	volatile k_time_seq;	/* !< changes as the tick count does				*/
+static	os_time_t		k_time_last;	/* !< last os_time_now(), kept monotonic			*/
+#if (PICO_STATS)
+static	os_stats_t		k_stats[OS_N_CORES];	/* !< where each core's loop spends its time */
+#endif
+#if (PICO_SMP)
+static	uint8_t			k_next_core;	/* !< core given the next task created				*/
+#endif
+#if (PICO_ISR)
+static	k_isr_t			k_isr;			/* !< interrupt events posted and their waiters		*/
+#endif
 /** @} */
 /*
  *********************************************************************
@@ -151,6 +241,61 @@ static	timer_t		 	last_tick;		/* !< last captured timer value 					*/
  */
 
 extern void	os_tick_init(void);
+static void			k_ready_insert(tcb_entry_t *);
+static void			k_ready_remove(tcb_entry_t *);
+static void			k_rq_mark(k_ready_t *, uint8_t);
+static void			k_rq_clear(k_ready_t *, uint8_t);
+static tcb_entry_t *k_ready_head(k_ready_t *);
+static void			k_task_unlink(tcb_entry_t *);
+static uint8_t		k_pi_top(k_list_t *, uint8_t);
+#if (OS_TASK_HASH)
+static tcb_entry_t *k_hash_find(int (*)(tcb_pt_t *));
+static void			k_hash_insert(tcb_entry_t *);
+static void			k_hash_remove(tcb_entry_t *);
+#endif
+static void			k_task_release(tcb_entry_t *, timer_t);
+#if (PICO_EDF)
+static void			k_edf_insert(k_list_t *, tcb_entry_t *);
+static void			k_edf_done(tcb_entry_t *);
+#endif
+static void			k_tmr_insert(tcb_entry_t *);
+static void			k_tmr_expire(k_list_t *);
+static void			k_tmr_cascade(timer_t);
+#if (PICO_TICKLESS)
+static timer_t		k_tmr_next(void);
+static void			k_tickless_idle(void);
+#endif
+#if (PICO_RR && !PICO_SMP)
+static void			k_rr_dispatch(tcb_entry_t *);
+#endif
+static void			k_hook_insert(t_hook_list_t *, k_list_t *, t_hook_entry_t *, uint8_t);
+#if (PICO_ISR)
+static void			k_isr_drain(void);
+#if (OS_ISR_EVENTS > 32)
+	#define			k_isr_posted()		(0 != k_isr.grp)
+#else
+	#define			k_isr_posted()		(0 != k_isr.map[0])
+#endif
+#endif
+#if (PICO_ARENA)
+	/*
+	 * PT_END, PT_EXIT and PT_RESTART leave a protothread at its start.
+	 *	that activation is over, and its arena with it.
+	 */
+	#define			k_arena_done(t)		do { if (((uint8_t *)0 != (t)->arena) && (0 == (t)->tcbpt.lc)) { os_arena_reset(t); } } while (0)
+#endif
+#if (PICO_STATS)
+static uint32_t		k_stats_lap(os_stats_t *);
+static void			k_stats_task(os_stats_t *, tcb_entry_t *);
+#endif
+#if (PICO_SMP)
+static k_ready_t   *k_rq_lock(tcb_entry_t *);
+static void			k_rq_unlock(k_ready_t *);
+static tcb_entry_t *k_smp_next(uint8_t);
+static tcb_entry_t *k_smp_steal(uint8_t);
+static void			k_smp_run(uint8_t, tcb_entry_t *);
+static uint8_t		k_smp_home(uint32_t);
+#endif
 
 /*
  *********************************************************************
@@ -176,6 +321,17 @@ extern void	os_tick_init(void);
  * The kernel is non-preemptive. Any 'hooked' function or task will
  *	execute until returning control to the kernel.
  *
+ * With PICO_TICKLESS set, a pass that finds nothing ready puts the
+ *	processor to sleep until the next task timer is due.
+ *
+ * With PICO_RR set, tasks of equal priority take turns. See
+ *	k_rr_dispatch().
+ *
+ * With PICO_SMP set, the port starts the other cores, and every core
+ *	runs os_start_sched_core(). os_start_sched() runs core 0.
+ *
+ * With PICO_STATS set, each part of a pass is timed; see os_get_stats().
+ *
  * \param 	none
  *
  * \return 	should never return
@@ -200,18 +356,125 @@ extern void	os_tick_init(void);
  */
 void os_start_sched(void)
 {
+#if (PICO_SMP)
+    os_start_cores();
+    os_start_sched_core(0);
+#else
+#if (PICO_STATS)
+    os_stats_t *st = &k_stats[0];
+
+    st->last = os_cycle_count();
+#endif
     FOREVER
     {
+#if (PICO_ISR)
+        k_isr_drain();
+#endif
         service_os_timers();
-        os_hook_handler(k_loop_list);
+#if (PICO_STATS)
+        st->passes++;
+        st->timers += k_stats_lap(st);
+#endif
+        os_hook_handler(&k_loop_list);
+#if (PICO_STATS)
+        st->loop_hooks += k_stats_lap(st);
+#endif
 
-        if( &k_ready_list != k_ready_list.next )
+        current_task = k_ready_head(&k_ready_list[0]);
+        if( (tcb_entry_t *)Q_NULL != current_task )
         {
-            current_task = (tcb_entry_t *)k_ready_list.next;
+            OS_TRACE(TR_DISPATCH, current_task, current_task->p_thread);
+#if (PICO_RR)
+            k_rr_dispatch(current_task);
+#else
             current_task->p_thread(&(current_task->tcbpt));
+#endif
+            OS_TRACE(TR_RETURN, current_task, current_task->p_thread);
+#if (PICO_ARENA)
+            k_arena_done(current_task);
+#endif
+#if (PICO_STATS)
+            k_stats_task(st, current_task);
+#endif
+        }
+#if (PICO_TICKLESS || PICO_STATS)
+        else
+        {
+#if (PICO_TICKLESS)
+            k_tickless_idle();
+#endif
+#if (PICO_STATS)
+            st->idle += k_stats_lap(st);
+#endif
+        }
+#endif
+    }
+#endif
+}
+
+#if (PICO_SMP)
+/**
+ *
+ *********************************************************************
+ *
+ * The kernel loop for one core. Each core runs the highest priority
+ *	task on its own ready list. A core with nothing ready steals a task
+ *	from another core before it idles; see k_smp_steal(). Core 0 also
+ *	services the task timers and the scheduler hooks.
+ *
+ * A task runs on one core at a time. While it runs it's off the ready
+ *	lists, and its core puts it back when it returns.
+ *
+ * \param	core		this core's number, 0 to os_n_cores - 1
+ *
+ * \return 	should never return
+ */
+void os_start_sched_core(uint8_t core)
+{
+    tcb_entry_t *task;
+#if (PICO_STATS)
+    os_stats_t  *st = &k_stats[core];
+
+    st->last = os_cycle_count();
+#endif
+
+    FOREVER
+    {
+        if (0 == core)
+        {
+#if (PICO_ISR)
+            k_isr_drain();
+#endif
+            service_os_timers();
+#if (PICO_STATS)
+            st->timers += k_stats_lap(st);
+#endif
+            os_hook_handler(&k_loop_list);
+#if (PICO_STATS)
+            st->loop_hooks += k_stats_lap(st);
+#endif
+        }
+#if (PICO_STATS)
+        st->passes++;
+#endif
+        task = k_smp_next(core);
+        if ((tcb_entry_t *)Q_NULL != task)
+        {
+            k_smp_run(core, task);
+#if (PICO_STATS)
+            k_stats_task(st, task);
+#endif
+        }
+        else
+        {
+            os_core_idle(core);
+#if (PICO_STATS)
+            st->idle += k_stats_lap(st);
+#endif
         }
     }
 }
+#endif
 
 /**
  *
@@ -246,7 +509,9 @@ void os_start_sched(void)
  */
 void os_init(void)
 {
-    uint8_t index = 0;
+    uint16_t      index = 0;
+    uint8_t       core;
+    os_task_idx_t task;
     /*
      * initialize the target's tick hardware
      */
@@ -255,15 +520,86 @@ void os_init(void)
 	os_wdt_init();
 #endif
 	os_sleep_init();
-    k_ready_list.next = k_ready_list.last = &k_ready_list;
-    k_wait_list.next  = k_wait_list.last  = &k_wait_list;
-    k_thook_list	  = (t_hook_entry_t *)SL_NULL;
-    k_loop_list	      = (t_hook_entry_t *)SL_NULL;
+#if (PICO_TRACE)
+    os_trace_init();
+#endif
+#if (PICO_SMP)
+    if ((0 == os_n_cores) || (os_n_cores > OS_N_CORES))
+    {
+        os_n_cores = OS_N_CORES;
+    }
+    k_next_core = 0;
+#endif
+    for (core = 0; core < OS_N_CORES; core++)
+    {
+#if (OS_N_PRIO > 32)
+        k_ready_list[core].grp_map = 0;
+#endif
+        index = 0;
+        do
+        {
+            k_ready_list[core].band[index].next = k_ready_list[core].band[index].last =
+                &k_ready_list[core].band[index];
+        } while (++index < OS_N_PRIO);
+        index = 0;
+        do
+        {
+            k_ready_list[core].prio_map[index] = 0;
+        } while (++index < OS_PRIO_WORDS);
+    }
+    for (core = 0; core < OS_TMR_LEVELS; core++)
+    {
+        k_tmr_count[core] = 0;
+        index = 0;
+        do
+        {
+            k_tmr_wheel[core][index].next = k_tmr_wheel[core][index].last = &k_tmr_wheel[core][index];
+        } while (++index < OS_TMR_SLOTS);
+    }
+#if (OS_TASK_HASH)
+    index = 0;
+    do
+    {
+        k_task_hash[index].next = k_task_hash[index].last = &k_task_hash[index];
+	} while (++index < OS_TASK_HASH);
+#endif
+    k_free_list.next  = k_free_list.last  = &k_free_list;
+    k_thook_list.hooks.next = k_thook_list.hooks.last = &k_thook_list.hooks;
+    k_thook_list.count      = 0;
+    k_loop_list.hooks.next  = k_loop_list.hooks.last  = &k_loop_list.hooks;
+    k_loop_list.count       = 0;
+#if (PICO_ISR)
+    for (index = 0; index < OS_ISR_WORDS; index++)
+    {
+        k_isr.map[index] = 0;
+    }
+#if (OS_ISR_EVENTS > 32)
+    k_isr.grp = 0;
+#endif
+    for (index = 0; index < OS_ISR_EVENTS; index++)
+    {
+        k_isr.ev[index].wait.next = k_isr.ev[index].wait.last = &k_isr.ev[index].wait;
+        k_isr.ev[index].fn        = (os_isr_fn)0;
+        k_isr.ev[index].arg       = 0;
+        k_isr.ev[index].pending   = 0;
+    }
+#endif
+#if (PICO_STATS)
+    os_stats_reset();
+#endif
     last_tick         = get_os_ticks();
+    sec_prescale      = SYSTICKHZ;
+    task = 0;
     do
     {
-        os_release_tcb(&tcb[index]);
-	} while (++index < N_TASKS);
+        tcb[task].tcb_link.next = tcb[task].tcb_link.last = (k_list_t *)&tcb[task];
+        tcb[task].tmr_link.next = tcb[task].tmr_link.last = &tcb[task].tmr_link;
+#if (OS_TASK_HASH)
+        tcb[task].hash_link.next = tcb[task].hash_link.last = &tcb[task].hash_link;
+        tcb[task].inst_link.next = tcb[task].inst_link.last = &tcb[task].inst_link;
+#endif
+        os_release_tcb(&tcb[task]);
+	} while (++task < N_TASKS);
 }
 /* @} */
 /**
@@ -315,17 +651,197 @@ void os_init(void)
 tcb_entry_t *os_create_task(uint8_t prio, uint8_t env, int (*pr_addr)(tcb_pt_t *))
 {
     tcb_entry_t *handle;
+    K_LOCK();
     handle = os_get_tcb();
     if ((tcb_entry_t *)Q_NULL != handle)
     {
-        handle->flags     = (prio & PRIOMASK);
+        handle->prio      = (prio & PRIOMASK);
         handle->task_env  =  env;
         handle->p_thread  =  pr_addr;
         PT_INIT(&handle->tcbpt);
+#if (OS_TASK_HASH)
+        k_hash_insert(handle);
+#endif
+#if (PICO_SMP)
+        /*
+         * spread new tasks over the cores
+         */
+        handle->core      =  k_next_core;
+        k_next_core       = (uint8_t)((k_next_core + 1) % os_n_cores);
+#endif
+    }
+    K_UNLOCK();
+    return( handle );
+}
+
+#if (PICO_EDF)
+/**
+ *
+ *********************************************************************
+ *
+ * Allocate a task in the earliest deadline first class. The task runs
+ *	at priority OS_EDF_PRIO, where ready tasks are ordered by absolute
+ *	deadline rather than FIFO. Each time the task is made ready, its
+ *	deadline is set to the release time plus the relative deadline.
+ *	A job that ends (the task delays or suspends) past its deadline is
+ *	counted; see get_deadline_misses().
+ *
+ *	Fixed priority tasks at other levels are unaffected. A plain task
+ *	created at OS_EDF_PRIO runs behind every EDF task of that level.
+ *
+ * \param env 		task 'environment' variable
+ * \param pr_addr	task function pointer
+ * \param deadline	relative deadline in ticks
+ *
+ * \return 	 		pointer to the tcb; NULL if none available
+ */
+tcb_entry_t *os_create_edf_task(uint8_t env, int (*pr_addr)(tcb_pt_t *), timer_t deadline)
+{
+    tcb_entry_t *handle;
+    K_LOCK();
+    handle = os_create_task(OS_EDF_PRIO, env, pr_addr);
+    if ((tcb_entry_t *)Q_NULL != handle)
+    {
+        handle->flags       |= TCB_EDF;
+        handle->rel_deadline = deadline;
+        handle->deadline     = get_os_ticks() + deadline;
+    }
+    K_UNLOCK();
+    return( handle );
+}
+#endif
+
+#if (PICO_PERIODIC)
+/**
+ *
+ *********************************************************************
+ *
+ * Allocate a periodic task, and schedule its first release. The task
+ *	is made ready phase ticks from now, then once every period; it
+ *	doesn't need to be resumed. The task waits for each release with
+ *	PT_WAIT_NEXT_PERIOD. Releases are absolute, so dispatch latency
+ *	shows up as jitter on one period rather than as drift.
+ *
+ * \param prio		task priority
+ * \param env 		task 'environment' variable
+ * \param pr_addr	task function pointer
+ * \param period	ticks between releases, at least 1
+ * \param phase		ticks to the first release
+ *
+ * \return 	 		pointer to the tcb; NULL if none available, or the
+ *					period is 0
+ *
+ \code
+ #include pico.h
+
+ int
+ mySampler(tcb_pt_t *pt)
+ {
+	PT_BEGIN(pt);
+	FOREVER
+	{
+		take a sample...
+		PT_WAIT_NEXT_PERIOD(pt);
+	}
+	PT_END(pt);
+ }
+
+ void
+ anyfunc(void)
+ {
+	os_create_periodic_task(myPrioLevel, mytask_env, mySampler, 10 * T_ONE_MS, 0);
+ }
+ \endcode
+ *
+ */
+tcb_entry_t *os_create_periodic_task(uint8_t prio, uint8_t env, int (*pr_addr)(tcb_pt_t *),
+                                     timer_t period, timer_t phase)
+{
+    tcb_entry_t *handle;
+
+    if (0 == period)
+    {
+        return((tcb_entry_t *)Q_NULL);
+    }
+    K_LOCK();
+    handle = os_create_task(prio, env, pr_addr);
+    if ((tcb_entry_t *)Q_NULL != handle)
+    {
+        handle->period  = period;
+        handle->release = get_os_ticks() + phase;
+        if (0 == phase)
+        {
+            os_resume_task(handle);
+        }
+        else
+        {
+            os_delay(handle, phase);
+        }
     }
+    K_UNLOCK();
     return( handle );
 }
 
+/**
+ *
+ *********************************************************************
+ *
+ * Advance a periodic task to its next release. Unless the release has
+ *	already passed, the task's timer is set to expire on it. A job still
+ *	running at its next release is an overrun; the task is released
+ *	again at once, and any further periods it ran through are skipped
+ *	and counted as overruns too. Called by PT_WAIT_NEXT_PERIOD.
+ *
+ * \param	task		pointer to the Task Control Block
+ *
+ * \return 	none
+ */
+void os_wait_next_period(tcb_entry_t *task)
+{
+    timer_t now = get_os_ticks();
+    timer_t skip;
+
+    task->release += task->period;
+    if (!tick_reached(now, task->release))
+    {
+        os_delay(task, task->release - now);
+        return;
+    }
+    K_LOCK();
+    skip 			= (timer_t)(now - task->release) / task->period;
+    task->release  += skip * task->period;
+    task->overruns += (uint16_t)(skip + 1);
+#if (PICO_EDF)
+    k_edf_done(task);
+#endif
+    k_task_unlink(task);
+    os_stop_task_timer(task);
+    task->flags    |= TCB_TIMEOUT;
+    k_task_release(task, task->release);
+    K_UNLOCK();
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Record a periodic task's release jitter, the ticks from its release
+ *	to its first dispatch. Called by PT_WAIT_NEXT_PERIOD.
+ *
+ * \param	task		pointer to the Task Control Block
+ *
+ * \return 	none
+ */
+void os_period_started(tcb_entry_t *task)
+{
+    task->jitter = get_os_ticks() - task->release;
+    if (task->jitter > task->jitter_max)
+    {
+        task->jitter_max = task->jitter;
+    }
+}
+#endif
+
 /**
  *
  *********************************************************************
@@ -372,29 +888,17 @@ tcb_entry_t *os_create_task(uint8_t prio, uint8_t env, int (*pr_addr)(tcb_pt_t *
  */
 void os_resume_task(tcb_entry_t *tcbp)
 {
-    tcb_entry_t *pReadyList;
-    /*
-     * remove the task from any queue it's waiting on
-     * 	insert it onto the ready queue
-     */
-    kq_ndelete( (k_list_t *)tcbp );
-    pReadyList = (tcb_entry_t *)k_ready_list.next;
-    while( &k_ready_list != (k_list_t *)pReadyList )
-    {
-        if((pReadyList->flags & PRIOMASK) > (tcbp->flags & PRIOMASK))
-        {
-            break;
-        }
-        pReadyList = (tcb_entry_t *)pReadyList->tcb_link.next;
-    }
-    kq_qinsert((k_list_t *)pReadyList->tcb_link.last, (k_list_t *)tcbp);
+    K_LOCK();
+    OS_TRACE(TR_RESUME, tcbp, 0);
+    k_task_release(tcbp, get_os_ticks());
+    K_UNLOCK();
 }
 
 /**
  *
  *********************************************************************
  *
- * Remove a task from any queue it's waiting on.
+ * Remove a task from any queue it's waiting on, and stop its timer.
  *
  * \param  	tcbp	 pointer to the Task Control Block
  *
@@ -422,7 +926,13 @@ void os_resume_task(tcb_entry_t *tcbp)
  */
 void os_kill_task(tcb_entry_t *tcbp)
 {
-    kq_ndelete((k_list_t *)tcbp);
+    K_LOCK();
+    if (TCB_FREE != (tcbp->flags & TCB_FREE))
+    {
+        k_task_unlink(tcbp);
+        os_stop_task_timer(tcbp);
+    }
+    K_UNLOCK();
 }
 
 /**
@@ -466,408 +976,2291 @@ void os_suspend_task(k_list_t *queue, k_list_t *node)
      * remove the task from any queue it's on
      *	then insert it to the given one ...
      */
-    kq_ndelete(node);
+    K_LOCK();
+#if (PICO_EDF)
+    k_edf_done((tcb_entry_t *)node);
+#endif
+    k_task_unlink((tcb_entry_t *)node);
     kq_qinsert(queue, node);
+    OS_TRACE(TR_SUSPEND, (tcb_entry_t *)node, queue);
+    K_UNLOCK();
 }
 
 /**
  *
  *********************************************************************
  *
- * Search through the task control block structure for the first
- *	non-used tcb. In pico, a number of tcbs are statically allocated,
- *	to create a task, we need to find a free control block.
+ * Block a task on a wait queue kept in priority order. The task goes
+ *	behind any waiters of the same or higher priority, so the head of
+ *	the queue is always the one to wake next. A timeout other than
+ *	NO_TIMEOUT resumes the task with task_timer_expired() set.
  *
- * \param	none
+ * \param 	queue		pointer to the wait queue
+ * \param	task		the task to block
+ * \param	timeout		ticks to wait; NO_TIMEOUT waits forever
  *
- * \return 	tcb_entry_t *; NULL if none available
+ * \return 	none
  */
-tcb_entry_t *os_get_tcb(void)
+void os_wait_prio(k_list_t *queue, tcb_entry_t *task, timer_t timeout)
 {
-    uint8_t index = 0;
-    do
+    k_list_t *node;
+
+    K_LOCK();
+    os_delay(task, timeout);
+    for (node = queue->last; queue != node; node = node->last)
     {
-        if (TCB_FREE == (tcb[index].flags & TCB_FREE))
+        if (((tcb_entry_t *)node)->prio <= task->prio)
         {
-            tcb[index].flags &= ~TCB_FREE;
-            return( &tcb[index] );
+            break;
         }
-	} while (++index < N_TASKS);
-    return((tcb_entry_t *)Q_NULL );
+    }
+    kq_qinsert(node, (k_list_t *)task);
+    OS_TRACE(TR_SUSPEND, task, queue);
+    K_UNLOCK();
 }
 
 /**
  *
  *********************************************************************
  *
- * Return a tcb to the task control block structure. This is useful
- *	for dynamic tasks that might be created on need, and returned
- *	on completion (spawn).
+ * Wake the task at the head of a wait queue. Its timeout is cancelled.
  *
- * \param 	tcbp	pointer to the Task Control Block
+ * \param 	queue		pointer to the wait queue
  *
- * \return 	none
+ * \return 	the task woken; NULL if none was waiting
  */
-void os_release_tcb(tcb_entry_t *tcbp)
+tcb_entry_t *os_wake_first(k_list_t *queue)
 {
-	os_kill_task(tcbp);
-    tcbp->tcb_link.next = (k_list_t *)tcbp;
-    tcbp->tcb_link.last = (k_list_t *)tcbp;
-    tcbp->timer        =  0;
-    tcbp->gptimer      =  0;
-    tcbp->flags        = (TCB_FREE | PRIOMASK);
-    tcbp->task_env     =  0;
+    tcb_entry_t *task;
+
+    K_LOCK();
+    task = (tcb_entry_t *)queue->next;
+    if ((k_list_t *)task == queue)
+    {
+        task = (tcb_entry_t *)Q_NULL;
+    }
+    else
+    {
+        os_stop_task_timer(task);
+        os_resume_task(task);
+    }
+    K_UNLOCK();
+    return (task);
 }
 
 /**
  *
  *********************************************************************
  *
- * Get a 'handle' for the selected task
- *
- * \param pr_addr	task function pointer
- *
- * \return 	 		pointer to the tcb; NULL if none available
- *
- * The following example illustrates getting a handle for a particular task
- *
- *	NOTE: The scheduler must have been initialized first.
+ * Wake every task on a wait queue, in queue order.
  *
- \code
- #include pico.h
-
- int someTask(tcb_pt_t *);
-
- void
- anyfunc(void)
- {
-	tcb_entry_t t_handle = os_get_task_handle(someTask);
-	if ((tcb_pt_t *)NULL != t_handle){
-		we have a good handle
-	}
-	else {
-		handle the error if required here...
-	}
-}
- \endcode
+ * \param 	queue		pointer to the wait queue
  *
+ * \return 	none
  */
-tcb_entry_t *os_get_task_handle(int (*pr_addr)(tcb_pt_t *))
+void os_wake_all(k_list_t *queue)
 {
-	uint8_t index = 0;
-	do
-	{
-		if (TCB_FREE != (tcb[index].flags & TCB_FREE))
-		{
-			if (tcb[index].p_thread == pr_addr)
-			{
-				return (&tcb[index]);
-			}
-		}
-	} while (++index < N_TASKS);
-	return ((tcb_entry_t *)Q_NULL);
+    while ((tcb_entry_t *)Q_NULL != os_wake_first(queue))
+    {
+    }
 }
 
+#if (PICO_NOTIFY)
 /**
  *
  *********************************************************************
  *
- * Return a fletcher 16 checksum for the given data block. This is a useful
- *	function generally, and can provide results approximating a 16 bit CRC.
+ * Notify a task. The action is taken on the task's notification
+ *	value, and the notification is left pending for the task. If it's
+ *	waiting in PT_WAIT_NOTIFY() it's made ready at once; no queue is
+ *	searched. Not for interrupts; an interrupt posts an event, and a
+ *	function bound to it may notify.
  *
- * \param 	buf		pointer to the data block
- * \param 	len		length of the data block
+ * \param 	task		the task to notify
+ * \param	value		the value for the action
+ * \param	action		OS_NOTIFY_BITS, _INC, _WRITE or _WRITE_NEW
  *
- * \return 	16 bit Fletcher's checksum
+ * \return 	OS_SYNC_OK; OS_SYNC_ERR if OS_NOTIFY_WRITE_NEW found the
+ *			last notification still pending
+ */
+uint8_t os_notify(tcb_entry_t *task, uint32_t value, uint8_t action)
+{
+    K_LOCK();
+    switch (action)
+    {
+        case OS_NOTIFY_BITS:
+            task->notify |= value;
+            break;
+        case OS_NOTIFY_INC:
+            task->notify++;
+            break;
+        case OS_NOTIFY_WRITE_NEW:
+            if (task->notify_state & TCB_NOTIFY_PENDING)
+            {
+                K_UNLOCK();
+                return (OS_SYNC_ERR);
+            }
+            task->notify = value;
+            break;
+        default:
+            task->notify = value;
+            break;
+    }
+    if (task->notify_state & TCB_NOTIFY_WAITING)
+    {
+        os_stop_task_timer(task);
+        os_resume_task(task);
+    }
+    task->notify_state = TCB_NOTIFY_PENDING;
+    K_UNLOCK();
+    return (OS_SYNC_OK);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * The body of PT_WAIT_NOTIFY(), called again each time the task is
+ *	woken. A pending notification is taken, and TCB_TIMEOUT cleared;
+ *	otherwise the task leaves the ready list until os_notify() or the
+ *	timeout.
+ *
+ * \param 	value		where to put the value; may be NULL
+ * \param	clear		bits cleared from the value once it's taken
+ * \param 	timeout		ticks to wait; NOW to only try, NO_TIMEOUT to
+ *						wait forever
+ *
+ * \return 	OS_SYNC_OK		a notification was taken
+ *			OS_SYNC_WAIT	the task is waiting; return
+ *			OS_SYNC_TIMEOUT	timed out; TCB_TIMEOUT is set
+ */
+uint8_t os_notify_take(uint32_t *value, uint32_t clear, timer_t timeout)
+{
+    K_LOCK();
+    if (ME->notify_state & TCB_NOTIFY_PENDING)
+    {
+        /*
+         * a timeout that ran out before the notification was
+         * taken doesn't count
+         */
+        ME->notify_state = 0;
+        ME->flags       &= ~TCB_TIMEOUT;
+        os_stop_task_timer(ME);
+        if ((uint32_t *)0 != value)
+        {
+            *value = ME->notify;
+        }
+        ME->notify &= ~clear;
+        K_UNLOCK();
+        return (OS_SYNC_OK);
+    }
+    ME->notify_state = 0;
+    if (task_timer_expired(ME) || (NOW == timeout))
+    {
+        ME->flags |= TCB_TIMEOUT;
+        K_UNLOCK();
+        return (OS_SYNC_TIMEOUT);
+    }
+    ME->notify_state = TCB_NOTIFY_WAITING;
+    os_delay(ME, timeout);
+    K_UNLOCK();
+    return (OS_SYNC_WAIT);
+}
+#endif
+
+#if (PICO_ISR)
+/**
+ *
+ *********************************************************************
+ *
+ * Post an interrupt event. This is the one kernel call an interrupt
+ *	may make: it stores the argument and sets the event's bit, with no
+ *	lock and no list touched, so interrupts are never held off for the
+ *	kernel. The scheduler loop hands the event on; see k_isr_drain().
+ *	Posts before the loop gets to it are one event, with the last
+ *	argument.
+ *
+ * \param 	id			the event, 0 to OS_ISR_EVENTS - 1; 0 is served first
+ * \param	arg			the argument, read by os_isr_arg()
+ *
+ * \return 	none
+ */
+void os_isr_post(uint8_t id, uint32_t arg)
+{
+    k_isr.ev[id].arg = arg;
+    os_atomic_or32(&k_isr.map[id >> 5], 0x80000000UL >> (id & 31));
+#if (OS_ISR_EVENTS > 32)
+    os_atomic_or32(&k_isr.grp, 0x80000000UL >> (id >> 5));
+#endif
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Bind a function to an interrupt event. The scheduler loop calls it
+ *	with the event and its argument, in task context, before waking
+ *	the tasks waiting on the event. It must not block.
+ *
+ * \param 	id			the event
+ * \param	fn			the function; NULL to unbind
+ *
+ * \return 	none
+ */
+void os_isr_bind(uint8_t id, os_isr_fn fn)
+{
+    K_LOCK();
+    k_isr.ev[id].fn = fn;
+    K_UNLOCK();
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * The body of os_isr_wait(), called again each time the task is
+ *	woken. An event that came while no task waited is kept for the
+ *	next. Every waiting task is woken, and the first to run takes it.
+ *
+ * \param 	id			the event
+ * \param 	timeout		ticks to wait; NOW to only try, NO_TIMEOUT to
+ *						wait forever
+ *
+ * \return 	OS_SYNC_OK		the event happened
+ *			OS_SYNC_WAIT	the task is waiting; return
+ *			OS_SYNC_TIMEOUT	timed out; TCB_TIMEOUT is set
+ */
+uint8_t os_isr_take(uint8_t id, timer_t timeout)
+{
+    os_isr_t *ev = &k_isr.ev[id];
+
+    K_LOCK();
+    if (ev->pending)
+    {
+        ev->pending = 0;
+        K_UNLOCK();
+        return (OS_SYNC_OK);
+    }
+    if (task_timer_expired(ME) || (NOW == timeout))
+    {
+        ME->flags |= TCB_TIMEOUT;
+        K_UNLOCK();
+        return (OS_SYNC_TIMEOUT);
+    }
+    os_wait_prio(&ev->wait, ME, timeout);
+    K_UNLOCK();
+    return (OS_SYNC_WAIT);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * The argument last posted with an interrupt event.
+ *
+ * \param 	id			the event
+ *
+ * \return 	the argument
+ */
+uint32_t os_isr_arg(uint8_t id)
+{
+    return (k_isr.ev[id].arg);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Hand the posted interrupt events on, lowest id first. Each bitmap
+ *	word is taken whole with an atomic exchange, so an interrupt that
+ *	posts meanwhile either lands in the word taken or is left for the
+ *	next pass; a pass is bounded by OS_ISR_EVENTS. An event runs its
+ *	bound function, then wakes its waiters.
+ *
+ * \param	none
+ *
+ * \return 	none
+ */
+static void k_isr_drain(void)
+{
+    os_isr_t *ev;
+    uint32_t  words;
+    uint32_t  bits;
+    uint8_t   word;
+    uint8_t   id;
+
+    if (!k_isr_posted())
+    {
+        return;
+    }
+#if (OS_ISR_EVENTS > 32)
+    words = os_atomic_xchg32(&k_isr.grp, 0);
+#else
+    words = 0x80000000UL;
+#endif
+    while (0 != words)
+    {
+        word   = os_clz32(words);
+        words &= ~(0x80000000UL >> word);
+        bits   = os_atomic_xchg32(&k_isr.map[word], 0);
+        while (0 != bits)
+        {
+            id    = os_clz32(bits);
+            bits &= ~(0x80000000UL >> id);
+            id   += (uint8_t)(word << 5);
+            ev    = &k_isr.ev[id];
+            OS_TRACE(TR_ISR, (tcb_entry_t *)Q_NULL, (uintptr_t)id);
+            if ((os_isr_fn)0 != ev->fn)
+            {
+                ev->fn(id, ev->arg);
+            }
+            K_LOCK();
+            ev->pending = 1;
+            os_wake_all(&ev->wait);
+            K_UNLOCK();
+        }
+    }
+}
+#endif
+
+/**
+ *
+ *********************************************************************
+ *
+ * Change a task's priority. A ready task moves to the tail of its new
+ *	level. Used for priority inheritance; a task waiting on a queue
+ *	keeps its place there.
+ *
+ * \param 	task		pointer to the Task Control Block
+ * \param	prio		the new priority
+ *
+ * \return 	none
+ */
+void os_set_task_prio(tcb_entry_t *task, uint8_t prio)
+{
+    prio &= PRIOMASK;
+    if (prio == task->prio)
+    {
+        return;
+    }
+    K_LOCK();
+    if (TCB_READY == (task->flags & TCB_READY))
+    {
+        k_ready_remove(task);
+        task->prio = prio;
+        k_ready_insert(task);
+    }
+    else
+    {
+        task->prio = prio;
+    }
+    K_UNLOCK();
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Work out the priority of a task that holds mutexes or write locks:
+ *	its own, or that of the first waiter on any lock it holds if
+ *	that's higher. If it changes while the task waits on a lock in
+ *	turn, its place in that queue moves, and the owner there is worked
+ *	out again, and so on down the chain.
+ *
+ * \param 	task		pointer to the Task Control Block
+ *
+ * \return 	none
+ */
+void os_pi_reprio(tcb_entry_t *task)
+{
+    os_pi_t  *pi;
+    k_list_t *node;
+    uint8_t   prio;
+
+    K_LOCK();
+    while ((tcb_entry_t *)Q_NULL != task)
+    {
+        prio = task->base_prio;
+        for (pi = task->pi_held; (os_pi_t *)0 != pi; pi = pi->next)
+        {
+            prio = k_pi_top(&pi->wait, prio);
+            if (Q_NULL != pi->rd_wait)
+            {
+                prio = k_pi_top(pi->rd_wait, prio);
+            }
+        }
+        if ((prio == task->prio) || ((os_pi_t *)0 == task->pi_wait))
+        {
+            os_set_task_prio(task, prio);
+            break;
+        }
+        task->prio = prio;
+        kq_ndelete((k_list_t *)task);
+        for (node = task->pi_queue->last; task->pi_queue != node; node = node->last)
+        {
+            if (((tcb_entry_t *)node)->prio <= prio)
+            {
+                break;
+            }
+        }
+        kq_qinsert(node, (k_list_t *)task);
+        task = task->pi_wait->owner;
+    }
+    K_UNLOCK();
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Give a mutex or write lock to a task. It goes on the task's list of
+ *	locks held, the task's own priority is noted with the first, and
+ *	those still waiting lend it theirs. The caller sets the count.
+ *
+ * \param 	task		pointer to the Task Control Block
+ * \param	pi			the lock
+ *
+ * \return 	none
+ */
+void os_pi_acquire(tcb_entry_t *task, os_pi_t *pi)
+{
+    K_LOCK();
+    if ((os_pi_t *)0 == task->pi_held)
+    {
+        task->base_prio = task->prio;
+    }
+    pi->owner     = task;
+    pi->next      = task->pi_held;
+    task->pi_held = pi;
+    os_pi_reprio(task);
+    K_UNLOCK();
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Take a mutex or write lock from its owner, whatever its count, work
+ *	out the owner's priority from the locks it has left, and hand the
+ *	lock on; see os_pi_handoff().
+ *
+ * \param 	task		the owner
+ * \param	pi			the lock
+ *
+ * \return 	none
+ */
+void os_pi_release(tcb_entry_t *task, os_pi_t *pi)
+{
+    os_pi_t **link;
+
+    K_LOCK();
+    for (link = &task->pi_held; pi != *link; link = &(*link)->next)
+    {
+    }
+    *link     = pi->next;
+    pi->owner = (tcb_entry_t *)Q_NULL;
+    pi->count = 0;
+    os_pi_reprio(task);
+    os_pi_handoff(pi);
+    K_UNLOCK();
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Hand a free lock to its first waiter, which owns it from now, with a
+ *	count of 0 until it runs and takes it, so no task that runs first
+ *	can take it instead. With no waiter, a reader/writer lock's readers
+ *	are woken.
+ *
+ * \param	pi			the lock
+ *
+ * \return 	none
+ */
+void os_pi_handoff(os_pi_t *pi)
+{
+    tcb_entry_t *next;
+
+    K_LOCK();
+    next = os_wake_first(&pi->wait);
+    if ((tcb_entry_t *)Q_NULL != next)
+    {
+        os_pi_acquire(next, pi);
+    }
+    else if (Q_NULL != pi->rd_wait)
+    {
+        os_wake_all(pi->rd_wait);
+    }
+    K_UNLOCK();
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Take the oldest free tcb from the free list. In pico, a number of
+ *	tcbs are statically allocated; free ones are linked through
+ *	tcb_link, so taking one does not depend on N_TASKS.
+ *
+ * \param	none
+ *
+ * \return 	tcb_entry_t *; NULL if none available
+ */
+tcb_entry_t *os_get_tcb(void)
+{
+    tcb_entry_t *tcbp = (tcb_entry_t *)Q_NULL;
+    K_LOCK();
+    if (k_free_list.next != &k_free_list)
+    {
+        tcbp = (tcb_entry_t *)k_free_list.next;
+        kq_ndelete((k_list_t *)tcbp);
+        tcbp->flags &= ~TCB_FREE;
+    }
+    K_UNLOCK();
+    return( tcbp );
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Return a tcb to the task control block structure. This is useful
+ *	for dynamic tasks that might be created on need, and returned
+ *	on completion (spawn).
+ *
+ * \param 	tcbp	pointer to the Task Control Block
+ *
+ * \return 	none
+ */
+void os_release_tcb(tcb_entry_t *tcbp)
+{
+    K_LOCK();
+	os_kill_task(tcbp);
+    /*
+     * let go of the locks it holds, as their owner won't
+     */
+    while ((os_pi_t *)0 != tcbp->pi_held)
+    {
+        os_pi_release(tcbp, tcbp->pi_held);
+    }
+    /*
+     * off the free list if it was already free
+     */
+    kq_ndelete((k_list_t *)tcbp);
+#if (OS_TASK_HASH)
+    k_hash_remove(tcbp);
+#endif
+    tcbp->timer        =  0;
+    tcbp->gptimer      =  get_os_ticks();
+    tcbp->flags        =  TCB_FREE;
+    tcbp->prio         =  OS_LO_PRIO;
+    tcbp->base_prio    =  OS_LO_PRIO;
+    tcbp->pi_held      =  0;
+    tcbp->pi_wait      =  0;
+    tcbp->pi_queue     =  Q_NULL;
+    tcbp->task_env     =  0;
+#if (PICO_ARENA)
+    os_arena_reset(tcbp);
+    tcbp->arena_pool   =  0;
+    tcbp->arena_peak   =  0;
+#endif
+#if (PICO_NOTIFY)
+    tcbp->notify_state =  0;
+    tcbp->wait_mode    =  0;
+    tcbp->notify       =  0;
+    tcbp->wait_bits    =  0;
+#endif
+#if (PICO_EDF)
+    tcbp->rel_deadline =  0;
+    tcbp->dl_miss      =  0;
+#endif
+#if (PICO_PERIODIC)
+    tcbp->period       =  0;
+    tcbp->jitter       =  0;
+    tcbp->jitter_max   =  0;
+    tcbp->overruns     =  0;
+#endif
+#if (PICO_SMP)
+    tcbp->affinity     =  OS_CORE_ALL;
+#endif
+#if (PICO_STATS)
+    tcbp->run_cycles   =  0;
+    tcbp->run_max      =  0;
+    tcbp->run_count    =  0;
+#endif
+    kq_qinsert(k_free_list.last, (k_list_t *)tcbp);
+    K_UNLOCK();
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Get a 'handle' for the selected task. With OS_TASK_HASH, tasks made
+ *	by os_create_task() are found through a hash of their function,
+ *	oldest first, rather than by scanning tcb[]; see k_hash_find().
+ *
+ * \param pr_addr	task function pointer
+ *
+ * \return 	 		pointer to the tcb; NULL if none available
+ *
+ * The following example illustrates getting a handle for a particular task
+ *
+ *	NOTE: The scheduler must have been initialized first.
+ *
+ \code
+ #include pico.h
+
+ int someTask(tcb_pt_t *);
+
+ void
+ anyfunc(void)
+ {
+	tcb_entry_t t_handle = os_get_task_handle(someTask);
+	if ((tcb_pt_t *)NULL != t_handle){
+		we have a good handle
+	}
+	else {
+		handle the error if required here...
+	}
+}
+ \endcode
+ *
+ */
+tcb_entry_t *os_get_task_handle(int (*pr_addr)(tcb_pt_t *))
+{
+	tcb_entry_t *handle = (tcb_entry_t *)Q_NULL;
+#if (OS_TASK_HASH)
+	K_LOCK();
+	handle = k_hash_find(pr_addr);
+#else
+	os_task_idx_t index = 0;
+
+	K_LOCK();
+	do
+	{
+		if (TCB_FREE != (tcb[index].flags & TCB_FREE))
+		{
+			if (tcb[index].p_thread == pr_addr)
+			{
+				handle = &tcb[index];
+				break;
+			}
+		}
+	} while (++index < N_TASKS);
+#endif
+	K_UNLOCK();
+	return (handle);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Get a task's index in the task table, a compact name for it, as
+ *	used by the event trace.
+ *
+ * \param	task		pointer to the Task Control Block
+ *
+ * \return 	0 to N_TASKS - 1
+ */
+os_task_idx_t os_get_task_index(tcb_entry_t *task)
+{
+    return ((os_task_idx_t)(task - tcb));
+}
+
+#if (PICO_STATS)
+/**
+ *
+ *********************************************************************
+ *
+ * Get a core's run time statistics. Times are in os_cycle_count()
+ *	units, and every pass of the core's loop is split between the
+ *	task timers, the scheduler hooks, the task it ran, or idle. Time
+ *	in the timer hooks is kept on core 0. The per task figures are in
+ *	the tcb; see gettask_cycles(), gettask_max() and gettask_runs().
+ *
+ * The counters are updated by the core without a lock, so a reading
+ *	taken from another core may be a pass out of date.
+ *
+ * \param	core		the core's number; 0 without PICO_SMP
+ *
+ * \return 	os_stats_t *; NULL for a core out of range
+ */
+os_stats_t *os_get_stats(uint8_t core)
+{
+    if (core >= OS_N_CORES)
+    {
+        return ((os_stats_t *)Q_NULL);
+    }
+    return (&k_stats[core]);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Clear the run time statistics, for every core and every task, to
+ *	start a fresh measurement.
+ *
+ * \param	none
+ *
+ * \return 	none
+ */
+void os_stats_reset(void)
+{
+    os_task_idx_t index = 0;
+    uint8_t       core;
+
+    K_LOCK();
+    for (core = 0; core < OS_N_CORES; core++)
+    {
+        k_stats[core].tasks       = 0;
+        k_stats[core].timers      = 0;
+        k_stats[core].loop_hooks  = 0;
+        k_stats[core].timer_hooks = 0;
+        k_stats[core].idle        = 0;
+        k_stats[core].passes      = 0;
+        k_stats[core].last        = os_cycle_count();
+    }
+    do
+    {
+        tcb[index].run_cycles = 0;
+        tcb[index].run_max    = 0;
+        tcb[index].run_count  = 0;
+	} while (++index < N_TASKS);
+    K_UNLOCK();
+}
+#endif
+
+/**
+ *
+ *********************************************************************
+ *
+ * Return a fletcher 16 checksum for the given data block. This is a useful
+ *	function generally, and can provide results approximating a 16 bit CRC.
+ *
+ * \param 	buf		pointer to the data block
+ * \param 	len		length of the data block
+ *
+ * \return 	16 bit Fletcher's checksum
  */
 uint16_t calc_fletcher16(uint8_t const *buf, uint16_t len)
 {
-	uint16_t sum1 = 0;
-	uint16_t sum2 = 0;
-	uint16_t index;
+	uint16_t sum1 = 0;
+	uint16_t sum2 = 0;
+	uint16_t index;
+
+	for (index = 0; index < len; index++)
+	{
+		sum1 = (sum1 + buf[index]) % 255;
+		sum2 = (sum1 + sum2) % 255;
+	}
+	return ((sum2 << 8) | sum1);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Add a function to the timer hook list, invoked on every timer tick.
+ *	Functions are added LIFO at OS_HOOK_PRIO. See os_add_hook_rate().
+ *
+ * \param	node		is the caller's t_hook_entry_t structure
+ * \param	function	is a pointer to caller's function
+ *
+ * \return	none
+ */
+void os_add_timerhook(t_hook_entry_t *node, void (*tfun_addr)(void))
+{
+    os_add_hook_rate(&k_thook_list, node, tfun_addr, 1, 0, OS_HOOK_PRIO);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Add a function to the timer hook list, invoked once every period
+ *	ticks. See os_add_hook_rate().
+ *
+ * \param	node		is the caller's t_hook_entry_t structure
+ * \param	function	is a pointer to caller's function
+ * \param	period		ticks between calls
+ * \param	phase		ticks to delay the first call by
+ * \param	prio		order among hooks due on the same tick
+ *
+ * \return	none
+ */
+void os_add_timerhook_rate(t_hook_entry_t *node, void (*tfun_addr)(void),
+                           uint16_t period, uint16_t phase, uint8_t prio)
+{
+    os_add_hook_rate(&k_thook_list, node, tfun_addr, period, phase, prio);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Add a function to the scheduler hook list. Functions are added LIFO
+ *	at OS_HOOK_PRIO, and invoked at each pass through the main
+ *	scheduling loop. Kernel hook
+ *	functions do not have the ability to preempt tasks, but they can run
+ *	more often than the timed granularity of a single tick. At the same
+ *	time, while a convention task could run more often by leaving it on
+ *	the ready queue, it would preempt everyone behind it.
+ *
+ * \param 	node		is the caller's t_hook_entry_t structure
+ * \param 	function	is a pointer to the caller's function
+ *
+ * \return	none
+ */
+void os_add_schedhook(t_hook_entry_t *node, void (*tfun_addr)(void))
+{
+    os_add_hook_rate(&k_loop_list, node, tfun_addr, 1, 0, OS_HOOK_PRIO);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Add a function to the scheduler hook list, invoked once every period
+ *	passes through the main scheduling loop. See os_add_hook_rate().
+ *
+ * \param 	node		is the caller's t_hook_entry_t structure
+ * \param 	function	is a pointer to the caller's function
+ * \param	period		passes between calls
+ * \param	phase		passes to delay the first call by
+ * \param	prio		order among hooks due on the same pass
+ *
+ * \return	none
+ */
+void os_add_schedhook_rate(t_hook_entry_t *node, void (*tfun_addr)(void),
+                           uint16_t period, uint16_t phase, uint8_t prio)
+{
+    os_add_hook_rate(&k_loop_list, node, tfun_addr, period, phase, prio);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * This is a low level function to add a hook to any hook list, to be
+ *	invoked on every call of os_hook_handler(). The list is now a
+ *	t_hook_list_t, not the t_hook_entry_t head it once was.
+ *
+ * \param 	list		is the hook list
+ * \param	node 	    the node to insert
+ * \param	function	is a pointer to the caller's function
+ *
+ * \return	none
+ */
+void os_add_hook(t_hook_list_t *list, t_hook_entry_t *node, void (*tfun_addr)(void))
+{
+    os_add_hook_rate(list, node, tfun_addr, 1, 0, OS_HOOK_PRIO);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * This is a low level function to add a hook to any hook list, to be
+ *	invoked once every period calls of os_hook_handler(). The first
+ *	call comes phase calls after the next one, so hooks of the same
+ *	period can be spread over different ticks.
+ *
+ * Hooks are kept in the order they fall due, so a call of the handler
+ *	only touches the hooks it runs. Hooks due on the same call run
+ *	lowest prio first, and within a priority the one added last runs
+ *	first. The hook starts out enabled.
+ *
+ * \param 	list		is the hook list
+ * \param	node 	    the node to insert
+ * \param	function	is a pointer to the caller's function
+ * \param	period		calls between invocations; 0 is taken as 1
+ * \param	phase		calls to delay the first invocation by, less
+ *						than period
+ * \param	prio		order among hooks due on the same call
+ *
+ * \return	none
+ *
+ * The following example hooks a once a second housekeeping function
+ *	to the timer tick.
+ *
+ \code
+ #include pico.h
+
+ t_hook_entry_t housekeeping;
+
+ void
+ anyfunc(void)
+ {
+	os_add_timerhook_rate(&housekeeping, myOncePerSecond, T_ONE_SEC, 0, OS_HOOK_PRIO);
+ }
+ \endcode
+ *
+ */
+void os_add_hook_rate(t_hook_list_t *list, t_hook_entry_t *node, void (*tfun_addr)(void),
+                      uint16_t period, uint16_t phase, uint8_t prio)
+{
+    os_irq_t s;
+
+    if (0 == period)
+    {
+        period = 1;
+    }
+    K_LOCK();
+    s = os_irq_save();
+    node->p_timerhook = tfun_addr;
+    node->period      = period;
+    node->prio        = prio;
+    node->enabled     = 1;
+    node->due         = list->count + 1 + (phase % period);
+    k_hook_insert(list, &list->hooks, node, 1);
+    k_hook_gen++;
+    os_irq_restore(s);
+    K_UNLOCK();
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Remove a function from the timer hook list. This function allows an
+ *	application to dynamically hook and unhook to the system timer
+ *	interrupt as necessary.
+ *
+ * \param	node		is the caller's t_hook_entry_t structure
+ *
+ * \return 	none
+ */
+void os_release_timerhook(t_hook_entry_t *node)
+{
+    os_release_hook(node);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Remove a function from the system hook list. This function allows an
+ *	application to dynamically hook and unhook to the kernel main loop
+ *	as necessary.
+ *
+ * \param	node		is the caller's t_hook_entry_t structure
+ *
+ * \return	none
+ */
+void os_release_schedhook(t_hook_entry_t *node)
+{
+    os_release_hook(node);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to release a hook node from whichever list it's
+ *	on. The hook lists are doubly linked, so there's no search, and
+ *	unlike before there's no list to pass.
+ *
+ * \param	node 	    is the node to remove
+ *
+ * \return	none
+ */
+void os_release_hook(t_hook_entry_t *node)
+{
+    os_irq_t s;
+
+    K_LOCK();
+    s = os_irq_save();
+    kq_ndelete(&node->t_hook_link);
+    k_hook_gen++;
+    os_irq_restore(s);
+    K_UNLOCK();
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Enable or disable a hook. A disabled hook keeps its place and phase
+ *	on its list, but isn't invoked.
+ *
+ * \param	node 	    is the caller's t_hook_entry_t structure
+ *
+ * \return	none
+ */
+void os_enable_hook(t_hook_entry_t *node)
+{
+    node->enabled = 1;
+}
+
+void os_disable_hook(t_hook_entry_t *node)
+{
+    node->enabled = 0;
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to link a hook onto its list by the call it's due
+ *	on, then by priority. A hook being added goes ahead of others of
+ *	its priority due on the same call (LIFO); a hook that has just run
+ *	goes behind them, so hooks of one rate keep their order.
+ *
+ * The search starts after from, the list head or a hook known to go
+ *	ahead of the node.
+ *
+ * \param 	list		is the hook list
+ * \param	from		where to start looking
+ * \param	node 	    the node to insert
+ * \param	lifo		non-zero to go ahead of equal hooks
+ *
+ * \return	none
+ */
+static void k_hook_insert(t_hook_list_t *list, k_list_t *from, t_hook_entry_t *node, uint8_t lifo)
+{
+    k_list_t       *pos;
+    t_hook_entry_t *hook;
+
+    for (pos = from->next; &list->hooks != pos; pos = pos->next)
+    {
+        hook = (t_hook_entry_t *)pos;
+        if (hook->due != node->due)
+        {
+            if (!tick_reached(node->due, hook->due))
+            {
+                break;
+            }
+        }
+        else if (lifo ? (hook->prio >= node->prio) : (hook->prio > node->prio))
+        {
+            break;
+        }
+    }
+    kq_qinsert(pos->last, &node->t_hook_link);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to insert node as the next element of a queue
+ *	(doubly linked list), or after a given node
+ *
+ * \param	queue		is a pointer to the queue
+ * \param	node		is the node to insert
+ *
+ * \return 	none
+ */
+void kq_qinsert(k_list_t *queue, k_list_t *node)
+{
+    node->next 		   = queue->next;
+    node->last 		   = queue;
+    queue->next 	   = node;
+    node->next->last   = node;
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to delete and return the next element of a queue
+ *	(doubly linked list). The neighbors to the deleted node are relinked,
+ *	and a pointer to the deleted node is returned.
+ *
+ * \param	queue    	is a pointer to the queue
+ * \param	node		is the node to insert
+ *
+ * \return 	deleted node; NULL if none
+ */
+k_list_t *kq_qdelete(k_list_t *queue)
+{
+    k_list_t *node;		/* the deleted node */
+    if (queue->next == queue )
+    {
+        return( Q_NULL );
+    }
+    node 				= queue->next;
+    queue->next 		= node->next;
+    queue->next->last 	= queue;
+    return( node );
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to delete a node from any queue (doubly linked list)
+ *	it's waiting on.
+ *
+ * \param	node		is the node to delete
+ *
+ * \return 	none
+ */
+void kq_ndelete(k_list_t *node)
+{
+    k_list_t *next_node;
+    k_list_t *last_node;
+    last_node 		= node->last;
+    next_node 		= node->next;
+    last_node->next = next_node;
+    next_node->last = last_node;
+    node->next 		= node->last = node;
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * kq_qinsert() and kq_ndelete() under the kernel lock, for queues that
+ *	tasks on more than one core share. Without PICO_SMP they're the
+ *	same as the plain calls.
+ *
+ * \param	queue		is a pointer to the queue
+ * \param	node		is the node to insert or delete
+ *
+ * \return 	none
+ */
+void kq_qinsert_safe(k_list_t *queue, k_list_t *node)
+{
+    K_LOCK();
+    kq_qinsert(queue, node);
+    K_UNLOCK();
+}
+
+void kq_ndelete_safe(k_list_t *node)
+{
+    K_LOCK();
+    kq_ndelete(node);
+    K_UNLOCK();
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to insert node as the next element of a singly
+ *	linked list. The node is inserted at the end (or next item) of
+ *	the list.
+ *
+ * \param	s_list    	is a pointer to the list
+ * \param	node		is the node to insert
+ *
+ * \return 	none
+ */
+void kq_slinsert(k_slist_t *s_list, k_slist_t *node)
+{
+    node->next 	 = s_list->next;
+    s_list->next = node;
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to delete and return the next element of a singly
+ *	linked list. kq_sldelete() traverses to the end of the list, and
+ *	deletes the last node. A pointer to that node is returned.
+ *
+ * \param 	s_list    	is a pointer to the list
+ *
+ * \return 	the deleted node; NULL if none
+ */
+k_slist_t *kq_sldelete(k_slist_t *s_list)
+{
+    k_slist_t *node;		/* the deleted node */
+    node = s_list->next;
+    if (SL_NULL != s_list->next)
+    {
+        s_list->next = node->next;
+    }
+    return( node );
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to delete a node from a singly linked list.
+ *	kq_slndelete() traverses the list, searching for the node. Once
+ *	found, the node is removed from the list.
+ *
+ * \param	s_list    	is a pointer to the list
+ * \param	node		is the node to delete
+ *
+ * \return 	none
+ */
+void kq_slndelete(k_slist_t *s_list, k_slist_t *node)
+{
+    k_slist_t *last_node;
+    for (last_node = s_list; SL_NULL != last_node->next; last_node = last_node->next)
+    {
+        if (last_node->next == node)
+        {
+            last_node->next = node->next;
+            node->next      = SL_NULL;
+            break;
+        }
+    }
+}
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to append a task to the ready list. The task
+ *	goes on the tail of the list for its priority level (FIFO), and
+ *	the level is marked ready in the priority map.
+ *
+ * \param	tcbp		pointer to the Task Control Block
+ *
+ * \return 	none
+ */
+static void k_ready_insert(tcb_entry_t *tcbp)
+{
+    k_ready_t *rq = k_rq_lock(tcbp);
+#if (PICO_SMP)
+    /*
+     * a running task is put back by its core when it returns
+     */
+    if (tcbp->running)
+    {
+        tcbp->running = TCB_RUN_READY;
+        k_rq_unlock(rq);
+        return;
+    }
+#endif
+#if (PICO_EDF)
+    if (TCB_EDF == (tcbp->flags & TCB_EDF))
+    {
+        k_edf_insert(&rq->band[tcbp->prio], tcbp);
+    }
+    else
+#endif
+    kq_qinsert(rq->band[tcbp->prio].last, (k_list_t *)tcbp);
+    k_rq_mark(rq, tcbp->prio);
+    tcbp->flags |= TCB_READY;
+#if (PICO_RR)
+    tcbp->rr_used = 0;
+#endif
+    k_rq_unlock(rq);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Low level functions to mark a priority level of a ready list as
+ *	holding tasks, and to clear the mark once its list runs empty.
+ *
+ * \param	rq			the ready list
+ * \param	prio		the priority level
+ *
+ * \return 	none
+ */
+static void k_rq_mark(k_ready_t *rq, uint8_t prio)
+{
+    rq->prio_map[prio >> 5] |= (0x80000000UL >> (prio & 31));
+#if (OS_N_PRIO > 32)
+    rq->grp_map |= (0x80000000UL >> (prio >> 5));
+#endif
+}
+
+static void k_rq_clear(k_ready_t *rq, uint8_t prio)
+{
+    if (rq->band[prio].next == &rq->band[prio])
+    {
+        rq->prio_map[prio >> 5] &= ~(0x80000000UL >> (prio & 31));
+#if (OS_N_PRIO > 32)
+        if (0 == rq->prio_map[prio >> 5])
+        {
+            rq->grp_map &= ~(0x80000000UL >> (prio >> 5));
+        }
+#endif
+    }
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to take a task off the ready list. The priority
+ *	map is cleared for the task's level once its list runs empty.
+ *
+ * \param	tcbp		pointer to the Task Control Block
+ *
+ * \return 	none
+ */
+static void k_ready_remove(tcb_entry_t *tcbp)
+{
+    k_ready_t *rq = k_rq_lock(tcbp);
+    kq_ndelete((k_list_t *)tcbp);
+    tcbp->flags &= ~TCB_READY;
+    k_rq_clear(rq, tcbp->prio);
+    k_rq_unlock(rq);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to find the task at the head of the highest
+ *	priority non-empty ready list.
+ *
+ * \param	rq			the ready list
+ *
+ * \return 	the task to run next; NULL if none
+ */
+static tcb_entry_t *k_ready_head(k_ready_t *rq)
+{
+    uint8_t word = 0;
+#if (OS_N_PRIO > 32)
+    if (0 == rq->grp_map)
+    {
+        return((tcb_entry_t *)Q_NULL);
+    }
+    word = os_clz32(rq->grp_map);
+#else
+    if (0 == rq->prio_map[0])
+    {
+        return((tcb_entry_t *)Q_NULL);
+    }
+#endif
+    return((tcb_entry_t *)rq->band[((uint16_t)word << 5) +
+                                   os_clz32(rq->prio_map[word])].next);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to remove a task from whatever queue it's on.
+ *	A task on the ready list is taken off through k_ready_remove() so
+ *	the priority map stays current.
+ *
+ * \param	tcbp		pointer to the Task Control Block
+ *
+ * \return 	none
+ */
+static void k_task_unlink(tcb_entry_t *tcbp)
+{
+    os_pi_t *pi = tcbp->pi_wait;
+
+    if (TCB_READY == (tcbp->flags & TCB_READY))
+    {
+        k_ready_remove(tcbp);
+    }
+#if (PICO_SMP)
+    else if (TCB_RUN_READY == tcbp->running)
+    {
+        /*
+         * on a core, and off the ready lists; its core
+         * leaves it off when it returns
+         */
+        tcbp->running = TCB_RUN_BLOCKED;
+    }
+#endif
+    else
+    {
+        kq_ndelete((k_list_t *)tcbp);
+        if ((os_pi_t *)0 != pi)
+        {
+            /*
+             * off a lock's queue; the owner may have had its
+             * priority from this one
+             */
+            tcbp->pi_wait = (os_pi_t *)0;
+            os_pi_reprio(pi->owner);
+        }
+    }
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * The higher of prio and that of the first waiter on a priority
+ *	ordered queue.
+ *
+ * \param	queue		the wait queue
+ * \param	prio		the priority so far
+ *
+ * \return 	the higher priority
+ */
+static uint8_t k_pi_top(k_list_t *queue, uint8_t prio)
+{
+    if ((queue->next != queue) && (((tcb_entry_t *)queue->next)->prio < prio))
+    {
+        return (((tcb_entry_t *)queue->next)->prio);
+    }
+    return (prio);
+}
+
+#if (OS_TASK_HASH)
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to find the oldest task of a function. A bucket
+ *	chains one task per function through hash_link, so the walk is over
+ *	the functions that hash there however many instances each has.
+ *
+ * \param	pr_addr		task function pointer
+ *
+ * \return 	the oldest task; NULL if none
+ */
+static tcb_entry_t *k_hash_find(int (*pr_addr)(tcb_pt_t *))
+{
+    k_list_t *bucket = &k_task_hash[k_task_hash(pr_addr)];
+    k_list_t *node;
+
+    for (node = bucket->next; node != bucket; node = node->next)
+    {
+        if (k_hash_owner(node)->p_thread == pr_addr)
+        {
+            return (k_hash_owner(node));
+        }
+    }
+    return ((tcb_entry_t *)Q_NULL);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Low level functions to add a task to the hash, and take it out. The
+ *	first task of a function goes on its bucket; later ones go on the
+ *	tail of the ring of instances through inst_link. When the oldest
+ *	goes, the next oldest takes its place on the bucket.
+ *
+ * \param	tcbp		pointer to the Task Control Block
+ *
+ * \return 	none
+ */
+static void k_hash_insert(tcb_entry_t *tcbp)
+{
+    tcb_entry_t *head = k_hash_find(tcbp->p_thread);
+
+    if ((tcb_entry_t *)Q_NULL == head)
+    {
+        kq_qinsert(k_task_hash[k_task_hash(tcbp->p_thread)].last, &tcbp->hash_link);
+    }
+    else
+    {
+        kq_qinsert(head->inst_link.last, &tcbp->inst_link);
+    }
+}
+
+static void k_hash_remove(tcb_entry_t *tcbp)
+{
+    if ((tcbp->hash_link.next != &tcbp->hash_link) &&
+        (tcbp->inst_link.next != &tcbp->inst_link))
+    {
+        kq_qinsert(&tcbp->hash_link, &k_inst_owner(tcbp->inst_link.next)->hash_link);
+    }
+    kq_ndelete(&tcbp->hash_link);
+    kq_ndelete(&tcbp->inst_link);
+}
+#endif
 
-	for (index = 0; index < len; index++)
-	{
-		sum1 = (sum1 + buf[index]) % 255;
-		sum2 = (sum1 + sum2) % 255;
-	}
-	return ((sum2 << 8) | sum1);
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to put a task on the ready list, from wherever it
+ *	is. An EDF task that wasn't already ready starts a new job due the
+ *	relative deadline after the release time.
+ *
+ * \param	tcbp		pointer to the Task Control Block
+ * \param	release		tick the task was due to be made ready
+ *
+ * \return 	none
+ */
+static void k_task_release(tcb_entry_t *tcbp, timer_t release)
+{
+#if (PICO_EDF)
+    if ((TCB_EDF == (tcbp->flags & TCB_EDF)) && !task_ready(tcbp))
+    {
+        tcbp->deadline = release + tcbp->rel_deadline;
+    }
+#else
+    (void)release;
+#endif
+    k_task_unlink(tcbp);
+    k_ready_insert(tcbp);
 }
 
+#if (PICO_EDF)
 /**
  *
  *********************************************************************
  *
- * Add a function to the timer hook list. Functions are added without
- *	regard to priority (LIFO), and all functions on the list will be
- *	invoked on every timer tick.
+ * Low level function to link an EDF task into its ready list by
+ *	deadline. Equal deadlines stay FIFO, and plain tasks at the level
+ *	stay behind every EDF task. The search runs from the tail, where a
+ *	new job's deadline usually belongs.
  *
- * \param	node		is the caller's t_hook_entry_t structure
- * \param	function	is a pointer to caller's function
+ * \param	band		the EDF priority list
+ * \param	tcbp		pointer to the Task Control Block
  *
- * \return	none
+ * \return 	none
  */
-void os_add_timerhook(t_hook_entry_t *node, void (*tfun_addr)(void))
+static void k_edf_insert(k_list_t *band, tcb_entry_t *tcbp)
 {
-    os_add_hook((t_hook_entry_t *)&k_thook_list, node, tfun_addr);
+    k_list_t    *node;
+    tcb_entry_t *task;
+
+    for (node = band->last; band != node; node = node->last)
+    {
+        task = (tcb_entry_t *)node;
+        if ((TCB_EDF == (task->flags & TCB_EDF)) &&
+            tick_reached(tcbp->deadline, task->deadline))
+        {
+            break;
+        }
+    }
+    kq_qinsert(node, (k_list_t *)tcbp);
 }
 
 /**
  *
  *********************************************************************
  *
- * Add a function to the scheduler hook list. Functions are added without
- *	regard to priority (LIFO), and all functions on the list will be
- *	invoked at each pass through the main scheduling loop. Kernel hook
- *	functions do not have the ability to preempt tasks, but they can run
- *	more often than the timed granularity of a single tick. At the same
- *	time, while a convention task could run more often by leaving it on
- *	the ready queue, it would preempt everyone behind it.
+ * Low level function to close the job of a ready EDF task that is
+ *	about to block. A job finishing after its deadline is a miss.
  *
- * \param 	node		is the caller's t_hook_entry_t structure
- * \param 	function	is a pointer to the caller's function
+ * \param	tcbp		pointer to the Task Control Block
  *
- * \return	none
+ * \return 	none
  */
-void os_add_schedhook(t_hook_entry_t *node, void (*tfun_addr)(void))
+static void k_edf_done(tcb_entry_t *tcbp)
 {
-    os_add_hook((t_hook_entry_t *)&k_loop_list, node, tfun_addr);
+    if ((TCB_EDF == (tcbp->flags & TCB_EDF)) && task_ready(tcbp) &&
+        !tick_reached(tcbp->deadline, get_os_ticks()))
+    {
+        tcbp->dl_miss++;
+    }
 }
+#endif
 
+#if (PICO_STATS)
 /**
  *
  *********************************************************************
  *
- * This is a low level function to add a hook to any singly linked list.
+ * Low level function to take a lap of a core's loop. The cycles since
+ *	the last lap are returned, for the caller to charge to a part of
+ *	the pass. A lap is shorter than the counter's wrap.
  *
- * \param 	list		is the caller's t_hook_entry_t structure
- * \param	node 	    the node to insert
- * \param	function	is a pointer to the caller's function
+ * \param	st			the core's statistics
  *
- * \return	none
+ * \return 	os_cycle_count() units since the last lap
  */
-void os_add_hook(t_hook_entry_t *list, t_hook_entry_t *node, void (*tfun_addr)(void))
+static uint32_t k_stats_lap(os_stats_t *st)
 {
-    node->p_timerhook  = tfun_addr;
-    kq_slinsert((k_slist_t *)list, (k_slist_t *)node);
+    uint32_t now = os_cycle_count();
+    uint32_t lap = now - st->last;
+
+    st->last = now;
+    return (lap);
 }
 
 /**
  *
  *********************************************************************
  *
- * Remove a function from the timer hook list. This function allows an
- *	application to dynamically hook and unhook to the system timer
- *	interrupt as necessary.
+ * Low level function to charge a dispatch to the task just run. A task
+ *	that released its own tcb is counted only in the core's total.
  *
- * \param	node		is the caller's t_hook_entry_t structure
+ * \param	st			the core's statistics
+ * \param	task		the task that ran
  *
  * \return 	none
  */
-void os_release_timerhook(t_hook_entry_t *node)
+static void k_stats_task(os_stats_t *st, tcb_entry_t *task)
 {
-    os_release_hook((t_hook_entry_t *)&k_thook_list, node);
+    uint32_t lap = k_stats_lap(st);
+
+    st->tasks += lap;
+    if (TCB_FREE != (task->flags & TCB_FREE))
+    {
+        task->run_cycles += lap;
+        task->run_count++;
+        if (lap > task->run_max)
+        {
+            task->run_max = lap;
+        }
+    }
 }
+#endif
 
+#if (PICO_RR && !PICO_SMP)
 /**
  *
  *********************************************************************
  *
- * Remove a function from the system hook list. This function allows an
- *	application to dynamically hook and unhook to the kernel main loop
- *	as necessary.
+ * Low level function to run a task and take its turn into account.
+ *	The task goes to the back of its priority list when it returns
+ *	PT_YIELDED, or once it has used OS_RR_QUANTUM dispatches (cycles
+ *	with OS_RR_CYCLES set) while staying ready. A task that blocks
+ *	starts a fresh quantum when it's made ready again.
  *
- * \param	node		is the caller's t_hook_entry_t structure
+ * \param	task		the task at the head of the ready list
  *
- * \return	none
+ * \return 	none
  */
-void os_release_schedhook(t_hook_entry_t *node)
+static void k_rr_dispatch(tcb_entry_t *task)
 {
-    os_release_hook((t_hook_entry_t *)&k_loop_list, node);
+    k_list_t *band;
+    int       state;
+#if (OS_RR_CYCLES)
+    uint32_t  start = os_cycle_count();
+#endif
+
+    state = task->p_thread(&(task->tcbpt));
+    /*
+     * the task may have blocked, or been killed and its tcb reused,
+     *	while it ran. only rotate it if it's still first in line.
+     */
+    band = &k_ready_list[0].band[task->prio];
+    if ((TCB_READY != (task->flags & TCB_READY)) || (band->next != (k_list_t *)task))
+    {
+        return;
+    }
+#if (PICO_EDF)
+    /*
+     * EDF tasks keep deadline order
+     */
+    if (TCB_EDF == (task->flags & TCB_EDF))
+    {
+        return;
+    }
+#endif
+#if (OS_RR_CYCLES)
+    task->rr_used += os_cycle_count() - start;
+#else
+    task->rr_used++;
+#endif
+    if ((PT_YIELDED == state) || (task->rr_used >= OS_RR_QUANTUM))
+    {
+        task->rr_used = 0;
+        if (band->last != (k_list_t *)task)
+        {
+            kq_ndelete((k_list_t *)task);
+            kq_qinsert(band->last, (k_list_t *)task);
+        }
+    }
 }
+#endif
 
+#if (PICO_SMP)
 /**
  *
  *********************************************************************
  *
- * Low level function to release a hook node from a singly linked list.
+ * Low level functions to lock and unlock the ready list of the core a
+ *	task belongs to. A task only changes core under the lock of the
+ *	core it's leaving, so the core is checked again once locked.
  *
- * \param 	list		is the caller's t_hook_entry_t structure
- * \param	node 	    is the node to remove
+ * \param	tcbp		pointer to the Task Control Block
  *
- * \return	none
+ * \return 	the task's ready list, locked
+ */
+static k_ready_t *k_rq_lock(tcb_entry_t *tcbp)
+{
+    uint8_t core;
+
+    FOREVER
+    {
+        core = tcbp->core;
+        os_core_lock(core);
+        if (core == tcbp->core)
+        {
+            return (&k_ready_list[core]);
+        }
+        os_core_unlock(core);
+    }
+}
+
+static void k_rq_unlock(k_ready_t *rq)
+{
+    os_core_unlock((uint8_t)(rq - k_ready_list));
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to take the next task for a core to run. The
+ *	head of the core's own ready list comes first; with none ready, a
+ *	task is stolen from another core. The task is marked running, and
+ *	stays off the ready lists until k_smp_run() puts it back. While it
+ *	runs, TCB_READY is clear and its readiness is kept in running, as
+ *	TCB_RUN_READY or TCB_RUN_BLOCKED; see task_ready(). Both are
+ *	written under the kernel lock, as are its flags and affinity.
+ *
+ * \param	core		the core's number
+ *
+ * \return 	the task to run; NULL if none
  */
-void os_release_hook(t_hook_entry_t *list, t_hook_entry_t *node)
+static tcb_entry_t *k_smp_next(uint8_t core)
 {
-    kq_slndelete((k_slist_t *)list, (k_slist_t *)node);
+    k_ready_t   *rq = &k_ready_list[core];
+    tcb_entry_t *task;
+
+    K_LOCK();
+    os_core_lock(core);
+    task = k_ready_head(rq);
+    if ((tcb_entry_t *)Q_NULL != task)
+    {
+        kq_ndelete((k_list_t *)task);
+        k_rq_clear(rq, task->prio);
+        task->flags  &= ~TCB_READY;
+        task->running = TCB_RUN_READY;
+    }
+    os_core_unlock(core);
+    if ((tcb_entry_t *)Q_NULL == task)
+    {
+        task = k_smp_steal(core);
+    }
+    K_UNLOCK();
+    return (task);
 }
 
 /**
  *
  *********************************************************************
  *
- * Low level function to insert node as the next element of a queue
- *	(doubly linked list), or after a given node
+ * Low level function for an idle core to steal a task. The other cores
+ *	are tried in turn, starting with the next one up. The highest
+ *	priority task found that may run on the thief moves to it; within
+ *	a priority the task queued last is taken, leaving the older ones to
+ *	their own core. Each ready list is peeked at before it's locked, so
+ *	empty cores cost nothing.
  *
- * \param	queue		is a pointer to the queue
- * \param	node		is the node to insert
+ * \param	core		the idle core's number
+ *
+ * \return 	the task stolen, marked running; NULL if none
+ */
+static tcb_entry_t *k_smp_steal(uint8_t core)
+{
+    uint8_t      victim;
+    uint8_t      tries;
+    uint16_t     prio;
+    k_ready_t   *rq;
+    k_list_t    *node;
+    tcb_entry_t *task;
+
+    victim = core;
+    for (tries = 1; tries < os_n_cores; tries++)
+    {
+        victim = (uint8_t)((victim + 1) % os_n_cores);
+        rq     = &k_ready_list[victim];
+        if ((tcb_entry_t *)Q_NULL == k_ready_head(rq))
+        {
+            continue;
+        }
+        os_core_lock(victim);
+        for (prio = 0; prio < OS_N_PRIO; prio++)
+        {
+            if (0 == (rq->prio_map[prio >> 5] & (0x80000000UL >> (prio & 31))))
+            {
+                continue;
+            }
+            for (node = rq->band[prio].last; &rq->band[prio] != node; node = node->last)
+            {
+                task = (tcb_entry_t *)node;
+                if (task->affinity & (1UL << core))
+                {
+                    kq_ndelete(node);
+                    k_rq_clear(rq, (uint8_t)prio);
+                    task->flags  &= ~TCB_READY;
+                    task->core    = core;
+                    task->running = TCB_RUN_READY;
+                    os_core_unlock(victim);
+                    return (task);
+                }
+            }
+        }
+        os_core_unlock(victim);
+    }
+    return ((tcb_entry_t *)Q_NULL);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to run a task on a core, and put it back on the
+ *	core's ready list if it's still ready when it returns. A plain task
+ *	goes back to the head of its priority, so it keeps running until
+ *	it blocks as on one core; EDF tasks go back in deadline order. With
+ *	PICO_RR set, turns are taken as in k_rr_dispatch().
+ *
+ *	A task whose affinity no longer includes the core moves to the
+ *	first core it may run on. The task's state is read under the
+ *	kernel lock that its writers hold.
+ *
+ * \param	core		the core's number
+ * \param	task		the task, as returned by k_smp_next()
  *
  * \return 	none
  */
-void kq_qinsert(k_list_t *queue, k_list_t *node)
+static void k_smp_run(uint8_t core, tcb_entry_t *task)
 {
-    node->next 		   = queue->next;
-    node->last 		   = queue;
-    queue->next 	   = node;
-    node->next->last   = node;
+    k_ready_t *rq = &k_ready_list[core];
+    int        state;
+    uint8_t    ready;
+#if (PICO_RR && OS_RR_CYCLES)
+    uint32_t   start = os_cycle_count();
+#endif
+
+    k_current[core] = task;
+    OS_TRACE(TR_DISPATCH, task, task->p_thread);
+    state = task->p_thread(&(task->tcbpt));
+    OS_TRACE(TR_RETURN, task, task->p_thread);
+#if (PICO_ARENA)
+    k_arena_done(task);
+#endif
+    k_current[core] = (tcb_entry_t *)Q_NULL;
+    (void)state;
+
+    K_LOCK();
+    ready = (TCB_RUN_READY == task->running);
+    if (0 == (task->affinity & (1UL << core)))
+    {
+        os_core_lock(core);
+        task->running = 0;
+        task->core    = k_smp_home(task->affinity);
+        os_core_unlock(core);
+        if (ready)
+        {
+            k_ready_insert(task);
+        }
+        K_UNLOCK();
+        return;
+    }
+    os_core_lock(core);
+    task->running = 0;
+    if (ready)
+    {
+        task->flags |= TCB_READY;
+#if (PICO_EDF)
+        if (TCB_EDF == (task->flags & TCB_EDF))
+        {
+            k_edf_insert(&rq->band[task->prio], task);
+        }
+        else
+#endif
+        {
+#if (PICO_RR)
+#if (OS_RR_CYCLES)
+            task->rr_used += os_cycle_count() - start;
+#else
+            task->rr_used++;
+#endif
+            if ((PT_YIELDED == state) || (task->rr_used >= OS_RR_QUANTUM))
+            {
+                task->rr_used = 0;
+                kq_qinsert(rq->band[task->prio].last, (k_list_t *)task);
+            }
+            else
+#endif
+            kq_qinsert(&rq->band[task->prio], (k_list_t *)task);
+        }
+        k_rq_mark(rq, task->prio);
+    }
+    os_core_unlock(core);
+    K_UNLOCK();
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to find the first core an affinity mask allows.
+ *
+ * \param	affinity	a non-zero mask of cores
+ *
+ * \return 	the core's number
+ */
+static uint8_t k_smp_home(uint32_t affinity)
+{
+    uint8_t core = 0;
+
+    while ((core < (os_n_cores - 1)) && (0 == (affinity & (1UL << core))))
+    {
+        core++;
+    }
+    return (core);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Set the cores a task may run on. Bit n of the mask allows core n; a
+ *	mask allowing no core is ignored. A ready task that may no longer
+ *	run on its core moves now, a running one when it returns.
+ *
+ * \param 	task		pointer to the Task Control Block
+ * \param	affinity	mask of cores, OS_CORE_ALL for any
+ *
+ * \return 	none
+ */
+void os_set_task_affinity(tcb_entry_t *task, uint32_t affinity)
+{
+    k_ready_t *rq;
+    uint8_t    ready;
+
+    affinity &= OS_CORE_ALL;
+    if (0 == affinity)
+    {
+        return;
+    }
+    K_LOCK();
+    rq             = k_rq_lock(task);
+    task->affinity = affinity;
+    if (task->running || (affinity & (1UL << task->core)))
+    {
+        k_rq_unlock(rq);
+        K_UNLOCK();
+        return;
+    }
+    ready = (TCB_READY == (task->flags & TCB_READY));
+    if (ready)
+    {
+        kq_ndelete((k_list_t *)task);
+        k_rq_clear(rq, task->prio);
+        task->flags &= ~TCB_READY;
+    }
+    task->core = k_smp_home(affinity);
+    k_rq_unlock(rq);
+    if (ready)
+    {
+        k_ready_insert(task);
+    }
+    K_UNLOCK();
+}
+#endif
+
+#ifndef os_clz32
+/**
+ *
+ *********************************************************************
+ *
+ * Count the leading zeros of a 32 bit word. This is the fallback for
+ *	tool chains without a builtin; see portable.h.
+ *
+ * \param	word		a non-zero 32 bit word
+ *
+ * \return 	number of leading zero bits
+ */
+uint8_t os_clz32(uint32_t word)
+{
+    uint8_t count = 0;
+    if (0 == (word & 0xFFFF0000UL)) { count += 16; word <<= 16; }
+    if (0 == (word & 0xFF000000UL)) { count +=  8; word <<=  8; }
+    if (0 == (word & 0xF0000000UL)) { count +=  4; word <<=  4; }
+    if (0 == (word & 0xC0000000UL)) { count +=  2; word <<=  2; }
+    if (0 == (word & 0x80000000UL)) { count +=  1; }
+    return (count);
+}
+#endif
+
+#ifndef os_atomic_or32
+/**
+ *
+ *********************************************************************
+ *
+ * Atomic or into a 32 bit word. The fallback for cores without
+ *	exclusive loads and stores; see portable.h. Interrupts are off
+ *	for the read, or and write, and put back as they were, as it's
+ *	called from an ISR too.
+ *
+ * \param	p			the word
+ * \param	v			the bits to set
+ *
+ * \return 	none
+ */
+void os_atomic_or32(uint32_t volatile *p, uint32_t v)
+{
+    os_irq_t s = os_irq_save();
+
+    *p |= v;
+    os_irq_restore(s);
+}
+#endif
+
+#ifndef os_atomic_xchg32
+/**
+ *
+ *********************************************************************
+ *
+ * Atomic exchange of a 32 bit word. The fallback for cores without
+ *	exclusive loads and stores; see portable.h.
+ *
+ * \param	p			the word
+ * \param	v			the new value
+ *
+ * \return 	the old value
+ */
+uint32_t os_atomic_xchg32(uint32_t volatile *p, uint32_t v)
+{
+    os_irq_t s = os_irq_save();
+    uint32_t old;
+
+    old = *p;
+    *p  = v;
+    os_irq_restore(s);
+    return (old);
+}
+#endif
+/* @} */
+/**
+ *********************************************************************
+ *
+ * \name OS Timing Services
+ * @{
+ */
+/**
+ *
+ *********************************************************************
+ *
+ * A task is scheduled for a time delay. The task is first removed from
+ *	any queue it is waiting on, it's timer is set to the given delay value,
+ *	and the timing flags are set to start timing. A delay of NO_TIMEOUT
+ *	leaves the timer stopped, delays are otherwise capped at
+ *	TICK_MAX_DELAY.
+ *
+ * \param 	task		pointer to the Task Control Block
+ * \param	delay		delay value
+ *
+ * \return 	none
+ */
+
+void os_delay(tcb_entry_t *task, timer_t delay)
+{
+    /*
+     * remove the task from any queue it's on
+     *	set the timer value and leave ...
+     */
+    K_LOCK();
+#if (PICO_EDF)
+    k_edf_done(task);
+#endif
+    k_task_unlink(task);
+    set_task_timer( task, delay );
+    start_task_timer( task );
+    K_UNLOCK();
 }
 
 /**
  *
  *********************************************************************
  *
- * Low level function to delete and return the next element of a queue
- *	(doubly linked list). The neighbors to the deleted node are relinked,
- *	and a pointer to the deleted node is returned.
+ * Start a task timer. The delay staged in the timer by set_task_timer()
+ *	is converted to an absolute deadline, and the timer is linked onto
+ *	the timer wheel. A running timer is restarted.
  *
- * \param	queue    	is a pointer to the queue
- * \param	node		is the node to insert
+ * \param 	task		pointer to the Task Control Block
  *
- * \return 	deleted node; NULL if none
+ * \return 	none
  */
-k_list_t *kq_qdelete(k_list_t *queue)
+void os_start_task_timer(tcb_entry_t *task)
 {
-    k_list_t *node;		/* the deleted node */
-    if (queue->next == queue )
+    timer_t delay = task->timer;
+
+    K_LOCK();
+    os_stop_task_timer(task);
+    task->flags &= ~TCB_TIMEOUT;
+    if (NO_TIMEOUT != delay)
     {
-        return( Q_NULL );
+        if (delay > TICK_MAX_DELAY)
+        {
+            delay = TICK_MAX_DELAY;
+        }
+        task->timer  = get_os_ticks() + delay;
+        task->flags |= TCB_TIMING;
+        k_tmr_insert(task);
     }
-    node 				= queue->next;
-    queue->next 		= node->next;
-    queue->next->last 	= queue;
-    return( node );
+    K_UNLOCK();
 }
 
 /**
  *
  *********************************************************************
  *
- * Low level function to delete a node from any queue (doubly linked list)
- *	it's waiting on.
+ * Stop a task timer. The timer is taken off the timer wheel without
+ *	flagging a timeout.
  *
- * \param	node		is the node to delete
+ * \param 	task		pointer to the Task Control Block
  *
  * \return 	none
  */
-void kq_ndelete(k_list_t *node)
+void os_stop_task_timer(tcb_entry_t *task)
 {
-    k_list_t *next_node;
-    k_list_t *last_node;
-    last_node 		= node->last;
-    next_node 		= node->next;
-    last_node->next = next_node;
-    next_node->last = last_node;
-    node->next 		= node->last = node;
+    K_LOCK();
+    if (task->flags & TCB_TIMING)
+    {
+        kq_ndelete(&task->tmr_link);
+        k_tmr_count[task->tmr_level]--;
+        task->flags &= ~TCB_TIMING;
+    }
+    K_UNLOCK();
 }
 
 /**
  *
  *********************************************************************
  *
- * Low level function to insert node as the next element of a singly
- *	linked list. The node is inserted at the end (or next item) of
- *	the list.
+ * Set a task's general purpose timer. The gp timer is polled with
+ *	gp_timer_expired() rather than waking the task, so it only records
+ *	an absolute deadline and costs nothing per tick.
  *
- * \param	s_list    	is a pointer to the list
- * \param	node		is the node to insert
+ * \param 	task		pointer to the Task Control Block
+ * \param	delay		delay value; NO_TIMEOUT never expires
  *
  * \return 	none
  */
-void kq_slinsert(k_slist_t *s_list, k_slist_t *node)
+void os_set_gptimer(tcb_entry_t *task, timer_t delay)
 {
-    node->next 	 = s_list->next;
-    s_list->next = node;
+    if (NO_TIMEOUT == delay)
+    {
+        task->flags |= TCB_GPFOREVER;
+    }
+    else
+    {
+        if (delay > TICK_MAX_DELAY)
+        {
+            delay = TICK_MAX_DELAY;
+        }
+        task->gptimer = get_os_ticks() + delay;
+        task->flags  &= ~TCB_GPFOREVER;
+    }
 }
 
 /**
  *
  *********************************************************************
  *
- * Low level function to delete and return the next element of a singly
- *	linked list. kq_sldelete() traverses to the end of the list, and
- *	deletes the last node. A pointer to that node is returned.
+ * Low level function to link a running task timer onto the timer wheels.
+ *	Wheel 0 has a slot per tick for the next OS_TMR_SLOTS ticks past
+ *	last_tick. A slot of wheel n spans OS_TMR_SLOTS^n ticks, and holds
+ *	the deadlines due in those ticks until k_tmr_cascade() moves them
+ *	down. A deadline past the top wheel waits in the top wheel's last
+ *	slot, and is placed again when that slot cascades. A deadline
+ *	already serviced is moved to the next tick.
  *
- * \param 	s_list    	is a pointer to the list
+ * \param 	task		pointer to the Task Control Block
  *
- * \return 	the deleted node; NULL if none
+ * \return 	none
  */
-k_slist_t *kq_sldelete(k_slist_t *s_list)
+static void k_tmr_insert(tcb_entry_t *task)
 {
-    k_slist_t *node;		/* the deleted node */
-    node = s_list->next;
-    if (SL_NULL != s_list->next)
+    timer_t base = last_tick + 1;
+    timer_t at   = task->timer;
+    timer_t ahead;
+    uint8_t level = 0;
+
+    if (tick_reached(last_tick, at))
     {
-        s_list->next = node->next;
+        task->timer = at = base;
     }
-    return( node );
+    ahead = at - base;
+    while ((level < OS_TMR_LEVELS - 1) && ((level + 1) * OS_TMR_BITS < 32) &&
+           (ahead >> ((level + 1) * OS_TMR_BITS)))
+    {
+        level++;
+    }
+    if (((level + 1) * OS_TMR_BITS < 32) && (ahead >> ((level + 1) * OS_TMR_BITS)))
+    {
+        at = base + (((timer_t)1 << ((level + 1) * OS_TMR_BITS)) - 1);
+    }
+    task->tmr_level = level;
+    k_tmr_count[level]++;
+    kq_qinsert(k_tmr_wheel[level][(at >> (level * OS_TMR_BITS)) & OS_TMR_MASK].last,
+               &task->tmr_link);
 }
 
 /**
  *
  *********************************************************************
  *
- * Low level function to delete a node from a singly linked list.
- *	kq_slndelete() traverses the list, searching for the node. Once
- *	found, the node is removed from the list.
+ * Low level function to expire every timer on a list. Each task is
+ *	flagged as timed out and resumed.
  *
- * \param	s_list    	is a pointer to the list
- * \param	node		is the node to delete
+ * \param 	slot		the timer list
  *
  * \return 	none
  */
-void kq_slndelete(k_slist_t *s_list, k_slist_t *node)
+static void k_tmr_expire(k_list_t *slot)
 {
-    k_slist_t *next_node;
-    for((next_node = s_list->next); (SL_NULL != next_node); (next_node = s_list->next))
+    k_list_t	*node;
+    tcb_entry_t *task;
+
+    while (Q_NULL != (node = kq_qdelete(slot)))
     {
-        if (next_node->next == node)
-        {
-            next_node->next = node->next;
-            node->next      = SL_NULL;
-            break;
-        }
+        node->next   = node->last = node;
+        task 		 = k_tmr_owner(node);
+        k_tmr_count[0]--;
+        task->flags &= ~TCB_TIMING;
+        task->flags |=  TCB_TIMEOUT;
+        OS_TRACE(TR_TIMER, task, 0);
+        k_task_release(task, task->timer);
     }
 }
-/* @} */
-/**
- *********************************************************************
- *
- * \name OS Timing Services
- * @{
- */
+
 /**
  *
  *********************************************************************
  *
- * A task is scheduled for a time delay. The task is first removed from
- *	any queue it is waiting on, it's timer is set to the given delay value,
- *	and the timing flags are set to start timing.
+ * Low level function to cascade the upper wheels as wheel 0 comes round
+ *	to tick 'now'. The slot of wheel 1 that spans the next OS_TMR_SLOTS
+ *	ticks moves down, and where that is wheel 1's first slot, wheel 2's
+ *	slot does too, and so on up. Only the slots moved are touched, so
+ *	the timers further out cost nothing here.
  *
- * \param 	task		pointer to the Task Control Block
- * \param	delay		delay value
+ * \param 	now			the tick about to be serviced
  *
  * \return 	none
  */
-
-void os_delay(tcb_entry_t *task, timer_t delay)
+static void k_tmr_cascade(timer_t now)
 {
-    /*
-     * remove the task from any queue it's on
-     *	set the timer value and leave ...
-     */
-    kq_ndelete((k_list_t *)task);
-    set_task_timer( task, delay );
-    start_task_timer( task );
+    k_list_t	 slot;
+    k_list_t	*node;
+    uint16_t	 index;
+    uint8_t		 level;
+
+    for (level = 1; (level < OS_TMR_LEVELS) && (level * OS_TMR_BITS < 32); level++)
+    {
+        index = (now >> (level * OS_TMR_BITS)) & OS_TMR_MASK;
+        node  = &k_tmr_wheel[level][index];
+        if (node != node->next)
+        {
+            /*
+             * lift the slot off whole before its timers are placed
+             *	again, some of them back on this wheel
+             */
+            slot.next       = node->next;
+            slot.last       = node->last;
+            slot.next->last = &slot;
+            slot.last->next = &slot;
+            node->next      = node->last = node;
+            while (Q_NULL != (node = kq_qdelete(&slot)))
+            {
+                node->next = node->last = node;
+                k_tmr_count[level]--;
+                k_tmr_insert(k_tmr_owner(node));
+            }
+        }
+        if (0 != index)
+        {
+            break;
+        }
+    }
 }
 
 /**
@@ -891,7 +3284,64 @@ void os_tick_delay(uint16_t delay)
     do
     {
 		//clr_wdt();
-	} while (temp_tick != current_tick);
+	} while (!tick_reached(current_tick, temp_tick));
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * The 64 bit time, in OS_TIME_HZ units. It's the tick count, with the
+ *	times current_tick has wrapped above it, scaled by OS_TICK_COUNTS,
+ *	plus the port's count into the tick. On an 8 or 16 bit part the
+ *	tick count is read a byte or word at a time, so it's read again
+ *	if the tick interrupt changes it in between. The caller must not
+ *	be an interrupt that can preempt the tick. The ports carry the
+ *	part tick through a tickless sleep, but between the wake and the
+ *	catch up the count into the tick has started again while the ticks
+ *	slept are still to be added, so the time is kept from going back
+ *	over that short gap. The last time is 64 bits, so it's compared
+ *	and stored with interrupts off, lest an interrupt that reads the
+ *	time finds it half written.
+ *
+ * \param	none
+ *
+ * \return 	the time
+ */
+os_time_t os_time_now(void)
+{
+    os_time_t	now;
+    uint32_t	epoch;
+    timer_t		tick;
+    uint8_t		seq;
+    os_irq_t	s;
+#if (OS_TICK_FRACTION)
+    os_time_t	part;
+#endif
+
+    K_LOCK();
+    do
+    {
+        seq   = k_time_seq;
+        epoch = k_tick_epoch;
+        tick  = current_tick;
+#if (OS_TICK_FRACTION)
+        part  = os_tick_fraction();
+#endif
+    } while (seq != k_time_seq);
+    now = os_time_from_ticks(((os_time_t)epoch << 32) | tick);
+#if (OS_TICK_FRACTION)
+    now += part;
+#endif
+    s = os_irq_save();
+    if (now < k_time_last)
+    {
+        now = k_time_last;
+    }
+    k_time_last = now;
+    os_irq_restore(s);
+    K_UNLOCK();
+    return (now);
 }
 
 /**
@@ -899,8 +3349,8 @@ void os_tick_delay(uint16_t delay)
  *********************************************************************
  *
  * Kernel timer interrupt processing. The system tick counter (current_tick)
- *	is incremented, followed by invocation of all functions on the system
- *	timer hook list.
+ *	and the seconds counter (os_seconds) are updated, followed by invocation
+ *	of all functions on the system timer hook list.
  *
  * \param	none
  *
@@ -908,28 +3358,140 @@ void os_tick_delay(uint16_t delay)
  */
 void os_timerHook(void)
 {
-    ++current_tick;
-    os_hook_handler(k_thook_list);
+#if (PICO_STATS)
+    uint32_t start = os_cycle_count();
+#endif
+    if (0 == ++current_tick)
+    {
+        k_tick_epoch++;
+    }
+    k_time_seq++;
+    if (0 == --sec_prescale)
+    {
+        sec_prescale = SYSTICKHZ;
+        os_seconds++;
+    }
+    os_hook_handler(&k_thook_list);
+#if (PICO_STATS)
+    k_stats[0].timer_hooks += os_cycle_count() - start;
+#endif
+}
+
+#if (PICO_TICKLESS)
+/**
+ *
+ *********************************************************************
+ *
+ * Account for ticks the tick interrupt did not deliver. On wake from
+ *	tickless idle, the port reports the whole ticks slept through and
+ *	current_tick and os_seconds are brought up to date in one step,
+ *	with interrupts off as they nest, as the tick is running again.
+ *
+ * \param	ticks		number of ticks to add
+ *
+ * \return 	none
+ */
+void os_tick_catchup(timer_t ticks)
+{
+    os_irq_t s = os_irq_save();
+
+    current_tick += ticks;
+    if (current_tick < ticks)
+    {
+        k_tick_epoch++;
+    }
+    k_time_seq++;
+    k_thook_list.count += ticks;
+    os_seconds   += ticks / SYSTICKHZ;
+    ticks        %= SYSTICKHZ;
+    if (ticks >= sec_prescale)
+    {
+        sec_prescale += SYSTICKHZ;
+        os_seconds++;
+    }
+    sec_prescale -= (uint16_t)ticks;
+    os_irq_restore(s);
 }
+#endif
 
 /**
  *
  *********************************************************************
  *
- * Low level execute all functions on a given hook list. The list is
- *	traversed from beginning to end, executing the function provided
- *	for each entry along the way.
+ * Low level execute the functions due on a given hook list. The call
+ *	is counted, and the hooks due on it are invoked in order; each is
+ *	then due again period calls on. The list is kept in due order, so
+ *	hooks that aren't due cost nothing. A hook that misses calls, as
+ *	when the tick stops in tickless idle, runs once on the next call
+ *	and keeps its phase.
+ *
+ * A hook may add or release hooks, itself included.
  *
- * \param	hooks		pointer to the singly linked hook list
+ * Hooks of one rate come due together and go back together. Each
+ *	search for a hook's new place starts from the last hook put back,
+ *	when that goes ahead of it, so a run of them costs O(1) apiece.
+ *
+ * \param	list		pointer to the hook list
  *
  * \return 	none
  */
-void os_hook_handler(t_hook_entry_t *hooks)
+void os_hook_handler(t_hook_list_t *list)
 {
-    for(; SL_NULL != (k_slist_t *)hooks ; hooks = (t_hook_entry_t *)hooks->t_hook_link.next)
+    k_list_t       *node;
+    k_list_t       *from = &list->hooks;
+    t_hook_entry_t *hook;
+    t_hook_entry_t *last;
+    timer_t         due;
+    uint16_t        gen;
+
+    K_LOCK();
+    list->count++;
+    while (&list->hooks != (node = list->hooks.next))
     {
-        hooks->p_timerhook();
+        hook = (t_hook_entry_t *)node;
+        due  = hook->due;
+        if (!tick_reached(list->count, due))
+        {
+            break;
+        }
+        gen = k_hook_gen;
+        if (hook->enabled)
+        {
+            OS_TRACE(TR_HOOK_ENTER, (tcb_entry_t *)Q_NULL, hook->p_timerhook);
+            hook->p_timerhook();
+            OS_TRACE(TR_HOOK_EXIT, (tcb_entry_t *)Q_NULL, hook->p_timerhook);
+        }
+        /*
+         * unless the hook was released, or added again, while it ran
+         */
+        if ((node->next != node) && (due == hook->due))
+        {
+            kq_ndelete(node);
+            hook->due += hook->period;
+            if (tick_reached(list->count, hook->due))
+            {
+                hook->due += ((timer_t)(list->count - hook->due) / hook->period + 1) * hook->period;
+            }
+            /*
+             * the last hook put back is still a place to start if no
+             *	hook has been added or released since, and it goes ahead
+             */
+            last = (t_hook_entry_t *)from;
+            if ((gen != k_hook_gen) || (&list->hooks == from) ||
+                ((last->due != hook->due) ? !tick_reached(hook->due, last->due)
+                                          : (last->prio > hook->prio)))
+            {
+                from = &list->hooks;
+            }
+            k_hook_insert(list, from, hook, 0);
+            from = node;
+        }
+        else
+        {
+            from = &list->hooks;
+        }
     }
+    K_UNLOCK();
 }
 
 /**
@@ -971,15 +3533,192 @@ void os_update_timer(timer_t *timer, timer_t elapsed_time)
 	}
 }
 
+#if (PICO_TICKLESS)
+/**
+ *
+ *********************************************************************
+ *
+ * Low level function to find the number of ticks until the next task
+ *	timer is due. The first occupied slot of wheel 0 past last_tick holds
+ *	one deadline. A deadline on a wheel above may still come first, as
+ *	timers are placed relative to when they were started, so the first
+ *	occupied slot of each of those is searched too; only that slot. The
+ *	top wheel also holds deadlines past its span, out of order, so for it
+ *	the tick its first occupied slot cascades is taken instead; the idle
+ *	wakes there, and the timers are then on a wheel below. gp timers
+ *	don't wake a task, so they are not considered.
+ *
+ * \param 	none
+ *
+ * \return 	ticks from current_tick; 0 if due, NO_TIMEOUT if no timer runs
+ */
+static timer_t k_tmr_next(void)
+{
+    uint16_t	 slot;
+    uint8_t		 level;
+    uint8_t		 shift;
+    k_list_t	*list;
+    k_list_t	*node;
+    timer_t		 block;
+    timer_t		 delta;
+    timer_t		 nearest = NO_TIMEOUT;
+    timer_t		 now     = get_os_ticks();
+
+    for (slot = 1; (0 != k_tmr_count[0]) && (slot <= OS_TMR_SLOTS); slot++)
+    {
+        node = &k_tmr_wheel[0][(last_tick + slot) & OS_TMR_MASK];
+        if (node != node->next)
+        {
+            nearest = slot;
+            break;
+        }
+    }
+    for (level = 1; (level < OS_TMR_LEVELS) && (level * OS_TMR_BITS < 32); level++)
+    {
+        /*
+         * the slot spanning the next tick has been cascaded, unless
+         *	that tick starts it
+         */
+        shift = level * OS_TMR_BITS;
+        block = (last_tick + 1) >> shift;
+        if (0 == ((last_tick + 1) & (((timer_t)1 << shift) - 1)))
+        {
+            block--;
+        }
+        for (slot = 1; (0 != k_tmr_count[level]) && (slot <= OS_TMR_SLOTS); slot++)
+        {
+            list = &k_tmr_wheel[level][(block + slot) & OS_TMR_MASK];
+            if (list == list->next)
+            {
+                continue;
+            }
+            if ((OS_TMR_LEVELS - 1 == level) && (OS_TMR_LEVELS * OS_TMR_BITS < 32))
+            {
+                delta = ((block + slot) << shift) - last_tick;
+                if (delta < nearest)
+                {
+                    nearest = delta;
+                }
+                break;
+            }
+            for (node = list->next; list != node; node = node->next)
+            {
+                delta = k_tmr_owner(node)->timer - last_tick;
+                if (delta < nearest)
+                {
+                    nearest = delta;
+                }
+            }
+            break;
+        }
+    }
+    #ifdef USES_UIP
+        if ((0 != uip_timer) && (uip_timer < nearest))
+        {
+            nearest = uip_timer;
+        }
+        if ((0 != arp_timer) && (arp_timer < nearest))
+        {
+            nearest = arp_timer;
+        }
+    #endif
+    if (NO_TIMEOUT != nearest)
+    {
+        if (tick_reached(now, last_tick + nearest))
+        {
+            return (0);
+        }
+        nearest = (last_tick + nearest) - now;
+    }
+    return (nearest);
+}
+
+/**
+ *
+ *********************************************************************
+ *
+ * Idle the processor with nothing ready to run. The tick source is
+ *	reprogrammed as a one-shot covering the ticks to the next deadline,
+ *	the port sleeps through it, and the ticks slept are accounted for
+ *	on wake. Any interrupt ends the sleep early. The sleep also ends
+ *	when the next timer hook is due; a hook due during the last tick
+ *	slept runs a tick late.
+ *
+ *	Interrupts are off from the check for work to the sleep, so an
+ *	event posted, or a task made ready, by an ISR in between can't be
+ *	slept through: its interrupt stays pending, ends the sleep, and
+ *	runs once they are back on.
+ *
+ * \param 	none
+ *
+ * \return 	none
+ */
+static void k_tickless_idle(void)
+{
+    os_irq_t s = os_irq_save();
+    timer_t  ticks;
+    timer_t  hook;
+
+#if (PICO_ISR)
+    if (k_isr_posted())
+    {
+        os_irq_restore(s);
+        return;
+    }
+#endif
+    if ((tcb_entry_t *)Q_NULL != k_ready_head(&k_ready_list[0]))
+    {
+        os_irq_restore(s);
+        return;
+    }
+
+    ticks = k_tmr_next();
+
+    if (&k_thook_list.hooks != k_thook_list.hooks.next)
+    {
+        hook = ((t_hook_entry_t *)k_thook_list.hooks.next)->due - k_thook_list.count;
+        if ((hook & 0x80000000UL) || (0 == hook))
+        {
+            hook = 1;
+        }
+        if (hook < ticks)
+        {
+            ticks = hook;
+        }
+    }
+    OS_TRACE(TR_SLEEP, (tcb_entry_t *)Q_NULL, (uintptr_t)ticks);
+    if (1 == ticks)
+    {
+        os_sleep();
+        os_irq_restore(s);
+    }
+    else if (0 != ticks)
+    {
+        os_tick_oneshot(ticks);
+        os_sleep();
+        os_irq_restore(s);
+        os_tick_catchup(os_tick_periodic());
+    }
+    else
+    {
+        os_irq_restore(s);
+    }
+    OS_TRACE(TR_WAKE, (tcb_entry_t *)Q_NULL, 0);
+}
+#endif
+
 /**
  *
  *********************************************************************
  *
  * At each pass through the main loop we determine the time elapsed since
- *	our last entry into this function. The elapsed time is subtracted from
- *	each 'running' task timer (bounded by 0 at underflow). If a task timer
- *	reaches 0 (becomes ready), that task is inserted by priority onto the
- *	ready list.
+ *	our last entry into this function, and step the timer wheel forward
+ *	one tick at a time. Each step expires only the timers on that tick's
+ *	slot, and the tasks they belong to are inserted by priority onto the
+ *	ready list. Once per turn of wheel 0 a slot of the wheels above is
+ *	cascaded down. While wheel 0 is empty the steps go straight to the
+ *	next cascade that has timers to move, so a long absence, or a long
+ *	tickless sleep, costs a step per occupied slot rather than per tick.
  *
  *	Note: two timers used by the UIP or LWIP TCP/IP stacks were updated
  *		in this function call and are conditionally compiled. At the time
@@ -994,11 +3733,14 @@ void os_update_timer(timer_t *timer, timer_t elapsed_time)
  */
 void service_os_timers(void)
 {
-    uint8_t tcb_index;
-	timer_t elapsed_time = os_get_elapsed_time(&last_tick);
+    uint8_t  level;
+    timer_t  tick;
+    timer_t  now          = get_os_ticks();
+	timer_t  elapsed_time = (timer_t)(now - last_tick);
 
     if (0 != elapsed_time)
     {
+        K_LOCK();
 		os_wdt_reset();
         #ifdef USES_UIP
            if ( uip_timer > elapsed_time )
@@ -1018,35 +3760,41 @@ void service_os_timers(void)
                arp_timer =  0;
            }
         #endif
-        for (tcb_index = 0; tcb_index < N_TASKS; tcb_index++)
+        do
         {
-            if ((0 != tcb[tcb_index].gptimer) && (NO_TIMEOUT != tcb[tcb_index].gptimer))
+            tick = last_tick + 1;
+            if (0 == (tick & OS_TMR_MASK))
             {
-                if ( tcb[tcb_index].gptimer > elapsed_time )
-                {
-                    tcb[tcb_index].gptimer -= elapsed_time;
-                }
-                else
-                {
-                   tcb[tcb_index].gptimer = TIME_EXPIRED;
-                }
+                k_tmr_cascade(tick);
             }
-            if ( TCB_TIMING == (tcb[tcb_index].flags & TCB_TIMINGMASK))
+            last_tick = tick;
+            k_tmr_expire(&k_tmr_wheel[0][tick & OS_TMR_MASK]);
+            if (0 == k_tmr_count[0])
             {
-                if ( tcb[tcb_index].timer > elapsed_time )
+                /*
+                 * nothing on wheel 0: on to the tick before the next
+                 *	cascade of a wheel with timers on it, or to now
+                 */
+                for (level = 1; level < OS_TMR_LEVELS; level++)
                 {
-                    tcb[tcb_index].timer -= elapsed_time;
+                    if (0 != k_tmr_count[level])
+                    {
+                        break;
+                    }
                 }
-                else
+                if ((level < OS_TMR_LEVELS) && (level * OS_TMR_BITS < 32))
                 {
-                    tcb[tcb_index].timer  =  TIME_EXPIRED;
-                    tcb[tcb_index].flags &= ~TCB_TIMING;
-                    tcb[tcb_index].flags |=  TCB_TIMEOUT;
-                    kq_ndelete((k_list_t *)&tcb[tcb_index]);
-                    os_resume_task(&tcb[tcb_index]);
+                    tick = last_tick | (((timer_t)1 << (level * OS_TMR_BITS)) - 1);
+                    if ((timer_t)(tick - last_tick) < (timer_t)(now - last_tick))
+                    {
+                        last_tick = tick;
+                        continue;
+                    }
                 }
+                last_tick = now;
             }
-        }
+        } while (last_tick != now);
+        K_UNLOCK();
     }
 }
 /** @}
@@ -0,0 +1,629 @@
+/********************************************************************
+ *
+ *  DESC
+ *
+ *  MODULE NAME:        picoheap.c
+ *
+ *  AUTHOR:        		Dave Sandler
+ *
+ *  DESCRIPTION:        This module contains the pico micro-kernel
+ *						heaps, for blocks of any size. A heap is a two
+ *						level segregated fit allocator: the free blocks
+ *						are on lists by size, found with two bitmaps, so
+ *						allocation and free are O(1). A heap is built of
+ *						regions the caller gives; a target may keep one
+ *						heap in fast RAM and another in slow.
+ *
+ *  EDIT HISTORY:
+ *  BASELINE
+ *  VERSION     INIT    DESCRIPTION OF CHANGE
+ *  --------    ----    ----------------------
+ *   10-18-26   DS  	Module creation.
+ *   10-18-26   DS  	os_heap_alloc() searches the last list for sizes
+ *							too near the top to round up.
+ *
+ *  Copyright (c) 2009 - 2021 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contiki-OS protothreads license:
+ *  Copyright (c) 2004-2005, Swedish Institute of Computer Science.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the Institute nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ *  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *  OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *  HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ ********************************************************************
+ *
+ **! \addtogroup pico_api
+ *! @{
+ *
+ ********************************************************************/
+
+#define PICOHEAP_C
+
+/*
+ ********************************************************************
+ *
+ *   System Includes
+ */
+
+#include "pico.h"
+#include "picoheap.h"
+
+/*
+ ********************************************************************
+ *
+ *   Constants
+ */
+#define	K_HEAP_FREE			0x01UL		/* the block is free				*/
+#define	K_HEAP_PREV_FREE	0x02UL		/* the block in front is free		*/
+#define	K_HEAP_FLAGS		(K_HEAP_FREE | K_HEAP_PREV_FREE)
+
+#define	K_HEAP_ROUND(x)		(((x) + OS_HEAP_ALIGN - 1) & ~(OS_HEAP_ALIGN - 1))
+#define	K_HEAP_HDR			K_HEAP_ROUND(sizeof(k_heap_blk_t))
+#define	K_HEAP_MIN			K_HEAP_ROUND(sizeof(k_heap_link_t))
+#define	K_HEAP_RGN			K_HEAP_ROUND(sizeof(k_heap_rgn_t))
+#define	K_HEAP_FL_SHIFT		(OS_HEAP_SL_LOG2 + OS_HEAP_ALIGN_LOG2)
+#define	K_HEAP_SMALL		(1UL << K_HEAP_FL_SHIFT)
+#define	K_HEAP_MAX			((1UL << OS_HEAP_FL_MAX) - OS_HEAP_ALIGN)
+
+#define	K_HEAP_GUARD		0x5AFEC0DEUL
+#define	K_HEAP_TAIL			0xA5
+
+/*
+ ********************************************************************
+ *
+ *   data types. a free block's list links are kept where its data
+ *	would be. a region starts with its header, and ends with a
+ *	used block of no size, so a merge stops there.
+ */
+typedef struct
+{
+	k_heap_blk_t *next;
+	k_heap_blk_t *prev;
+} k_heap_link_t;
+
+typedef struct k_heap_rgn_s
+{
+	struct k_heap_rgn_s *next;
+	uint32_t             bytes;
+} k_heap_rgn_t;
+
+#define	k_size(b)			((b)->size & ~K_HEAP_FLAGS)
+#define	k_data(b)			((uint8_t *)(b) + K_HEAP_HDR)
+#define	k_link(b)			((k_heap_link_t *)k_data(b))
+#define	k_next_phys(b)		((k_heap_blk_t *)(k_data(b) + k_size(b)))
+#define	k_first(r)			((k_heap_blk_t *)((uint8_t *)(r) + K_HEAP_RGN))
+
+/*
+ *********************************************************
+ *
+ *	the highest and lowest bits set in a word that isn't 0
+ */
+static uint8_t k_fls(uint32_t word)
+{
+	return ((uint8_t)(31 - os_clz32(word)));
+}
+
+static uint8_t k_ffs(uint32_t word)
+{
+	return (k_fls(word & (~word + 1)));
+}
+
+/*
+ *********************************************************
+ *
+ *	the list a size is on. sizes under K_HEAP_SMALL share
+ *	the first power of two, in steps of OS_HEAP_ALIGN.
+ */
+static void k_heap_map(uint32_t size, uint8_t *fl, uint8_t *sl)
+{
+	uint8_t top;
+
+	if (size < K_HEAP_SMALL)
+	{
+		*fl = 0;
+		*sl = (uint8_t)(size >> OS_HEAP_ALIGN_LOG2);
+	}
+	else
+	{
+		top = k_fls(size);
+		*sl = (uint8_t)((size >> (top - OS_HEAP_SL_LOG2)) ^ OS_HEAP_SL);
+		*fl = (uint8_t)(top - (K_HEAP_FL_SHIFT - 1));
+	}
+}
+
+/*
+ *********************************************************
+ *
+ *	put a free block on its list, and take it off
+ */
+static void k_heap_insert(os_heap_t *heap, k_heap_blk_t *blk)
+{
+	k_heap_blk_t *head;
+	uint8_t       fl;
+	uint8_t       sl;
+
+	k_heap_map(k_size(blk), &fl, &sl);
+	head              = heap->free[fl][sl];
+	k_link(blk)->next = head;
+	k_link(blk)->prev = (k_heap_blk_t *)0;
+	if ((k_heap_blk_t *)0 != head)
+	{
+		k_link(head)->prev = blk;
+	}
+	heap->free[fl][sl] = blk;
+	heap->fl_map      |= (1UL << fl);
+	heap->sl_map[fl]  |= (1UL << sl);
+}
+
+static void k_heap_remove(os_heap_t *heap, k_heap_blk_t *blk)
+{
+	k_heap_blk_t *next = k_link(blk)->next;
+	k_heap_blk_t *prev = k_link(blk)->prev;
+	uint8_t       fl;
+	uint8_t       sl;
+
+	k_heap_map(k_size(blk), &fl, &sl);
+	if ((k_heap_blk_t *)0 != next)
+	{
+		k_link(next)->prev = prev;
+	}
+	if ((k_heap_blk_t *)0 != prev)
+	{
+		k_link(prev)->next = next;
+	}
+	else
+	{
+		heap->free[fl][sl] = next;
+		if ((k_heap_blk_t *)0 == next)
+		{
+			heap->sl_map[fl] &= ~(1UL << sl);
+			if (0 == heap->sl_map[fl])
+			{
+				heap->fl_map &= ~(1UL << fl);
+			}
+		}
+	}
+}
+
+/*
+ *********************************************************
+ *
+ *	find a free block of size bytes or more. the size is
+ *	rounded up to the next list, so any block on it fits.
+ *	a size on the last list has no next list to round up
+ *	to; the last list is searched for a block that fits.
+ */
+static k_heap_blk_t *k_heap_find(os_heap_t *heap, uint32_t size)
+{
+	k_heap_blk_t *blk;
+	uint32_t      want = size;
+	uint32_t      map;
+	uint8_t       fl;
+	uint8_t       sl;
+
+	if (size >= K_HEAP_SMALL)
+	{
+		size += (1UL << (k_fls(size) - OS_HEAP_SL_LOG2)) - 1;
+	}
+	k_heap_map(size, &fl, &sl);
+	if (fl >= OS_HEAP_FL)
+	{
+		k_heap_map(want, &fl, &sl);
+		for (blk = heap->free[fl][sl]; (k_heap_blk_t *)0 != blk; blk = k_link(blk)->next)
+		{
+			if (k_size(blk) >= want)
+			{
+				break;
+			}
+		}
+		return (blk);
+	}
+	map = heap->sl_map[fl] & (uint32_t)(~0UL << sl);
+	if (0 == map)
+	{
+		map = (fl + 1 < 32) ? (heap->fl_map & (uint32_t)(~0UL << (fl + 1))) : 0;
+		if (0 == map)
+		{
+			return ((k_heap_blk_t *)0);
+		}
+		fl  = k_ffs(map);
+		map = heap->sl_map[fl];
+	}
+	return (heap->free[fl][k_ffs(map)]);
+}
+
+/*
+ *********************************************************
+ *
+ *! os_heap_init( os_heap_t * )
+ *!
+ *! \param 		heap	the heap
+ *!
+ *!	make an empty heap. os_heap_add() gives it memory.
+ *!
+ *! \return 	none.
+ */
+void os_heap_init(os_heap_t *heap)
+{
+	uint8_t fl;
+	uint8_t sl;
+
+	heap->fl_map = 0;
+	for (fl = 0; fl < OS_HEAP_FL; fl++)
+	{
+		heap->sl_map[fl] = 0;
+		for (sl = 0; sl < OS_HEAP_SL; sl++)
+		{
+			heap->free[fl][sl] = (k_heap_blk_t *)0;
+		}
+	}
+	heap->regions = (void *)0;
+	heap->size    = 0;
+	heap->used    = 0;
+	heap->peak    = 0;
+	heap->failed  = 0;
+	heap->corrupt = 0;
+}
+
+/*
+ *********************************************************
+ *
+ *! os_heap_add( os_heap_t *, void *, uint32_t )
+ *!
+ *! \param 		heap	the heap
+ *! \param 		mem		a region of memory for it
+ *! \param 		bytes	bytes in the region
+ *!
+ *!	add a region to a heap. a region bigger than the largest
+ *!	block goes in as more than one.
+ *!
+ *! \return 	bytes the heap gained, less its headers.
+ */
+uint32_t os_heap_add(os_heap_t *heap, void *mem, uint32_t bytes)
+{
+	uint8_t      *at   = (uint8_t *)K_HEAP_ROUND((size_t)mem);
+	uint32_t      got  = 0;
+	uint32_t      part;
+	k_heap_rgn_t *rgn;
+	k_heap_blk_t *blk;
+	k_heap_blk_t *end;
+
+	if ((uint32_t)(at - (uint8_t *)mem) >= bytes)
+	{
+		return (0);
+	}
+	bytes = (bytes - (uint32_t)(at - (uint8_t *)mem)) & ~(OS_HEAP_ALIGN - 1);
+	while (bytes >= K_HEAP_RGN + 2 * K_HEAP_HDR + K_HEAP_MIN)
+	{
+		part = bytes;
+		if (part > K_HEAP_RGN + 2 * K_HEAP_HDR + K_HEAP_MAX)
+		{
+			part = K_HEAP_RGN + 2 * K_HEAP_HDR + K_HEAP_MAX;
+		}
+		rgn            = (k_heap_rgn_t *)at;
+		rgn->bytes     = part;
+		blk            = k_first(rgn);
+		blk->prev_phys = (k_heap_blk_t *)0;
+		blk->size      = (part - K_HEAP_RGN - 2 * K_HEAP_HDR) | K_HEAP_FREE;
+		end            = k_next_phys(blk);
+		end->prev_phys = blk;
+		end->size      = K_HEAP_PREV_FREE;
+		K_LOCK();
+		rgn->next      = (k_heap_rgn_t *)heap->regions;
+		heap->regions  = rgn;
+		heap->size    += k_size(blk);
+		k_heap_insert(heap, blk);
+		K_UNLOCK();
+		got           += k_size(blk);
+		at            += part;
+		bytes         -= part;
+	}
+	return (got);
+}
+
+/*
+ *********************************************************
+ *
+ *! os_heap_alloc( os_heap_t *, uint32_t )
+ *!
+ *! \param 		heap	the heap
+ *! \param 		size	bytes wanted
+ *!
+ *!	allocate a block, aligned to OS_HEAP_ALIGN. the time taken
+ *!	doesn't depend on the blocks in the heap, but for a size
+ *!	within 1/OS_HEAP_SL of 2^OS_HEAP_FL_MAX, which searches
+ *!	the blocks on the last list.
+ *!
+ *! \return 	the block; 0 if there's none big enough.
+ */
+void *os_heap_alloc(os_heap_t *heap, uint32_t size)
+{
+	k_heap_blk_t *blk;
+	k_heap_blk_t *rest;
+	uint32_t      need = size;
+#if (OS_HEAP_CHECK)
+	uint8_t       i;
+
+	need += 4;
+#endif
+	if ((0 == size) || (need > K_HEAP_MAX))
+	{
+		heap->failed++;
+		return ((void *)0);
+	}
+	need = K_HEAP_ROUND(need);
+	if (need < K_HEAP_MIN)
+	{
+		need = K_HEAP_MIN;
+	}
+	K_LOCK();
+	blk = k_heap_find(heap, need);
+	if ((k_heap_blk_t *)0 == blk)
+	{
+		heap->failed++;
+		K_UNLOCK();
+		return ((void *)0);
+	}
+	k_heap_remove(heap, blk);
+	if (k_size(blk) >= need + K_HEAP_HDR + K_HEAP_MIN)
+	{
+		/*
+		 * split off the rest, and free it. the block after it
+		 *	already knows the one in front is free.
+		 */
+		rest            = (k_heap_blk_t *)(k_data(blk) + need);
+		rest->prev_phys = blk;
+		rest->size      = (k_size(blk) - need - K_HEAP_HDR) | K_HEAP_FREE;
+		blk->size       = need | (blk->size & K_HEAP_FLAGS);
+		k_next_phys(rest)->prev_phys = rest;
+		k_heap_insert(heap, rest);
+	}
+	else
+	{
+		k_next_phys(blk)->size &= ~K_HEAP_PREV_FREE;
+	}
+	blk->size  &= ~K_HEAP_FREE;
+	heap->used += k_size(blk);
+	if (heap->used > heap->peak)
+	{
+		heap->peak = heap->used;
+	}
+#if (OS_HEAP_CHECK)
+	blk->guard = K_HEAP_GUARD;
+	blk->asked = size;
+	for (i = 0; i < 4; i++)
+	{
+		k_data(blk)[size + i] = K_HEAP_TAIL;
+	}
+#endif
+	K_UNLOCK();
+	return (k_data(blk));
+}
+
+/*
+ *********************************************************
+ *
+ *	is a block allocated, with its guards as they were left?
+ */
+static uint8_t k_heap_good(k_heap_blk_t *blk)
+{
+#if (OS_HEAP_CHECK)
+	uint8_t i;
+
+	if ((K_HEAP_GUARD != blk->guard) || (blk->asked + 4 > k_size(blk)))
+	{
+		return (0);
+	}
+	for (i = 0; i < 4; i++)
+	{
+		if (K_HEAP_TAIL != k_data(blk)[blk->asked + i])
+		{
+			return (0);
+		}
+	}
+#endif
+	return (0 == (blk->size & K_HEAP_FREE));
+}
+
+/*
+ *********************************************************
+ *
+ *! os_heap_free( os_heap_t *, void * )
+ *!
+ *! \param 		heap	the heap it came from
+ *! \param 		mem		the block; 0 is let go
+ *!
+ *!	free a block, merged with the free blocks either side.
+ *!
+ *! \return 	OS_SYNC_OK; OS_SYNC_ERR, and the block is left
+ *!				alone and counted in corrupt, if it's free
+ *!				already, or with OS_HEAP_CHECK its guards
+ *!				were written over.
+ */
+uint8_t os_heap_free(os_heap_t *heap, void *mem)
+{
+	k_heap_blk_t *blk;
+	k_heap_blk_t *next;
+
+	if ((void *)0 == mem)
+	{
+		return (OS_SYNC_OK);
+	}
+	blk = (k_heap_blk_t *)((uint8_t *)mem - K_HEAP_HDR);
+	K_LOCK();
+	if (!k_heap_good(blk))
+	{
+		heap->corrupt++;
+		K_UNLOCK();
+		return (OS_SYNC_ERR);
+	}
+#if (OS_HEAP_CHECK)
+	blk->guard = 0;
+#endif
+	heap->used -= k_size(blk);
+	blk->size  |= K_HEAP_FREE;
+	if (blk->size & K_HEAP_PREV_FREE)
+	{
+		k_heap_remove(heap, blk->prev_phys);
+		blk->prev_phys->size += K_HEAP_HDR + k_size(blk);
+		blk = blk->prev_phys;
+	}
+	next = k_next_phys(blk);
+	if (next->size & K_HEAP_FREE)
+	{
+		k_heap_remove(heap, next);
+		blk->size += K_HEAP_HDR + k_size(next);
+		next = k_next_phys(blk);
+	}
+	next->prev_phys = blk;
+	next->size     |= K_HEAP_PREV_FREE;
+	k_heap_insert(heap, blk);
+	K_UNLOCK();
+	return (OS_SYNC_OK);
+}
+
+/*
+ *********************************************************
+ *
+ *! os_heap_stats( os_heap_t *, os_heap_stats_t * )
+ *!
+ *! \param 		heap	the heap
+ *! \param 		stats	where the figures go
+ *!
+ *!	walk every block of the heap, for its figures. it takes
+ *!	time by the blocks in the heap; it's for monitoring.
+ *!
+ *! \return 	none.
+ */
+void os_heap_stats(os_heap_t *heap, os_heap_stats_t *stats)
+{
+	k_heap_rgn_t *rgn;
+	k_heap_blk_t *blk;
+
+	K_LOCK();
+	stats->size        = heap->size;
+	stats->used        = heap->used;
+	stats->peak        = heap->peak;
+	stats->failed      = heap->failed;
+	stats->corrupt     = heap->corrupt;
+	stats->free        = 0;
+	stats->largest     = 0;
+	stats->used_blocks = 0;
+	stats->free_blocks = 0;
+	for (rgn = (k_heap_rgn_t *)heap->regions; (k_heap_rgn_t *)0 != rgn; rgn = rgn->next)
+	{
+		for (blk = k_first(rgn); 0 != k_size(blk); blk = k_next_phys(blk))
+		{
+			if (blk->size & K_HEAP_FREE)
+			{
+				stats->free += k_size(blk);
+				stats->free_blocks++;
+				if (k_size(blk) > stats->largest)
+				{
+					stats->largest = k_size(blk);
+				}
+			}
+			else
+			{
+				stats->used_blocks++;
+			}
+		}
+	}
+	K_UNLOCK();
+	stats->frag = (uint8_t)((0 == stats->free) ? 0 :
+	              100 - (uint32_t)(((uint64_t)stats->largest * 100) / stats->free));
+}
+
+/*
+ *********************************************************
+ *
+ *! os_heap_check( os_heap_t * )
+ *!
+ *! \param 		heap	the heap
+ *!
+ *!	walk every block of the heap, and check that each links
+ *!	to the one in front, that no two free blocks are next to
+ *!	each other, and with OS_HEAP_CHECK, the guards of each
+ *!	block allocated.
+ *!
+ *! \return 	the blocks found bad; 0 if none.
+ */
+uint16_t os_heap_check(os_heap_t *heap)
+{
+	k_heap_rgn_t *rgn;
+	k_heap_blk_t *blk;
+	k_heap_blk_t *next;
+	uint16_t      bad = 0;
+
+	K_LOCK();
+	for (rgn = (k_heap_rgn_t *)heap->regions; (k_heap_rgn_t *)0 != rgn; rgn = rgn->next)
+	{
+		for (blk = k_first(rgn); 0 != k_size(blk); blk = next)
+		{
+			next = k_next_phys(blk);
+			if ((uint8_t *)next > (uint8_t *)rgn + rgn->bytes - K_HEAP_HDR)
+			{
+				bad++;
+				break;
+			}
+			if (blk->size & K_HEAP_FREE)
+			{
+				if ((next->prev_phys != blk) || !(next->size & K_HEAP_PREV_FREE) ||
+				    (next->size & K_HEAP_FREE))
+				{
+					bad++;
+				}
+			}
+			else if (!k_heap_good(blk) || (next->size & K_HEAP_PREV_FREE))
+			{
+				bad++;
+			}
+		}
+	}
+	K_UNLOCK();
+	return (bad);
+}
+
+/*
+ * End picoheap.c
+ * Close the Doxygen group.
+ *! @}
+ *
+ *********************************************************/
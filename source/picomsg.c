@@ -16,6 +16,15 @@
  *   06-20-09   DS  	Module creation.
  *   09-28-12   DS  	os_msg_receive move to picomsg.h in order to
  *						use proto-threads
+ *   10-18-26   DS  	os_msg_send takes the kernel lock for PICO_SMP
+ *   10-18-26   DS  	os_msg_send traced with PICO_TRACE
+ *   10-18-26   DS  	mailboxes first in, first out, with their own
+ *						wait queue. os_msg_take() for os_msg_receive,
+ *						message pools, and replies.
+ *   10-18-26   DS  	priority mailboxes; mailbox limits with a drop
+ *						policy. os_msg_send() says if it was rejected.
+ *   10-18-26   DS  	os_mbox_init_prio() keeps levels to 1 to
+ *						OS_MBOX_LEVELS.
  *
  *  Copyright (c) 2009 - 2021 Dave Sandler
  *
@@ -69,6 +78,7 @@
 #include				"pico.h"
 #include				"picosem.h"
 #include				"picomsg.h"
+#include				"picotrace.h"
 /*
  *********************************************************
  *
@@ -77,8 +87,110 @@
  */
 void os_mbox_init(os_mail_t *mbox)
 {
-	os_sem_init(&mbox->mbox_sem);
-	mbox->msg_queue.next = mbox->msg_queue.last = (k_list_t *)mbox;
+	mbox->msg_queue.next = mbox->msg_queue.last = &mbox->msg_queue;
+	mbox->mbox_wait.next = mbox->mbox_wait.last = &mbox->mbox_wait;
+	mbox->prio_q         = Q_NULL;
+	mbox->prio_map       = 0;
+	mbox->count          = 0;
+	mbox->limit          = 0;
+	mbox->dropped        = 0;
+	mbox->levels         = 1;
+	mbox->policy         = OS_MBOX_REJECT;
+}
+
+/*
+ *********************************************************
+ *
+ * void os_mbox_init_prio(  os_mail_t *mbox, k_list_t *queues, uint8_t levels  )
+ *	initialize a priority Mailbox, with a queue in
+ *	queues[levels] for each message priority, up to
+ *	OS_MBOX_LEVELS; more are not used. with no levels it's
+ *	a plain mailbox. receivers take the most urgent message
+ *	first, and messages of a priority first in, first out.
+ *	a message priority past the last level is taken as the
+ *	last.
+ */
+void os_mbox_init_prio(os_mail_t *mbox, k_list_t *queues, uint8_t levels)
+{
+	uint8_t i;
+
+	os_mbox_init(mbox);
+	if (0 == levels)
+	{
+		return;
+	}
+	if (levels > OS_MBOX_LEVELS)
+	{
+		levels = OS_MBOX_LEVELS;
+	}
+	for (i = 0; i < levels; i++)
+	{
+		queues[i].next = queues[i].last = &queues[i];
+	}
+	mbox->prio_q = queues;
+	mbox->levels = levels;
+}
+
+/*
+ *********************************************************
+ *
+ * void os_mbox_limit(  os_mail_t *mbox, uint16_t limit, uint8_t policy  )
+ *	hold at most limit messages, 0 for no limit, and what
+ *	a send past it does; OS_MBOX_REJECT, OS_MBOX_DROP_OLDEST
+ *	or OS_MBOX_DROP_LOWEST. a plain mailbox has one priority,
+ *	so its last two are the same.
+ */
+void os_mbox_limit(os_mail_t *mbox, uint16_t limit, uint8_t policy)
+{
+	K_LOCK();
+	mbox->limit  = limit;
+	mbox->policy = policy;
+	K_UNLOCK();
+}
+
+/*
+ *********************************************************
+ *
+ *	the queue a priority goes on, and the priorities of the
+ *	most and least urgent messages held, which need a
+ *	priority mailbox that isn't empty.
+ */
+static k_list_t *k_mbox_queue(os_mail_t *mbox, uint8_t prio)
+{
+	if (Q_NULL == mbox->prio_q)
+	{
+		return (&mbox->msg_queue);
+	}
+	return (&mbox->prio_q[(prio < mbox->levels) ? prio : (mbox->levels - 1)]);
+}
+
+static uint8_t k_mbox_first(os_mail_t *mbox)
+{
+	return (os_clz32(mbox->prio_map));
+}
+
+static uint8_t k_mbox_last(os_mail_t *mbox)
+{
+	return (os_clz32(mbox->prio_map & (~mbox->prio_map + 1)));
+}
+
+/*
+ *********************************************************
+ *
+ *	take the first message of a queue, and drop the queue's
+ *	bit in the map when it's the last.
+ */
+static os_msg_t *k_mbox_remove(os_mail_t *mbox, uint8_t prio)
+{
+	k_list_t *queue = k_mbox_queue(mbox, prio);
+	k_list_t *node  = kq_qdelete(queue);
+
+	mbox->count--;
+	if ((Q_NULL != mbox->prio_q) && (queue->next == queue))
+	{
+		mbox->prio_map &= ~(0x80000000UL >> prio);
+	}
+	return ((os_msg_t *)node);
 }
 
 /*
@@ -90,18 +202,201 @@ void os_mbox_init(os_mail_t *mbox)
 void os_msg_init(os_msg_t *msg)
 {
 	msg->msg_list.next = msg->msg_list.last = (k_list_t *)msg;
+	msg->reply         = OS_NO_REPLY;
+	msg->pool          = (os_msg_pool_t *)0;
+	msg->length        = 0;
+	msg->prio          = 0;
+}
+
+/*
+ *********************************************************
+ *
+ * uint8_t os_msg_send(  os_msg_t *msg, os_mail_t *mbox  )
+ *	send a message. it goes behind the messages already
+ *	in the mailbox of its priority, and the first receiver
+ *	waiting is woken. a full mailbox's policy may drop a
+ *	message held to make room.
+ *
+ *	returns OS_SYNC_OK; OS_SYNC_ERR, and the sender keeps
+ *	the message, if a full mailbox rejects it.
+ */
+uint8_t os_msg_send(os_msg_t *msg, os_mail_t *mbox)
+{
+	uint8_t prio = 0;
+
+	K_LOCK();
+	OS_TRACE(TR_MSG_SEND, (tcb_entry_t *)Q_NULL, mbox);
+	if (Q_NULL != mbox->prio_q)
+	{
+		prio = (msg->prio < mbox->levels) ? msg->prio : (mbox->levels - 1);
+	}
+	if ((0 != mbox->limit) && (mbox->count >= mbox->limit))
+	{
+		if ((OS_MBOX_REJECT == mbox->policy) ||
+			((OS_MBOX_DROP_LOWEST == mbox->policy) && (Q_NULL != mbox->prio_q) &&
+			 (prio >= k_mbox_last(mbox))))
+		{
+			mbox->dropped++;
+			K_UNLOCK();
+			return (OS_SYNC_ERR);
+		}
+		mbox->dropped++;
+		os_msg_free(k_mbox_remove(mbox, (Q_NULL != mbox->prio_q) ? k_mbox_last(mbox) : 0));
+	}
+	kq_qinsert(k_mbox_queue(mbox, prio)->last, (k_list_t *)msg);
+	if (Q_NULL != mbox->prio_q)
+	{
+		mbox->prio_map |= (0x80000000UL >> prio);
+	}
+	mbox->count++;
+	os_wake_first(&mbox->mbox_wait);
+	K_UNLOCK();
+	return (OS_SYNC_OK);
+}
+
+/*
+ *********************************************************
+ *
+ * void os_msg_request(  os_msg_t *msg, os_mail_t *mbox, os_mail_t *reply  )
+ *	send a message that the receiver answers with
+ *	os_msg_reply(), to the mailbox reply. returns as
+ *	os_msg_send().
+ */
+uint8_t os_msg_request(os_msg_t *msg, os_mail_t *mbox, os_mail_t *reply)
+{
+	msg->reply = reply;
+	return (os_msg_send(msg, mbox));
+}
+
+/*
+ *********************************************************
+ *
+ * uint8_t os_msg_reply(  os_msg_t *msg  )
+ *	send a message back to its reply mailbox. the same
+ *	buffer carries the answer.
+ *
+ *	returns OS_SYNC_ERR, and the caller keeps the message,
+ *	if there's no reply mailbox or it rejects it.
+ */
+uint8_t os_msg_reply(os_msg_t *msg)
+{
+	os_mail_t *reply = msg->reply;
+
+	if (OS_NO_REPLY == reply)
+	{
+		return (OS_SYNC_ERR);
+	}
+	msg->reply = OS_NO_REPLY;
+	if (OS_SYNC_OK != os_msg_send(msg, reply))
+	{
+		msg->reply = reply;
+		return (OS_SYNC_ERR);
+	}
+	return (OS_SYNC_OK);
 }
 
 /*
  *********************************************************
  *
- * void os_msg_send(  os_msg_t *msg, os_mail_t *mbox, os_mail_t *reply  )
- *	send a message
+ * uint8_t os_msg_take(  os_mail_t *mbox, os_msg_t **msg, timer_t timeout  )
+ *	the body of os_msg_receive. takes the first, most
+ *	urgent message, or waits in priority order for one.
+ *
+ *	returns OS_SYNC_OK with *msg set; OS_SYNC_WAIT if the task
+ *	must wait; OS_SYNC_TIMEOUT with *msg 0.
  */
-void os_msg_send(os_msg_t *msg, os_mail_t *mbox)
+uint8_t os_msg_take(os_mail_t *mbox, os_msg_t **msg, timer_t timeout)
 {
-	kq_qinsert((k_list_t *)mbox, (k_list_t *)msg);
-	os_sem_signal(&mbox->mbox_sem);
+	K_LOCK();
+	if (0 != mbox->count)
+	{
+		*msg = k_mbox_remove(mbox, (Q_NULL != mbox->prio_q) ? k_mbox_first(mbox) : 0);
+		K_UNLOCK();
+		return (OS_SYNC_OK);
+	}
+	*msg = (os_msg_t *)0;
+	if (task_timer_expired(ME) || (NOW == timeout))
+	{
+		ME->flags |= TCB_TIMEOUT;
+		K_UNLOCK();
+		return (OS_SYNC_TIMEOUT);
+	}
+	os_wait_prio(&mbox->mbox_wait, ME, timeout);
+	K_UNLOCK();
+	return (OS_SYNC_WAIT);
+}
+
+/*
+ *********************************************************
+ *
+ * void os_msg_pool_init(  os_msg_pool_t *pool, os_msg_t *msgs,
+ *						   uint8_t *data, uint16_t count, uint16_t size  )
+ *	make a pool of count messages from msgs[count], each
+ *	given size bytes of data[count * size]
+ */
+void os_msg_pool_init(os_msg_pool_t *pool, os_msg_t *msgs, uint8_t *data,
+					  uint16_t count, uint16_t size)
+{
+	uint16_t i;
+
+	pool->free  = Q_NULL;
+	pool->size  = size;
+	pool->avail = count;
+	for (i = count; i != 0; i--)
+	{
+		os_msg_init(&msgs[i - 1]);
+		msgs[i - 1].message       = &data[(uint32_t)(i - 1) * size];
+		msgs[i - 1].pool          = pool;
+		msgs[i - 1].msg_list.next = pool->free;
+		pool->free                = &msgs[i - 1].msg_list;
+	}
+}
+
+/*
+ *********************************************************
+ *
+ * os_msg_t *os_msg_alloc(  os_msg_pool_t *pool  )
+ *	take a message from a pool; 0 if it's empty. the
+ *	caller owns it, and its buffer, until it's sent.
+ */
+os_msg_t *os_msg_alloc(os_msg_pool_t *pool)
+{
+	os_msg_t *msg;
+
+	K_LOCK();
+	msg = (os_msg_t *)pool->free;
+	if ((os_msg_t *)Q_NULL != msg)
+	{
+		pool->free    = msg->msg_list.next;
+		pool->avail--;
+		msg->reply    = OS_NO_REPLY;
+		msg->length   = 0;
+		msg->prio     = 0;
+	}
+	K_UNLOCK();
+	return (msg);
+}
+
+/*
+ *********************************************************
+ *
+ * void os_msg_free(  os_msg_t *msg  )
+ *	give a message back to its pool. a message that's
+ *	not from a pool is left alone.
+ */
+void os_msg_free(os_msg_t *msg)
+{
+	os_msg_pool_t *pool = msg->pool;
+
+	if ((os_msg_pool_t *)0 == pool)
+	{
+		return;
+	}
+	K_LOCK();
+	msg->msg_list.next = pool->free;
+	pool->free         = &msg->msg_list;
+	pool->avail++;
+	K_UNLOCK();
 }
 
 /*
@@ -0,0 +1,405 @@
+/********************************************************************
+ *
+ *  DESC
+ *
+ *  MODULE NAME:        picopool.c
+ *
+ *  AUTHOR:        		Dave Sandler
+ *
+ *  DESCRIPTION:        This module contains the pico micro-kernel
+ *						fixed block memory pools. Allocation and free
+ *						are O(1), and safe against interrupts.
+ *
+ *  EDIT HISTORY:
+ *  BASELINE
+ *  VERSION     INIT    DESCRIPTION OF CHANGE
+ *  --------    ----    ----------------------
+ *   10-18-26   DS  	Module creation.
+ *   10-18-26   DS  	PICO_ARENA task arenas.
+ *   10-18-26   DS  	the kernel lock, then interrupts off with
+ *						os_irq_save(), in that order everywhere. DI()
+ *						is empty on the 16 bit PICs.
+ *   10-18-26   DS  	os_arena_alloc() refuses a size past the block
+ *						before rounding it.
+ *
+ *  Copyright (c) 2009 - 2021 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contiki-OS protothreads license:
+ *  Copyright (c) 2004-2005, Swedish Institute of Computer Science.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the Institute nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ *  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *  OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *  HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ ********************************************************************
+ *
+ **! \addtogroup pico_api
+ *! @{
+ *
+ ********************************************************************/
+
+#define PICOPOOL_C
+
+/*
+ ********************************************************************
+ *
+ *   System Includes
+ */
+
+#include "pico.h"
+#include "picopool.h"
+
+/*
+ *********************************************************
+ *
+ *	take a block, from those freed, then from those never
+ *	used, and put one back. interrupts are held off, with
+ *	os_irq_save() as it nests and masks on every port; the
+ *	kernel lock, where there is one, is taken first.
+ */
+static void *k_pool_get(os_pool_t *pool)
+{
+	void *blk = pool->free;
+
+	if ((void *)0 != blk)
+	{
+		pool->free = *(void **)blk;
+	}
+	else if (pool->next < pool->end)
+	{
+		blk         = pool->next;
+		pool->next += pool->size;
+	}
+	else
+	{
+		pool->failed++;
+		return ((void *)0);
+	}
+	if (++pool->used > pool->high_water)
+	{
+		pool->high_water = pool->used;
+	}
+	return (blk);
+}
+
+static void k_pool_put(os_pool_t *pool, void *blk)
+{
+	*(void **)blk = pool->free;
+	pool->free    = blk;
+	pool->used--;
+}
+
+/*
+ *********************************************************
+ *
+ *! os_pool_init( os_pool_t *, void *, uint16_t, uint16_t )
+ *!
+ *! \param 		pool	the pool
+ *! \param 		mem		count blocks of OS_POOL_BLOCK(size) bytes,
+ *!						aligned to OS_POOL_ALIGN
+ *! \param 		size	bytes in a block
+ *! \param 		count	blocks in the pool
+ *!
+ *!	make a pool of memory given at run time. a pool made with
+ *!	OS_POOL_DEFINE() doesn't need it.
+ *!
+ *! \return 	none.
+ */
+void os_pool_init(os_pool_t *pool, void *mem, uint16_t size, uint16_t count)
+{
+	pool->pool_wait.next = pool->pool_wait.last = &pool->pool_wait;
+	pool->free           = (void *)0;
+	pool->size           = OS_POOL_BLOCK(size);
+	pool->count          = count;
+	pool->next           = (uint8_t *)mem;
+	pool->end            = pool->next + (uint32_t)pool->size * count;
+	pool->used           = 0;
+	pool->high_water     = 0;
+	pool->failed         = 0;
+}
+
+/*
+ *********************************************************
+ *
+ *! os_pool_alloc( os_pool_t * )
+ *!
+ *! \param 		pool	the pool
+ *!
+ *! \return 	a block; 0 if none is free.
+ */
+void *os_pool_alloc(os_pool_t *pool)
+{
+	void    *blk;
+	os_irq_t irq;
+
+	K_LOCK();
+	irq = os_irq_save();
+	blk = k_pool_get(pool);
+	os_irq_restore(irq);
+	K_UNLOCK();
+	return (blk);
+}
+
+/*
+ *********************************************************
+ *
+ *! os_pool_free( os_pool_t *, void * )
+ *!
+ *! \param 		pool	the pool
+ *! \param 		blk		a block from it
+ *!
+ *!	free a block, and wake the first task waiting for one.
+ *!
+ *! \return 	none.
+ */
+void os_pool_free(os_pool_t *pool, void *blk)
+{
+	os_irq_t irq;
+
+	K_LOCK();
+	irq = os_irq_save();
+	k_pool_put(pool, blk);
+	os_irq_restore(irq);
+	os_wake_first(&pool->pool_wait);
+	K_UNLOCK();
+}
+
+/*
+ *********************************************************
+ *
+ *! os_pool_take( os_pool_t *, void **, timer_t )
+ *!
+ *! \param 		pool	the pool
+ *! \param 		blk		where the block goes; 0 if there's none
+ *! \param 		timeout	ticks to wait; NOW to only try,
+ *!						NO_TIMEOUT to wait forever
+ *!
+ *!	the body of os_pool_wait.
+ *!
+ *! \return 	OS_SYNC_OK, OS_SYNC_WAIT or OS_SYNC_TIMEOUT
+ */
+uint8_t os_pool_take(os_pool_t *pool, void **blk, timer_t timeout)
+{
+	os_irq_t irq;
+
+	K_LOCK();
+	irq  = os_irq_save();
+	*blk = k_pool_get(pool);
+	os_irq_restore(irq);
+	if ((void *)0 != *blk)
+	{
+		K_UNLOCK();
+		return (OS_SYNC_OK);
+	}
+	if (task_timer_expired(ME) || (NOW == timeout))
+	{
+		ME->flags |= TCB_TIMEOUT;
+		K_UNLOCK();
+		return (OS_SYNC_TIMEOUT);
+	}
+	os_wait_prio(&pool->pool_wait, ME, timeout);
+	K_UNLOCK();
+	return (OS_SYNC_WAIT);
+}
+
+/*
+ *********************************************************
+ *
+ *! os_pool_alloc_isr( os_pool_t * )
+ *! os_pool_free_isr( os_pool_t *, void * )
+ *!
+ *! \param 		pool	the pool
+ *! \param 		blk		a block from it
+ *!
+ *!	os_pool_alloc() and os_pool_free() for interrupts. they
+ *!	take no kernel lock, and put the interrupt mask back as
+ *!	it was, so an interrupt of higher priority may use the
+ *!	pool too. a free here wakes
+ *!	no task; a task waiting is woken by the next os_pool_free(),
+ *!	its timeout, or an os_pool_wake() from, say, a PICO_ISR
+ *!	event's function.
+ *!
+ *! \return 	a block; 0 if none is free.
+ */
+void *os_pool_alloc_isr(os_pool_t *pool)
+{
+	void    *blk;
+	os_irq_t irq;
+
+	irq = os_irq_save();
+	blk = k_pool_get(pool);
+	os_irq_restore(irq);
+	return (blk);
+}
+
+void os_pool_free_isr(os_pool_t *pool, void *blk)
+{
+	os_irq_t irq;
+
+	irq = os_irq_save();
+	k_pool_put(pool, blk);
+	os_irq_restore(irq);
+}
+
+/*
+ *********************************************************
+ *
+ *! os_pool_wake( os_pool_t * )
+ *!
+ *! \param 		pool	the pool
+ *!
+ *!	wake as many tasks waiting as there are blocks free.
+ *!
+ *! \return 	none.
+ */
+void os_pool_wake(os_pool_t *pool)
+{
+	uint16_t n;
+
+	K_LOCK();
+	for (n = os_pool_avail(pool); n != 0; n--)
+	{
+		if ((tcb_entry_t *)Q_NULL == os_wake_first(&pool->pool_wait))
+		{
+			break;
+		}
+	}
+	K_UNLOCK();
+}
+
+#if (PICO_ARENA)
+/*
+ *********************************************************
+ *
+ *! os_arena_attach( tcb_entry_t *, os_pool_t * )
+ *!
+ *! \param 		task	the task
+ *! \param 		pool	the pool its arena comes from; its
+ *!						block size is the most the arena holds
+ *!
+ *! \return 	none.
+ */
+void os_arena_attach(tcb_entry_t *task, os_pool_t *pool)
+{
+	os_arena_reset(task);
+	task->arena_pool = pool;
+}
+
+/*
+ *********************************************************
+ *
+ *! os_arena_alloc( uint16_t )
+ *!
+ *! \param 		size	bytes wanted
+ *!
+ *!	cut size bytes, aligned, from the running task's arena,
+ *!	taking a block of its pool for it first if need be. the
+ *!	memory lasts until the protothread ends, exits or
+ *!	restarts, so it may hold what a task keeps across waits.
+ *!	os_arena(ME) is the first allocation; a task may keep
+ *!	its state there, and find it again after each wait.
+ *!
+ *! \return 	the memory; 0 if the arena or its pool is spent.
+ */
+void *os_arena_alloc(uint16_t size)
+{
+	tcb_entry_t *task = ME;
+	uint8_t     *mem;
+
+	/*
+	 * a size past the block is refused before it's rounded up,
+	 * which could wrap it to 0
+	 */
+	if (((os_pool_t *)0 == task->arena_pool) || (size > task->arena_pool->size))
+	{
+		return ((void *)0);
+	}
+	if ((uint8_t *)0 == task->arena)
+	{
+		task->arena = (uint8_t *)os_pool_alloc(task->arena_pool);
+		if ((uint8_t *)0 == task->arena)
+		{
+			return ((void *)0);
+		}
+		task->arena_used = 0;
+	}
+	size = (uint16_t)((size + OS_POOL_ALIGN - 1) & ~(OS_POOL_ALIGN - 1));
+	if (size > task->arena_pool->size - task->arena_used)
+	{
+		return ((void *)0);
+	}
+	mem               = task->arena + task->arena_used;
+	task->arena_used += size;
+	if (task->arena_used > task->arena_peak)
+	{
+		task->arena_peak = task->arena_used;
+	}
+	return (mem);
+}
+
+/*
+ *********************************************************
+ *
+ *! os_arena_reset( tcb_entry_t * )
+ *!
+ *! \param 		task	the task
+ *!
+ *!	give a task's arena back to its pool. the kernel does
+ *!	this itself when the protothread ends, exits or restarts,
+ *!	and when the task's tcb is released.
+ *!
+ *! \return 	none.
+ */
+void os_arena_reset(tcb_entry_t *task)
+{
+	if ((uint8_t *)0 != task->arena)
+	{
+		os_pool_free(task->arena_pool, task->arena);
+		task->arena = (uint8_t *)0;
+	}
+	task->arena_used = 0;
+}
+#endif
+
+/*
+ * End picopool.c
+ * Close the Doxygen group.
+ *! @}
+ *
+ *********************************************************/
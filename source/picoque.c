@@ -16,6 +16,12 @@
  *   04-23-07   DS  	Module creation.
  *   09-24-12   DS  	clean up. was never used.
  *   05-21-13   DS  	greatly simplified...
+ *   10-18-26   DS  	os_que_add and os_que_remove traced with PICO_TRACE
+ *   10-18-26   DS  	os_que_write, os_que_read, and spans in place.
+ *						os_que_putarray and os_que_putstring copy in
+ *						bulk.
+ *   10-18-26   DS  	os_ring_t, the lock free single producer and
+ *						single consumer ring.
  *
  *  Copyright (c) 2009 - 2021 Dave Sandler
  *
@@ -77,8 +83,10 @@
  *   System Includes
  */
 
+#include	<string.h>
 #include	"pico.h"
 #include	"picoque.h"
+#include	"picotrace.h"
 
 /*
  ********************************************************************
@@ -156,6 +164,7 @@ uint8_t os_que_add(os_queue_t *q, q_type_t *item)
 {
     if(!os_que_full(q))
     {
+        OS_TRACE(TR_QUE_WRITE, (tcb_entry_t *)Q_NULL, q);
         q->buff[q->inptr++] = *item;
         if (q->inptr == q->qsize)
         {
@@ -182,22 +191,7 @@ uint8_t os_que_add(os_queue_t *q, q_type_t *item)
  */
 q_size_t os_que_putarray(os_queue_t *q, q_type_t *item, q_size_t len)
 {
-    q_size_t putCount;
-    
-    putCount = 0;
-    do
-    {
-        if (Q_SUCCESS == os_que_add(q, item))
-        {
-            item++;
-            putCount++;
-        }
-        else
-        {
-            break;
-        }
-	} while (--len);
-    return (putCount);
+    return (os_que_write(q, item, len));
 }
 
 /*
@@ -213,21 +207,7 @@ q_size_t os_que_putarray(os_queue_t *q, q_type_t *item, q_size_t len)
  */
 q_size_t os_que_putstring(os_queue_t *q, q_type_t *item)
 {
-    q_size_t putCount;
-    
-    putCount = 0;
-    while (*item)
-    {
-        if (Q_SUCCESS == os_que_add(q, item++))
-        {
-            putCount++;
-        }
-        else
-        {
-            break;
-        }
-    }
-    return (putCount);
+    return (os_que_write(q, item, (q_size_t)strlen((const char *)item)));
 }
 
 /*
@@ -245,6 +225,7 @@ uint8_t os_que_remove(os_queue_t *q, q_type_t *item)
 {
     if(!os_que_empty(q))
     {
+        OS_TRACE(TR_QUE_READ, (tcb_entry_t *)Q_NULL, q);
         *item = q->buff[q->outptr++];
         if(q->outptr == q->qsize)
         {
@@ -298,6 +279,393 @@ void os_que_flush(os_queue_t *q)
     q->inptr  = 0;
     q->outptr = 0;
 }
+/*
+ *********************************************************
+ *
+ *! os_que_write( os_queue_t *, const q_type_t *, q_size_t )
+ *!
+ *! \param 		q		the queue
+ *! \param 		src		the items
+ *! \param 		len		how many
+ *!
+ *!	add as many of the items as there's room for, copied in
+ *!	at most two spans. the write index moves once, after.
+ *!
+ *! \return 	number of items added
+ */
+q_size_t os_que_write(os_queue_t *q, const q_type_t *src, q_size_t len)
+{
+    q_size_t in  = q->inptr;
+    q_size_t out = q->outptr;
+    q_size_t room;
+    q_size_t run;
+
+    room = (out > in) ? (q_size_t)(out - in - 1) : (q_size_t)(q->qsize - in + out - 1);
+    if (len > room)
+    {
+        len = room;
+    }
+    if (0 == len)
+    {
+        return (0);
+    }
+    OS_TRACE(TR_QUE_WRITE, (tcb_entry_t *)Q_NULL, q);
+    run = q->qsize - in;
+    if (run > len)
+    {
+        run = len;
+    }
+    memcpy(&q->buff[in], src, run * sizeof(q_type_t));
+    memcpy(&q->buff[0], src + run, (len - run) * sizeof(q_type_t));
+    in += len;
+    if (in >= q->qsize)
+    {
+        in -= q->qsize;
+    }
+    q->inptr = in;
+    return (len);
+}
+
+/*
+ *********************************************************
+ *
+ *! os_que_read( os_queue_t *, q_type_t *, q_size_t )
+ *!
+ *! \param 		q		the queue
+ *! \param 		dst		where the items go
+ *! \param 		len		the most wanted
+ *!
+ *!	remove up to len items, copied out in at most two spans.
+ *!	the read index moves once, after.
+ *!
+ *! \return 	number of items removed
+ */
+q_size_t os_que_read(os_queue_t *q, q_type_t *dst, q_size_t len)
+{
+    q_size_t in  = q->inptr;
+    q_size_t out = q->outptr;
+    q_size_t have;
+    q_size_t run;
+
+    have = (in >= out) ? (q_size_t)(in - out) : (q_size_t)(q->qsize - out + in);
+    if (len > have)
+    {
+        len = have;
+    }
+    if (0 == len)
+    {
+        return (0);
+    }
+    OS_TRACE(TR_QUE_READ, (tcb_entry_t *)Q_NULL, q);
+    run = q->qsize - out;
+    if (run > len)
+    {
+        run = len;
+    }
+    memcpy(dst, &q->buff[out], run * sizeof(q_type_t));
+    memcpy(dst + run, &q->buff[0], (len - run) * sizeof(q_type_t));
+    out += len;
+    if (out >= q->qsize)
+    {
+        out -= q->qsize;
+    }
+    q->outptr = out;
+    return (len);
+}
+
+/*
+ *********************************************************
+ *
+ *! os_que_reserve( os_queue_t *, q_type_t ** )
+ *!
+ *! \param 		q		the queue
+ *! \param 		span	set to the first free item
+ *!
+ *!	the free space that runs on from the write index, without
+ *!	wrapping. fill it, then os_que_commit() what was used.
+ *!	once that wraps to the start, reserve again for the rest.
+ *!
+ *! \return 	items in the span; 0 if the queue is full
+ */
+q_size_t os_que_reserve(os_queue_t *q, q_type_t **span)
+{
+    q_size_t in  = q->inptr;
+    q_size_t out = q->outptr;
+
+    *span = &q->buff[in];
+    if (out > in)
+    {
+        return ((q_size_t)(out - in - 1));
+    }
+    /*
+     * up to the end, less the item kept free if the read index is
+     *	at the start
+     */
+    return ((q_size_t)(q->qsize - in - (0 == out)));
+}
+
+/*
+ *********************************************************
+ *
+ *! os_que_commit( os_queue_t *, q_size_t )
+ *!
+ *! \param 		q		the queue
+ *! \param 		len		items written to the span reserved;
+ *!						no more than os_que_reserve() gave
+ *!
+ *! \return 	none.
+ */
+void os_que_commit(os_queue_t *q, q_size_t len)
+{
+    q_size_t in = q->inptr + len;
+
+    if (0 != len)
+    {
+        OS_TRACE(TR_QUE_WRITE, (tcb_entry_t *)Q_NULL, q);
+    }
+    if (in >= q->qsize)
+    {
+        in -= q->qsize;
+    }
+    q->inptr = in;
+}
+
+/*
+ *********************************************************
+ *
+ *! os_que_peek_span( os_queue_t *, q_type_t ** )
+ *!
+ *! \param 		q		the queue
+ *! \param 		span	set to the first item
+ *!
+ *!	the items that run on from the read index, without
+ *!	wrapping, left on the queue. use them in place, then
+ *!	os_que_consume() them.
+ *!
+ *! \return 	items in the span; 0 if the queue is empty
+ */
+q_size_t os_que_peek_span(os_queue_t *q, q_type_t **span)
+{
+    q_size_t in  = q->inptr;
+    q_size_t out = q->outptr;
+
+    *span = &q->buff[out];
+    return ((in >= out) ? (q_size_t)(in - out) : (q_size_t)(q->qsize - out));
+}
+
+/*
+ *********************************************************
+ *
+ *! os_que_consume( os_queue_t *, q_size_t )
+ *!
+ *! \param 		q		the queue
+ *! \param 		len		items used from the span peeked;
+ *!						no more than os_que_peek_span() gave
+ *!
+ *! \return 	none.
+ */
+void os_que_consume(os_queue_t *q, q_size_t len)
+{
+    q_size_t out = q->outptr + len;
+
+    if (0 != len)
+    {
+        OS_TRACE(TR_QUE_READ, (tcb_entry_t *)Q_NULL, q);
+    }
+    if (out >= q->qsize)
+    {
+        out -= q->qsize;
+    }
+    q->outptr = out;
+}
+
+/*
+ *********************************************************
+ *
+ *! os_ring_init( os_ring_t *, q_size_t, q_type_t * )
+ *!
+ *! \param 		r		the ring
+ *! \param 		size	items in buffer; the ring holds the
+ *!						largest power of two no more than
+ *!						this, up to 32768
+ *! \param 		buffer	the items
+ *!
+ *! \return 	none.
+ */
+void os_ring_init(os_ring_t *r, q_size_t size, q_type_t *buffer)
+{
+    q_size_t items = 1;
+
+    while ((items < 0x8000) && ((q_size_t)(items << 1) <= size))
+    {
+        items <<= 1;
+    }
+    r->buff      = buffer;
+    r->mask      = (q_size_t)(items - 1);
+    r->head      = 0;
+    r->tail_seen = 0;
+    r->tail      = 0;
+    r->head_seen = 0;
+}
+
+/*
+ *********************************************************
+ *
+ *! os_ring_put( os_ring_t *, const q_type_t * )
+ *!
+ *! \param 		r		the ring
+ *! \param 		item	the item
+ *!
+ *!	the producer's. the item is stored before head is,
+ *!	so the consumer never sees head ahead of it.
+ *!
+ *! \return 	Q_SUCCESS, or Q_FULL
+ */
+uint8_t os_ring_put(os_ring_t *r, const q_type_t *item)
+{
+    q_size_t head = r->head;
+
+    if ((q_size_t)(head - r->tail_seen) > r->mask)
+    {
+        r->tail_seen = os_load_acq16(&r->tail);
+        if ((q_size_t)(head - r->tail_seen) > r->mask)
+        {
+            return (Q_FULL);
+        }
+    }
+    OS_TRACE(TR_QUE_WRITE, (tcb_entry_t *)Q_NULL, r);
+    r->buff[head & r->mask] = *item;
+    os_store_rel16(&r->head, (q_size_t)(head + 1));
+    return (Q_SUCCESS);
+}
+
+/*
+ *********************************************************
+ *
+ *! os_ring_get( os_ring_t *, q_type_t * )
+ *!
+ *! \param 		r		the ring
+ *! \param 		item	where the item goes
+ *!
+ *!	the consumer's. the item is read before tail is
+ *!	stored, so the producer never writes over it.
+ *!
+ *! \return 	Q_SUCCESS, or Q_EMPTY
+ */
+uint8_t os_ring_get(os_ring_t *r, q_type_t *item)
+{
+    q_size_t tail = r->tail;
+
+    if (tail == r->head_seen)
+    {
+        r->head_seen = os_load_acq16(&r->head);
+        if (tail == r->head_seen)
+        {
+            return (Q_EMPTY);
+        }
+    }
+    OS_TRACE(TR_QUE_READ, (tcb_entry_t *)Q_NULL, r);
+    *item = r->buff[tail & r->mask];
+    os_store_rel16(&r->tail, (q_size_t)(tail + 1));
+    return (Q_SUCCESS);
+}
+
+/*
+ *********************************************************
+ *
+ *! os_ring_write( os_ring_t *, const q_type_t *, q_size_t )
+ *!
+ *! \param 		r		the ring
+ *! \param 		src		the items
+ *! \param 		len		how many
+ *!
+ *!	the producer's. as many of the items as there's room
+ *!	for, copied in at most two spans, then head once.
+ *!
+ *! \return 	number of items put
+ */
+q_size_t os_ring_write(os_ring_t *r, const q_type_t *src, q_size_t len)
+{
+    q_size_t head = r->head;
+    q_size_t room;
+    q_size_t at;
+    q_size_t run;
+
+    room = (q_size_t)(r->mask + 1 - (q_size_t)(head - r->tail_seen));
+    if (len > room)
+    {
+        r->tail_seen = os_load_acq16(&r->tail);
+        room = (q_size_t)(r->mask + 1 - (q_size_t)(head - r->tail_seen));
+        if (len > room)
+        {
+            len = room;
+        }
+    }
+    if (0 == len)
+    {
+        return (0);
+    }
+    OS_TRACE(TR_QUE_WRITE, (tcb_entry_t *)Q_NULL, r);
+    at  = head & r->mask;
+    run = (q_size_t)(r->mask + 1 - at);
+    if (run > len)
+    {
+        run = len;
+    }
+    memcpy(&r->buff[at], src, run * sizeof(q_type_t));
+    memcpy(&r->buff[0], src + run, (len - run) * sizeof(q_type_t));
+    os_store_rel16(&r->head, (q_size_t)(head + len));
+    return (len);
+}
+
+/*
+ *********************************************************
+ *
+ *! os_ring_read( os_ring_t *, q_type_t *, q_size_t )
+ *!
+ *! \param 		r		the ring
+ *! \param 		dst		where the items go
+ *! \param 		len		the most wanted
+ *!
+ *!	the consumer's. up to len items, copied out in at most
+ *!	two spans, then tail once.
+ *!
+ *! \return 	number of items got
+ */
+q_size_t os_ring_read(os_ring_t *r, q_type_t *dst, q_size_t len)
+{
+    q_size_t tail = r->tail;
+    q_size_t have;
+    q_size_t at;
+    q_size_t run;
+
+    have = (q_size_t)(r->head_seen - tail);
+    if (len > have)
+    {
+        r->head_seen = os_load_acq16(&r->head);
+        have = (q_size_t)(r->head_seen - tail);
+        if (len > have)
+        {
+            len = have;
+        }
+    }
+    if (0 == len)
+    {
+        return (0);
+    }
+    OS_TRACE(TR_QUE_READ, (tcb_entry_t *)Q_NULL, r);
+    at  = tail & r->mask;
+    run = (q_size_t)(r->mask + 1 - at);
+    if (run > len)
+    {
+        run = len;
+    }
+    memcpy(dst, &r->buff[at], run * sizeof(q_type_t));
+    memcpy(dst + run, &r->buff[0], (len - run) * sizeof(q_type_t));
+    os_store_rel16(&r->tail, (q_size_t)(tail + len));
+    return (len);
+}
+
 /*
  * End picoque.c
  * Close the Doxygen group.
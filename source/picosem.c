@@ -2,28 +2,40 @@
  *
  *  DESC
  *
- *  MODULE NAME:        picocque.c
+ *  MODULE NAME:        picosem.c
  *
  *  AUTHOR:        		Dave Sandler
  *
  *  DESCRIPTION:        This module contains the pico micro-kernel
- *						queue functions.
+ *						synchronisation functions.
  *
  *  EDIT HISTORY:
  *  BASELINE
  *  VERSION     INIT    DESCRIPTION OF CHANGE
  *  --------    ----    ----------------------
  *   04-23-07   DS  	Module creation.
- *   09-24-12   DS  	clean up. was never used.
- *   05-21-13   DS  	greatly simplified...
+ *   09-27-12   DS  	modified to use protothreads
+ *   10-18-26   DS  	semaphores restored; the circular queue that had
+ *							taken this file's place moved to picocque.c.
+ *						priority inheritance mutex, reader/writer lock,
+ *							barrier and latch.
+ *						kernel lock taken for PICO_SMP.
+ *						os_sem_signal() traced with PICO_TRACE.
+ *						event flag groups with PICO_NOTIFY.
+ *   10-18-26   DS  	inheritance follows the chain of owners, and is
+ *							worked out again from the waiters left when
+ *							one leaves. os_sem_signal() stops the timers
+ *							of the tasks it wakes.
+ *   10-18-26   DS  	an unlock hands a mutex or write lock to the first
+ *							waiter, so no other task can take it first.
  *
  *  Copyright (c) 2009 - 2021 Dave Sandler
  *
  *  This file is part of pico.
  *
  *  pico is free software: you can redistribute it and/or modify
- *  it under the terms of the GNU Lesser General Public License
- *  as published by the Free Software Foundation, either version 3
+ *  it under the terms of the GNU Lesser General Public License 
+ *  as published by the Free Software Foundation, either version 3 
  *  of the License, or (at your option) any later version.
  *
  *  pico is distributed in the hope that it will be useful,
@@ -69,7 +81,7 @@
  *
  ********************************************************************/
 
-#define PICOCQ_C
+#define 	PICOSEM_C
 
 /*
  ********************************************************************
@@ -77,8 +89,9 @@
  *   System Includes
  */
 
-#include "pico.h"
-#include "picocque.h"
+#include	"pico.h"
+#include	"picosem.h"
+#include	"picotrace.h"
 
 /*
  ********************************************************************
@@ -115,159 +128,590 @@
  *
  *   Prototypes
  */
-// static void increment_index(os_cqueue_t);
-// static void decrement_index(os_cqueue_t);
+static void k_sync_acquired( tcb_entry_t *, os_pi_t * );
+static void k_sync_wait( os_pi_t *, k_list_t *, timer_t );
+
 /*
  ********************************************************************
  *
  *   Constants
  */
 
-/**
- * \brief Helper function to check we need to wrap around the index
- *			when adding an item to the cq.
+/*
+ *********************************************************
  *
- * \param cq the cq
+ *! os_sem_init( os_sem_t * )
+ *!
+ *! \param 		sem		the semaphore
+ *!
+ *!	initialize a semaphore; no count, nobody waiting
+ *!
+ *! \return 	none.
+ */
+void os_sem_init(os_sem_t *sem)
+{
+    sem->sem_count     = 0;
+    sem->sem_link.next = sem->sem_link.last = (k_list_t *)sem;
+}
+
+/*
+ *********************************************************
  *
- * \return void
+ *! os_sem_signal( os_sem_t * )
+ *!
+ *! \param 		sem		the semaphore
+ *!
+ *!	resume anyone waiting on the semaphore, and bump the
+ *!	count. the waiters sort out who gets it in os_sem_wait.
+ *!	their timeouts are stopped, lest one fire after.
+ *!
+ *! \return 	none.
  */
-static void cq_increment_index(os_cqueue_t *cq)
+void os_sem_signal(os_sem_t *sem)
 {
-	// see if we need to wrap around
-	if (cq->isfull)
-		cq->tail = (cq->tail + 1) % cq->qsize;
+    tcb_entry_t *task;
 
-	// adjust indexes
-	cq->head   = (cq->head + 1) % cq->qsize;
-	cq->isfull = (cq->head == cq->tail);
+    K_LOCK();
+    OS_TRACE(TR_SEM_SIGNAL, (tcb_entry_t *)Q_NULL, sem);
+    while (sem->sem_link.next != (k_list_t *)sem)
+    {
+        task = (tcb_entry_t *)sem->sem_link.next;
+        os_stop_task_timer(task);
+        os_resume_task(task);
+    }
+    sem->sem_count++;
+    K_UNLOCK();
 }
 
-/**
- * \brief Helper function to decrement current index when removing an item
+/*
+ *********************************************************
+ *
+ *! os_sem_peek( os_sem_t * )
+ *!
+ *! \param 		sem		the semaphore
+ *!
+ *! \return 	the semaphore count.
+ */
+uint8_t os_sem_peek(os_sem_t *sem)
+{
+    return (sem->sem_count);
+}
+
+/*
+ *********************************************************
+ *
+ *! os_mutex_init( os_mutex_t * )
+ *!
+ *! \param 		mtx		the mutex
+ *!
+ *!	initialize a mutex; unlocked, nobody waiting
+ *!
+ *! \return 	none.
+ */
+void os_mutex_init(os_mutex_t *mtx)
+{
+    mtx->pi.wait.next = mtx->pi.wait.last = &mtx->pi.wait;
+    mtx->pi.rd_wait   = Q_NULL;
+    mtx->pi.owner     = (tcb_entry_t *)Q_NULL;
+    mtx->pi.next      = (os_pi_t *)0;
+    mtx->pi.count     = 0;
+}
+
+/*
+ *********************************************************
  *
- * \param cq
+ *! os_mutex_take( os_mutex_t *, timer_t )
+ *!
+ *! \param 		mtx		the mutex
+ *! \param 		timeout	ticks to wait; NOW to only try,
+ *!						NO_TIMEOUT to wait forever
+ *!
+ *!	the body of os_mutex_lock, called again each time the
+ *!	task is woken. the owner may lock again; each lock
+ *!	needs an unlock. while a task waits, the owner runs at
+ *!	the waiter's priority if that's higher, and so on down
+ *!	the chain if the owner waits in turn. when a waiter
+ *!	leaves, or the owner lets go of a lock, the owner's
+ *!	priority is worked out again from the waiters left.
+ *!	a waiter woken by os_mutex_unlock already owns the
+ *!	mutex, and takes it here.
+ *!
+ *! \return 	OS_SYNC_OK		the task owns the mutex
+ *!				OS_SYNC_WAIT	the task is waiting; return
+ *!				OS_SYNC_TIMEOUT	timed out; TCB_TIMEOUT is set
+ */
+uint8_t os_mutex_take(os_mutex_t *mtx, timer_t timeout)
+{
+    K_LOCK();
+    if ((tcb_entry_t *)Q_NULL == mtx->pi.owner)
+    {
+        mtx->pi.count = 1;
+        k_sync_acquired(ME, &mtx->pi);
+        K_UNLOCK();
+        return (OS_SYNC_OK);
+    }
+    if (ME == mtx->pi.owner)
+    {
+        mtx->pi.count++;
+        K_UNLOCK();
+        return (OS_SYNC_OK);
+    }
+    if (task_timer_expired(ME) || (NOW == timeout))
+    {
+        ME->flags |= TCB_TIMEOUT;
+        K_UNLOCK();
+        return (OS_SYNC_TIMEOUT);
+    }
+    k_sync_wait(&mtx->pi, &mtx->pi.wait, timeout);
+    K_UNLOCK();
+    return (OS_SYNC_WAIT);
+}
+
+/*
+ *********************************************************
  *
- * \return void
+ *! os_mutex_unlock( os_mutex_t * )
+ *!
+ *! \param 		mtx		the mutex
+ *!
+ *!	undo one lock. the last one hands the mutex to the
+ *!	highest priority waiter, and wakes it, so no task that
+ *!	runs before it can take the mutex first.
+ *!
+ *! \return 	OS_SYNC_OK; OS_SYNC_ERR if ME hasn't locked it
  */
-static void cq_deccrement_index(os_cqueue_t *cq)
+uint8_t os_mutex_unlock(os_mutex_t *mtx)
 {
-	cq->isfull = FALSE;						 // no longer full
-	cq->tail   = (cq->tail + 1) % cq->qsize; // wrap around if needed.
+    K_LOCK();
+    if ((ME != mtx->pi.owner) || (0 == mtx->pi.count))
+    {
+        K_UNLOCK();
+        return (OS_SYNC_ERR);
+    }
+    if (0 == --mtx->pi.count)
+    {
+        os_pi_release(ME, &mtx->pi);
+    }
+    K_UNLOCK();
+    return (OS_SYNC_OK);
 }
 
 /*
  *********************************************************
  *
- *! os_que_init( os_cqueue_t *, size, BUFFER)
+ *! os_rwlock_init( os_rwlock_t * )
  *!
- *! \param 		none.
+ *! \param 		rw		the lock
  *!
- *!	This function will initialize a queue
+ *!	initialize a reader/writer lock; free, nobody waiting
  *!
  *! \return 	none.
  */
-void os_cque_init(os_cqueue_t *cq, cq_size_t qsize, uint8_t *buffer)
+void os_rwlock_init(os_rwlock_t *rw)
 {
-	cq->qsize  = qsize;
-	cq->head   = 0;
-	cq->tail   = 0;
-	cq->buff   = buffer;
-	cq->isfull = FALSE;
+    rw->rd_wait.next = rw->rd_wait.last = &rw->rd_wait;
+    rw->pi.wait.next = rw->pi.wait.last = &rw->pi.wait;
+    rw->pi.rd_wait   = &rw->rd_wait;
+    rw->pi.owner     = (tcb_entry_t *)Q_NULL;
+    rw->pi.next      = (os_pi_t *)0;
+    rw->pi.count     = 0;
+    rw->readers      = 0;
 }
 
 /*
  *********************************************************
  *
- *! os_que_add( os_queue_t *, q_type_t * )
+ *! os_rwlock_take( os_rwlock_t *, uint8_t, timer_t )
  *!
- *! \param 		none.
+ *! \param 		rw		the lock
+ *! \param 		write	non-zero for sole (write) use
+ *! \param 		timeout	ticks to wait; NOW to only try,
+ *!						NO_TIMEOUT to wait forever
  *!
- *!	This function will add an item to a queue
+ *!	the body of os_rwlock_read and os_rwlock_write. any
+ *!	number of readers share the lock; a writer has it to
+ *!	itself. a waiting writer holds off new readers, so a
+ *!	stream of readers can't starve it. a writer inherits
+ *!	the priority of the tasks it keeps waiting, as with a
+ *!	mutex; readers don't. a writer is woken already holding
+ *!	the lock; see os_rwlock_unlock.
  *!
- *! \return 	status.
+ *! \return 	OS_SYNC_OK		the task holds the lock
+ *!				OS_SYNC_WAIT	the task is waiting; return
+ *!				OS_SYNC_TIMEOUT	timed out; TCB_TIMEOUT is set
  */
-uint8_t os_cque_add(os_cqueue_t *cq, cq_type_t *item)
+uint8_t os_rwlock_take(os_rwlock_t *rw, uint8_t write, timer_t timeout)
 {
-	if (!os_cque_full(cq))
-	{
-		cq->buff[cq->head] = *item;
-		cq_increment_index(cq);
-		return (Q_SUCCESS);
-	}
-	else
-	{
-		return (Q_FULL);
-	}
+    K_LOCK();
+    if ((ME == rw->pi.owner) && (0 == rw->pi.count))
+    {
+        rw->pi.count = 1;
+        K_UNLOCK();
+        return (OS_SYNC_OK);
+    }
+    if ((tcb_entry_t *)Q_NULL == rw->pi.owner)
+    {
+        if (write && (0 == rw->readers))
+        {
+            rw->pi.count = 1;
+            k_sync_acquired(ME, &rw->pi);
+            K_UNLOCK();
+            return (OS_SYNC_OK);
+        }
+        if (!write && (rw->pi.wait.next == &rw->pi.wait))
+        {
+            rw->readers++;
+            ME->flags &= ~TCB_TIMEOUT;
+            os_stop_task_timer(ME);
+            K_UNLOCK();
+            return (OS_SYNC_OK);
+        }
+    }
+    if (task_timer_expired(ME) || (NOW == timeout))
+    {
+        ME->flags |= TCB_TIMEOUT;
+        K_UNLOCK();
+        return (OS_SYNC_TIMEOUT);
+    }
+    k_sync_wait(&rw->pi, write ? &rw->pi.wait : &rw->rd_wait, timeout);
+    K_UNLOCK();
+    return (OS_SYNC_WAIT);
 }
 
 /*
  *********************************************************
  *
- *! os_que_remove( os_queue_t *, q_type_t *)
+ *! os_rwlock_unlock( os_rwlock_t * )
  *!
- *! \param 		none.
+ *! \param 		rw		the lock
  *!
- *!	This function will remove an item from a queue
+ *!	let go of a reader/writer lock. a writer leaving hands
+ *!	it to the next writer if there is one, else wakes every
+ *!	reader. the last reader leaving hands it to the next
+ *!	writer.
  *!
- *! \return 	status.
+ *! \return 	OS_SYNC_OK; OS_SYNC_ERR if ME doesn't hold it
  */
-uint8_t os_cque_remove(os_cqueue_t *cq, cq_type_t *item)
+uint8_t os_rwlock_unlock(os_rwlock_t *rw)
 {
-	if (!os_cque_empty(cq))
-	{
-		*item = cq->buff[cq->tail];
-		cq_deccrement_index(cq);
-		return (Q_SUCCESS);
-	}
-	else
-	{
-		return (Q_EMPTY);
-	}
+    K_LOCK();
+    if ((ME == rw->pi.owner) && (0 != rw->pi.count))
+    {
+        os_pi_release(ME, &rw->pi);
+    }
+    else if (0 != rw->readers)
+    {
+        if (0 == --rw->readers)
+        {
+            os_pi_handoff(&rw->pi);
+        }
+    }
+    else
+    {
+        K_UNLOCK();
+        return (OS_SYNC_ERR);
+    }
+    K_UNLOCK();
+    return (OS_SYNC_OK);
 }
 
 /*
  *********************************************************
  *
- *! os_que_peek( os_queue_t *, q_type_t *)
+ *! os_barrier_init( os_barrier_t *, uint8_t )
  *!
- *! \param 		none.
+ *! \param 		bar		the barrier
+ *! \param 		count	tasks that meet at the barrier
  *!
- *!	extract an item, but leave it on the queue
+ *! \return 	none.
+ */
+void os_barrier_init(os_barrier_t *bar, uint8_t count)
+{
+    bar->bar_wait.next = bar->bar_wait.last = &bar->bar_wait;
+    bar->count         = count;
+    bar->arrived       = 0;
+}
+
+/*
+ *********************************************************
+ *
+ *! os_barrier_arrive( os_barrier_t * )
  *!
- *! \return 	status.
+ *! \param 		bar		the barrier
+ *!
+ *!	the body of os_barrier_wait. the last task to arrive
+ *!	wakes the rest and carries on; the barrier is then
+ *!	ready for the next round.
+ *!
+ *! \return 	OS_SYNC_OK; OS_SYNC_WAIT if the task must wait
  */
-uint8_t os_cque_peek(os_cqueue_t *cq, cq_type_t *item)
+uint8_t os_barrier_arrive(os_barrier_t *bar)
 {
-	if (!os_cque_empty(cq))
-	{
-		*item = cq->buff[cq->tail];
-		return (Q_SUCCESS);
-	}
-	else
-	{
-		return (Q_EMPTY);
-	}
+    K_LOCK();
+    if (++bar->arrived >= bar->count)
+    {
+        bar->arrived = 0;
+        os_wake_all(&bar->bar_wait);
+        K_UNLOCK();
+        return (OS_SYNC_OK);
+    }
+    os_wait_prio(&bar->bar_wait, ME, NO_TIMEOUT);
+    K_UNLOCK();
+    return (OS_SYNC_WAIT);
 }
 
 /*
  *********************************************************
  *
- *! os_que_flush( os_queue_t *)
+ *! os_latch_init( os_latch_t *, uint16_t )
  *!
- *! \param 		none.
+ *! \param 		latch	the latch
+ *! \param 		count	count downs before it opens
  *!
- *!	This function will flush a queue
+ *! \return 	none.
+ */
+void os_latch_init(os_latch_t *latch, uint16_t count)
+{
+    latch->latch_wait.next = latch->latch_wait.last = &latch->latch_wait;
+    latch->count           = count;
+}
+
+/*
+ *********************************************************
+ *
+ *! os_latch_count_down( os_latch_t * )
+ *!
+ *! \param 		latch	the latch
+ *!
+ *!	count the latch down. at zero it opens, waking every
+ *!	task waiting on it, and stays open.
  *!
  *! \return 	none.
  */
-void os_cque_flush(os_cqueue_t *cq)
+void os_latch_count_down(os_latch_t *latch)
 {
-	cq->tail   = 0;
-	cq->head   = 0;
-	cq->isfull = 0;
+    K_LOCK();
+    if ((0 != latch->count) && (0 == --latch->count))
+    {
+        os_wake_all(&latch->latch_wait);
+    }
+    K_UNLOCK();
 }
+
+/*
+ *********************************************************
+ *
+ *! os_latch_check( os_latch_t * )
+ *!
+ *! \param 		latch	the latch
+ *!
+ *!	the body of os_latch_wait.
+ *!
+ *! \return 	OS_SYNC_OK if open; OS_SYNC_WAIT if the task
+ *!				must wait
+ */
+uint8_t os_latch_check(os_latch_t *latch)
+{
+    K_LOCK();
+    if (0 == latch->count)
+    {
+        K_UNLOCK();
+        return (OS_SYNC_OK);
+    }
+    os_wait_prio(&latch->latch_wait, ME, NO_TIMEOUT);
+    K_UNLOCK();
+    return (OS_SYNC_WAIT);
+}
+
+#if (PICO_NOTIFY)
+/*
+ *********************************************************
+ *
+ *! os_flags_init( os_flags_t * )
+ *!
+ *! \param 		grp		the event flag group
+ *!
+ *! \return 	none.
+ */
+void os_flags_init(os_flags_t *grp)
+{
+    grp->flg_wait.next = grp->flg_wait.last = &grp->flg_wait;
+    grp->flags         = 0;
+}
+
+/*
+ *********************************************************
+ *
+ *	are the bits a task waits for there?
+ */
+static uint8_t k_flags_met(uint32_t got, uint32_t bits, uint8_t mode)
+{
+    return ((mode & OS_FLAGS_ALL) ? (got == bits) : (0 != got));
+}
+
+/*
+ *********************************************************
+ *
+ *! os_flags_set( os_flags_t *, uint32_t )
+ *!
+ *! \param 		grp		the event flag group
+ *! \param 		bits	the flags to set
+ *!
+ *!	set flags, and wake each waiter whose wait they meet, in
+ *!	priority order. a waiter with OS_FLAGS_CLEAR consumes its
+ *!	bits before the next is checked. the rest stay waiting.
+ *!
+ *! \return 	none.
+ */
+void os_flags_set(os_flags_t *grp, uint32_t bits)
+{
+    k_list_t    *node;
+    tcb_entry_t *task;
+    uint32_t     got;
+
+    K_LOCK();
+    grp->flags |= bits;
+    for (node = grp->flg_wait.next; &grp->flg_wait != node; )
+    {
+        task = (tcb_entry_t *)node;
+        node = node->next;
+        got  = grp->flags & task->wait_bits;
+        if (k_flags_met(got, task->wait_bits, task->wait_mode))
+        {
+            if (task->wait_mode & OS_FLAGS_CLEAR)
+            {
+                grp->flags &= ~got;
+            }
+            task->wait_bits  = got;
+            task->wait_mode |= OS_FLAGS_DONE;
+            os_stop_task_timer(task);
+            os_resume_task(task);
+        }
+    }
+    K_UNLOCK();
+}
+
+/*
+ *********************************************************
+ *
+ *! os_flags_clear( os_flags_t *, uint32_t )
+ *!
+ *! \param 		grp		the event flag group
+ *! \param 		bits	the flags to clear
+ *!
+ *! \return 	the flags before they were cleared.
+ */
+uint32_t os_flags_clear(os_flags_t *grp, uint32_t bits)
+{
+    uint32_t was;
+
+    K_LOCK();
+    was         = grp->flags;
+    grp->flags &= ~bits;
+    K_UNLOCK();
+    return (was);
+}
+
+/*
+ *********************************************************
+ *
+ *! os_flags_peek( os_flags_t * )
+ *!
+ *! \param 		grp		the event flag group
+ *!
+ *! \return 	the flags now set.
+ */
+uint32_t os_flags_peek(os_flags_t *grp)
+{
+    return (grp->flags);
+}
+
+/*
+ *********************************************************
+ *
+ *! os_flags_take( os_flags_t *, uint32_t, uint8_t, timer_t )
+ *!
+ *! \param 		grp		the event flag group
+ *! \param 		bits	the flags to wait for
+ *! \param 		mode	OS_FLAGS_ANY or OS_FLAGS_ALL, and
+ *!						OS_FLAGS_CLEAR
+ *! \param 		timeout	ticks to wait; NOW to only try,
+ *!						NO_TIMEOUT to wait forever
+ *!
+ *!	the body of os_flags_wait. a task woken by os_flags_set
+ *!	finds its result already in ME->wait_bits.
+ *!
+ *! \return 	OS_SYNC_OK, OS_SYNC_WAIT or OS_SYNC_TIMEOUT
+ */
+uint8_t os_flags_take(os_flags_t *grp, uint32_t bits, uint8_t mode, timer_t timeout)
+{
+    uint32_t got;
+
+    K_LOCK();
+    if (ME->wait_mode & OS_FLAGS_DONE)
+    {
+        ME->wait_mode = 0;
+        K_UNLOCK();
+        return (OS_SYNC_OK);
+    }
+    ME->wait_mode = 0;
+    got = grp->flags & bits;
+    if (k_flags_met(got, bits, mode))
+    {
+        if (mode & OS_FLAGS_CLEAR)
+        {
+            grp->flags &= ~got;
+        }
+        ME->wait_bits = got;
+        K_UNLOCK();
+        return (OS_SYNC_OK);
+    }
+    if (task_timer_expired(ME) || (NOW == timeout))
+    {
+        ME->flags    |= TCB_TIMEOUT;
+        ME->wait_bits = got;
+        K_UNLOCK();
+        return (OS_SYNC_TIMEOUT);
+    }
+    ME->wait_bits = bits;
+    ME->wait_mode = mode;
+    os_wait_prio(&grp->flg_wait, ME, timeout);
+    K_UNLOCK();
+    return (OS_SYNC_WAIT);
+}
+#endif
+
+/*
+ *********************************************************
+ *
+ *	a task has taken a free mutex or write lock. cancel its
+ *	wait timeout, and give it the lock; see os_pi_acquire().
+ */
+static void k_sync_acquired(tcb_entry_t *task, os_pi_t *pi)
+{
+    task->flags &= ~TCB_TIMEOUT;
+    os_stop_task_timer(task);
+    os_pi_acquire(task, pi);
+}
+
+/*
+ *********************************************************
+ *
+ *	ME waits on one of a lock's queues. note what it waits
+ *	for, so a boost can follow it, and lend the owner its
+ *	priority. leaving the queue, it gives it back; see
+ *	k_task_unlink().
+ */
+static void k_sync_wait(os_pi_t *pi, k_list_t *queue, timer_t timeout)
+{
+    os_wait_prio(queue, ME, timeout);
+    ME->pi_wait  = pi;
+    ME->pi_queue = queue;
+    os_pi_reprio(pi->owner);
+}
+
 /*
- * End picoque.c
+ * End picosem.c
  * Close the Doxygen group.
  *! @}
  *
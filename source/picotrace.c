@@ -0,0 +1,349 @@
+/********************************************************************
+ *
+ *  DESC
+ *
+ *  MODULE NAME:        picotrace.c
+ *
+ *  AUTHOR:        		Dave Sandler
+ *
+ *  DESCRIPTION:        This module contains the pico micro-kernel
+ *						event trace. Kernel events are written, with a
+ *						os_cycle_count() stamp, to a ring of compact
+ *						binary records that is drained in bulk, over a
+ *						UART or the like, and decoded on a host by
+ *						tools/trace2json.c. Once full, the ring keeps the
+ *						newest records. Placed with OS_TRACE_SECTION in
+ *						RAM that survives a reset, the ring carries on
+ *						from where it was, behind a TR_BOOT record.
+ *
+ *  EDIT HISTORY:
+ *  BASELINE
+ *  VERSION     INIT    DESCRIPTION OF CHANGE
+ *  --------    ----    ----------------------
+ *   10-18-26   DS  	Module creation.
+ *   10-18-26   DS  	a slot is claimed with os_irq_save(), or an atomic
+ *							add. os_trace_dump() writes in pieces a
+ *							uint16_t length can hold.
+ *
+ *  Copyright (c) 2009 - 2021 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contiki-OS protothreads license:
+ *  Copyright (c) 2004-2005, Swedish Institute of Computer Science.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the Institute nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ *  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *  OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *  HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ ********************************************************************
+ *
+ **! \addtogroup pico_api
+ *! @{
+ *
+ ********************************************************************/
+
+#define PICOTRACE_C
+
+/*
+ ********************************************************************
+ *
+ *   System Includes
+ */
+
+#include "pico.h"
+#include "picotrace.h"
+
+#if (PICO_TRACE)
+/*
+ ********************************************************************
+ *
+ *   Constants
+ */
+#define	TRACE_MASK		(OS_TRACE_SIZE - 1)
+#define	TRACE_CHUNK		(0xFFFFU / sizeof(os_trace_rec_t))	/* records per write */
+
+/*
+ ********************************************************************
+ *
+ *   Module Globals
+ */
+typedef struct
+{
+    uint32_t		magic;
+    uint32_t		head;					/* records written					*/
+    uint32_t		tail;					/* records drained					*/
+    uint32_t		lost;					/* overwritten before being drained	*/
+    os_trace_rec_t	rec[OS_TRACE_SIZE];
+} k_trace_t;
+
+static k_trace_t			k_trace OS_TRACE_SECTION;
+static volatile uint32_t	k_trace_on;		/* events recorded, 1 << event		*/
+
+/*
+ ********************************************************************
+ *
+ *   Prototypes
+ */
+static void k_trace_write( void (*)(const uint8_t *, uint16_t), const os_trace_rec_t *, uint32_t );
+
+/*
+ *********************************************************
+ *
+ *! os_trace_init( void )
+ *!
+ *! \param 		none.
+ *!
+ *!	Set up the trace ring. Called by os_init(). A ring kept over a
+ *!	reset is carried on, marked with a TR_BOOT record; otherwise it
+ *!	starts empty. Recording starts with OS_TRACE_MASK.
+ *!
+ *! \return 	none.
+ */
+void os_trace_init(void)
+{
+    if ((OS_TRACE_MAGIC != k_trace.magic) ||
+        ((uint32_t)(k_trace.head - k_trace.tail) & 0x80000000UL))
+    {
+        k_trace.head  = 0;
+        k_trace.tail  = 0;
+        k_trace.lost  = 0;
+        k_trace.magic = OS_TRACE_MAGIC;
+        k_trace_on    = OS_TRACE_MASK;
+    }
+    else
+    {
+        k_trace_on    = OS_TRACE_MASK;
+        os_trace(TR_BOOT, (tcb_entry_t *)Q_NULL, (const void *)0);
+    }
+}
+
+/*
+ *********************************************************
+ *
+ *! os_trace( uint8_t, tcb_entry_t *, const void * )
+ *!
+ *! \param 		event	TR_ event code
+ *! \param 		task	the task concerned, or NULL
+ *! \param 		obj		the object concerned, or NULL
+ *!
+ *!	Record an event, if it's in the trace mask. A slot is claimed
+ *!	with an atomic add where the port has one, else with interrupts
+ *!	off as they nest, so an ISR or another core may trace as well.
+ *!
+ *! \return 	none.
+ */
+void os_trace(uint8_t event, tcb_entry_t *task, const void *obj)
+{
+    os_trace_rec_t *rec;
+    uint32_t        slot;
+#ifndef os_atomic_add32
+    os_irq_t        irq;
+#endif
+
+    if (0 == (k_trace_on & (1UL << event)))
+    {
+        return;
+    }
+#ifdef os_atomic_add32
+    slot = os_atomic_add32(&k_trace.head, 1);
+#else
+    irq  = os_irq_save();
+    slot = k_trace.head++;
+    os_irq_restore(irq);
+#endif
+    rec        = &k_trace.rec[slot & TRACE_MASK];
+    rec->stamp = os_cycle_count();
+    rec->obj   = (uint32_t)(uintptr_t)obj;
+    rec->task  = ((tcb_entry_t *)Q_NULL == task) ? OS_TRACE_NO_TASK
+                                                 : (uint16_t)os_get_task_index(task);
+    rec->event = event;
+#if (PICO_SMP)
+    rec->core  = os_core_id();
+#else
+    rec->core  = 0;
+#endif
+}
+
+/*
+ *********************************************************
+ *
+ *! os_trace_mask( uint32_t )
+ *!
+ *! \param 		mask	events to record, 1 << event; 0 stops the trace
+ *!
+ *!	Choose the events recorded.
+ *!
+ *! \return 	the mask it replaces.
+ */
+uint32_t os_trace_mask(uint32_t mask)
+{
+    uint32_t old = k_trace_on;
+
+    k_trace_on = mask;
+    return (old);
+}
+
+/*
+ *********************************************************
+ *
+ *! k_trace_drained( void )
+ *!
+ *!	Count the records overwritten since the last drain, and move the
+ *!	tail past them.
+ *!
+ *! \return 	records waiting to be drained.
+ */
+static uint32_t k_trace_drained(void)
+{
+    uint32_t waiting = k_trace.head - k_trace.tail;
+
+    if (waiting > OS_TRACE_SIZE)
+    {
+        k_trace.lost += waiting - OS_TRACE_SIZE;
+        k_trace.tail  = k_trace.head - OS_TRACE_SIZE;
+        waiting       = OS_TRACE_SIZE;
+    }
+    return (waiting);
+}
+
+/*
+ *********************************************************
+ *
+ *! os_trace_read( os_trace_rec_t *, uint16_t )
+ *!
+ *! \param 		buf		where to copy the records
+ *! \param 		max		room in buf, in records
+ *!
+ *!	Drain the oldest records into buf.
+ *!
+ *! \return 	records copied.
+ */
+uint16_t os_trace_read(os_trace_rec_t *buf, uint16_t max)
+{
+    uint32_t waiting;
+    uint16_t count = 0;
+
+    K_LOCK();
+    waiting = k_trace_drained();
+    while ((count < max) && (count < waiting))
+    {
+        buf[count++] = k_trace.rec[k_trace.tail++ & TRACE_MASK];
+    }
+    K_UNLOCK();
+    return (count);
+}
+
+/*
+ *********************************************************
+ *
+ *! os_trace_dump( void (*)(const uint8_t *, uint16_t) )
+ *!
+ *! \param 		write	raw output, e.g. to a UART. It must not
+ *!						translate line endings, as UARTwrite() does.
+ *!
+ *!	Drain the ring in bulk: an os_trace_hdr_t, then the records oldest
+ *!	first, in as few writes as a uint16_t length allows. Recording is
+ *!	paused meanwhile, so the output path itself is not traced.
+ *!
+ *! \return 	records written.
+ */
+uint32_t os_trace_dump(void (*write)(const uint8_t *, uint16_t))
+{
+    os_trace_hdr_t hdr;
+    uint32_t       mask;
+    uint32_t       first;
+    uint32_t       part;
+
+    mask = os_trace_mask(0);
+    K_LOCK();
+    hdr.magic    = OS_TRACE_MAGIC;
+    hdr.version  = OS_TRACE_VERSION;
+    hdr.rec_size = sizeof(os_trace_rec_t);
+    hdr.cycle_hz = OS_CYCLE_HZ;
+    hdr.count    = k_trace_drained();
+    hdr.lost     = k_trace.lost;
+    k_trace.lost = 0;
+    write((const uint8_t *)&hdr, sizeof(hdr));
+    first = k_trace.tail & TRACE_MASK;
+    part  = OS_TRACE_SIZE - first;
+    if (part > hdr.count)
+    {
+        part = hdr.count;
+    }
+    k_trace_write(write, &k_trace.rec[first], part);
+    k_trace_write(write, &k_trace.rec[0], hdr.count - part);
+    k_trace.tail += hdr.count;
+    K_UNLOCK();
+    os_trace_mask(mask);
+    return (hdr.count);
+}
+
+/*
+ *********************************************************
+ *
+ *! k_trace_write( void (*)(const uint8_t *, uint16_t), const os_trace_rec_t *, uint32_t )
+ *!
+ *! \param 		write	raw output
+ *! \param 		rec		the first record
+ *! \param 		count	records to write
+ *!
+ *!	Write records that lie in one piece in the ring, TRACE_CHUNK at
+ *!	a time, as a ring of 5462 records or more is past 64k bytes.
+ *!
+ *! \return 	none.
+ */
+static void k_trace_write(void (*write)(const uint8_t *, uint16_t), const os_trace_rec_t *rec, uint32_t count)
+{
+    uint32_t n;
+
+    while (count)
+    {
+        n = (count > TRACE_CHUNK) ? TRACE_CHUNK : count;
+        write((const uint8_t *)rec, (uint16_t)(n * sizeof(os_trace_rec_t)));
+        rec   += n;
+        count -= n;
+    }
+}
+#endif
+
+/*
+ * End picotrace.c
+ * Close the Doxygen group.
+ *! @}
+ *
+ *********************************************************/
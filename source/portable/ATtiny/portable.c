@@ -20,6 +20,12 @@
  *   05-07-13   DS  	Add dsPIC, PIC24 support
  *   05-21-13   DS  	break out into platform specific directories
  *   08-12-15   DS  	support for the Arm Cortex-M
+ *   10-18-26   DS  	one-shot tick for tickless idle. os_seconds moved
+ *						to the kernel.
+ *   10-18-26   DS  	os_tick_fraction() from the tick timer, for
+ *						os_time_now().
+ *   10-18-26   DS  	the part tick is carried through a one-shot.
+ *   10-18-26   DS  	os_cycle_count() from the tick count and TCB1.
  *
  *  Copyright (c) 2009 - 2015 Dave Sandler
  *
@@ -118,7 +124,13 @@
  *
  *   Module Data
  */
-static uint16_t		one_sec_prescale;
+#if (PICO_TICKLESS)
+static timer_t			oneshot_ticks;
+static volatile uint8_t	oneshot_fired;
+#endif
+
+#define TCB1_RELOAD		(CPU_CLOCK_HZ / TICK_RATE_HZ)
+#define TCB1_PERIOD		(TCB1_RELOAD + 1UL)		/* counts per tick */
 
 /********************************************************************
  *  DESC
@@ -144,11 +156,46 @@ os_tick_init( void )
 	CCP = CCP_IOREG_gc;
 	CLKCTRL.MCLKCTRLB = ((1 << 1) | 1);
 	CLKCTRL.OSC32KCTRLA = 1;
-	TCB1.CCMP = (CPU_CLOCK_HZ / TICK_RATE_HZ);
+	TCB1.CCMP = TCB1_RELOAD;
 	TCB1.INTCTRL = 1;
 	TCB1.CTRLA = 1;
 }
 
+#if (OS_CYCLE_COUNT)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_cycle_count
+ *
+ *  DESCRIPTION:	free running count of CPU cycles, for run time
+ *					accounting and OS_RR_CYCLES. There's no cycle
+ *					counter, so the count is made from the tick count
+ *					and the TCB1 counts into the current tick. It is
+ *					read again if a tick lands in between. With
+ *					interrupts masked past a tick, or across a
+ *					tickless one-shot, the count is only approximate.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			the count
+ *
+ *******************************************************************/
+
+uint32_t
+os_cycle_count( void )
+{
+	timer_t  tick;
+	uint16_t cnt;
+
+	do
+	{
+		tick = current_tick;
+		cnt  = TCB1.CNT;
+	} while (tick != current_tick);
+	return ((uint32_t)tick * TCB1_PERIOD + cnt);
+}
+#endif
+
 /********************************************************************
  *  DESC
  *
@@ -222,14 +269,151 @@ os_tick_stop( void )
 void
 os_sleep( void )
 {
+#if !(PICO_TICKLESS)
 	os_tick_stop();
+#endif
+	/*
+	 * the kernel comes in with interrupts off. sei takes effect
+	 *	after the sleep, so one already pending still wakes us
+	 */
 	cli();
 	sleep_enable();
 	sei();
 	sleep_cpu();
 	sleep_disable();
+#if !(PICO_TICKLESS)
+	os_tick_start();
+#endif
+}
+
+#if (OS_TICK_FRACTION)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_fraction
+ *
+ *  DESCRIPTION:	TCB1 counts since the last tick the kernel
+ *					counted, for os_time_now(). If the period has run
+ *					out but the interrupt is still pending, the timer
+ *					is read again after the reset and the pending tick
+ *					added. Through a one-shot it's the counts since
+ *					it was set. There's no default for the target;
+ *					k_cfg.h sets OS_TICK_FRACTION, and OS_TICK_COUNTS
+ *					to CPU_CLOCK_HZ / TICK_RATE_HZ.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			the counts
+ *
+ *******************************************************************/
+
+os_time_t
+os_tick_fraction( void )
+{
+	uint16_t  cnt  = TCB1.CNT;
+	os_time_t part = 0;
+
+	if (TCB1.INTFLAGS & TCB_CAPT_bm)
+	{
+		cnt  = TCB1.CNT;
+		part = (os_time_t)TCB1.CCMP + 1UL;
+	}
+	return (part + cnt);
+}
+#endif
+
+#if (PICO_TICKLESS)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_oneshot
+ *
+ *  DESCRIPTION:	reload the tick timer to interrupt once after the
+ *					given number of ticks, bounded by the 16 bit compare
+ *					register. The ticks are counted from the last tick,
+ *					so the counts already gone in this one are taken
+ *					off. The interrupt still counts as one tick. With
+ *					a tick still to be taken nothing is set, as the
+ *					one-shot would take it for its own.
+ *
+ *  INPUT:		ticks to sleep
+ *
+ *  OUTPUT:		ticks programmed
+ *
+ *******************************************************************/
+
+timer_t
+os_tick_oneshot( timer_t ticks )
+{
+	uint16_t part;
+
+	if (ticks > (0xFFFFUL / TCB1_PERIOD))
+	{
+		ticks = 0xFFFFUL / TCB1_PERIOD;
+	}
+	if (TCB1.INTFLAGS & TCB_CAPT_bm)
+	{
+		/*
+		 * a tick is waiting to be taken, and ends the sleep
+		 *	at once; the timer is left as it is
+		 */
+		return (0);
+	}
+	os_tick_stop();
+	part = TCB1.CNT;
+	TCB1.CNT = 0;
+	TCB1.CCMP = (uint16_t)((ticks * TCB1_PERIOD) - 1UL - part);
+	oneshot_ticks = ticks;
+	oneshot_fired = 0;
+	os_tick_start();
+	return (ticks);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_periodic
+ *
+ *  DESCRIPTION:	return the tick timer to the periodic tick after a
+ *					one-shot. If the one-shot ran out, or is about to
+ *					be taken, its interrupt counts a tick; the counts
+ *					from the last tick are then the one-shot and the
+ *					timer since. Whole ticks are returned, and the part
+ *					tick left is carried in the timer, so an early
+ *					wake doesn't lose it.
+ *
+ *  INPUT:		none
+ *
+ *  OUTPUT:		ticks elapsed that the kernel has yet to count
+ *
+ *******************************************************************/
+
+timer_t
+os_tick_periodic( void )
+{
+	uint32_t counts;
+	timer_t  fired;
+	timer_t  elapsed;
+
+	if (0 == oneshot_ticks)
+	{
+		return (0);
+	}
+	os_tick_stop();
+	fired  = (oneshot_fired || (TCB1.INTFLAGS & TCB_CAPT_bm)) ? 1 : 0;
+	counts = (uint32_t)oneshot_ticks * TCB1_PERIOD + TCB1.CNT;
+	if (!fired)
+	{
+		counts -= (uint32_t)TCB1.CCMP + 1UL;
+	}
+	elapsed = (timer_t)(counts / TCB1_PERIOD) - fired;
+	oneshot_ticks = 0;
+	TCB1.CNT = (uint16_t)(counts % TCB1_PERIOD);
+	TCB1.CCMP = TCB1_RELOAD;
 	os_tick_start();
+	return (elapsed);
 }
+#endif
 
 /********************************************************************
  *  DESC
@@ -264,7 +448,7 @@ os_delay_us( uint32_t us )
 void
 os_delay_ms( uint16_t ms )
 {
-	os_tick_delay(ms);
+	os_tick_delay((uint16_t)os_ms_to_ticks(ms));
 }
 
 /********************************************************************
@@ -306,12 +490,13 @@ ISR(TCB1_INT_vect)
      *	and handle the event
      */
 	TCB1.INTFLAGS |= TCB_CAPT_bm;
+#if (PICO_TICKLESS)
+	if (0 != oneshot_ticks)
+	{
+		oneshot_fired = 1;
+	}
+#endif
     os_timerHook();
-    if (0 == --one_sec_prescale)
-    {
-        one_sec_prescale = SYSTICKHZ;
-        os_seconds++;
-    }
 }
 /*
  *  END OF portable.c
@@ -20,6 +20,11 @@
  *   05-07-13   DS  	Add dsPIC, PIC24 support
  *   05-21-13   DS  	break out into platform specific directories
  *   08-12-15   DS  	support for the Arm Cortex-M
+ *   10-18-26   DS  	one-shot SysTick for tickless idle. os_seconds moved
+ *						to the kernel.
+ *   10-18-26   DS  	os_cycle_count() from the tick count and SysTick.
+ *   10-18-26   DS  	os_tick_fraction() from SysTick, for os_time_now().
+ *   10-18-26   DS  	the part tick is carried through a one-shot.
  *
  *  Copyright (c) 2009 - 2015 Dave Sandler
  *
@@ -118,15 +123,23 @@ void SysTick_Handler(void);
  *
  *   Module Data
  */
-static uint16_t		one_sec_prescale;
+#if (PICO_TICKLESS || OS_CYCLE_COUNT)
+static uint32_t		systick_reload;
+#endif
+#if (PICO_TICKLESS)
+static timer_t		oneshot_ticks;
+#endif
 
 #define SYSTICK_RELOAD		(CPU_CLOCK_HZ/SYSTICKHZ)
 #define NVIC_SYSTICK_CTRL   ((volatile unsigned long *) 0xe000e010)
 #define NVIC_SYSTICK_LOAD   ((volatile unsigned long *) 0xe000e014)
 #define NVIC_SYSTICK_VAL	((volatile unsigned long *) 0xe000e018)
+#define NVIC_INT_CTRL		((volatile unsigned long *) 0xe000ed04)
+#define NVIC_PENDSTSET		0x04000000
 #define NVIC_SYSTICK_CLK    0x00000004
 #define NVIC_SYSTICK_INT    0x00000002
 #define NVIC_SYSTICK_ENABLE 0x00000001
+#define NVIC_SYSTICK_COUNT  0x00010000
 #define cpu_us_2_cy(us)		(uint32_t)(us * (CPU_CLOCK_HZ/1000000))
 
 /********************************************************************
@@ -150,10 +163,48 @@ os_tick_init( void )
      *	interrupt at the requested rate.
      *			and start it.
      */
+#if (PICO_TICKLESS || OS_CYCLE_COUNT)
+	systick_reload 		 =  system_cpu_clock_get_hz() / SYSTICKHZ;
+#endif
 	*(NVIC_SYSTICK_LOAD) = (system_cpu_clock_get_hz() / SYSTICKHZ) - 1UL;
 	*(NVIC_SYSTICK_CTRL) = NVIC_SYSTICK_CLK | NVIC_SYSTICK_INT | NVIC_SYSTICK_ENABLE;
 }
 
+#if (OS_CYCLE_COUNT)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_cycle_count
+ *
+ *  DESCRIPTION:	free running count of CPU cycles, for run time
+ *					accounting. The M0 has no cycle counter, so the
+ *					count is made from the tick count and the cycles
+ *					SysTick has counted down into the current tick.
+ *					It is read again if a tick lands in between. With
+ *					interrupts masked past a tick, or across a
+ *					tickless one-shot, the count is only approximate.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			the count
+ *
+ *******************************************************************/
+
+uint32_t
+os_cycle_count( void )
+{
+	timer_t  tick;
+	uint32_t val;
+
+	do
+	{
+		tick = current_tick;
+		val  = *(NVIC_SYSTICK_VAL);
+	} while (tick != current_tick);
+	return ((uint32_t)tick * systick_reload + (systick_reload - 1UL - val));
+}
+#endif
+
 /********************************************************************
  *  DESC
  *
@@ -227,10 +278,155 @@ os_tick_stop( void )
 void
 os_sleep( void )
 {
+#if (PICO_TICKLESS)
+	/*
+	 * the kernel has PRIMASK set; WFI wakes for a pending interrupt
+	 *	anyway, and it runs when PRIMASK is cleared
+	 */
+	system_sleep();
+#else
 	os_tick_stop();
 	system_sleep();
 	os_tick_start();
+#endif
+}
+
+#if (OS_TICK_FRACTION)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_fraction
+ *
+ *  DESCRIPTION:	SysTick counts since the last tick the kernel
+ *					counted, for os_time_now(). If the count has run
+ *					out but the interrupt is still pending, VAL is
+ *					read again after the reload and the pending tick
+ *					added. Through a tickless one-shot it's the
+ *					counts since the one-shot was set.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			the counts
+ *
+ *******************************************************************/
+
+os_time_t
+os_tick_fraction( void )
+{
+	uint32_t  load = *(NVIC_SYSTICK_LOAD);
+	uint32_t  val  = *(NVIC_SYSTICK_VAL);
+	os_time_t part = 0;
+
+	if (*(NVIC_INT_CTRL) & NVIC_PENDSTSET)
+	{
+		val  = *(NVIC_SYSTICK_VAL);
+		part = (os_time_t)load + 1UL;
+	}
+	return (part + (load - val));
+}
+#endif
+
+#if (PICO_TICKLESS)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_oneshot
+ *
+ *  DESCRIPTION:	reload SysTick to interrupt once after the given
+ *					number of ticks, bounded by the 24 bit counter.
+ *					The ticks are counted from the last tick, so the
+ *					counts already gone in this one are taken off.
+ *					The interrupt still counts as one tick.
+ *
+ *  INPUT:			ticks to sleep
+ *
+ *  OUTPUT:			ticks programmed
+ *
+ *******************************************************************/
+
+timer_t
+os_tick_oneshot( timer_t ticks )
+{
+	uint32_t part;
+
+	if (ticks > (0x00FFFFFFUL / systick_reload))
+	{
+		ticks = 0x00FFFFFFUL / systick_reload;
+	}
+	os_tick_stop();
+	part = *(NVIC_SYSTICK_LOAD) - *(NVIC_SYSTICK_VAL);
+	*(NVIC_SYSTICK_LOAD) = (ticks * systick_reload) - 1UL - part;
+	*(NVIC_SYSTICK_VAL)  = 0;
+	os_tick_start();
+	oneshot_ticks = ticks;
+	return (ticks);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_periodic
+ *
+ *  DESCRIPTION:	return SysTick to the periodic tick after a one-shot.
+ *					COUNTFLAG tells us the one-shot ran out, and its
+ *					interrupt counted a tick; the counts from the last
+ *					tick are then the one-shot and what the reload has
+ *					counted since. Whole ticks are returned, and the
+ *					part tick left is carried into the first reload,
+ *					so an early wake doesn't lose it. The reload for
+ *					the tick after that is set once SysTick is going.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			ticks elapsed that the kernel has yet to count
+ *
+ *******************************************************************/
+
+timer_t
+os_tick_periodic( void )
+{
+	uint32_t ctrl;
+	uint32_t load;
+	uint32_t val;
+	uint32_t counts;
+	timer_t  fired;
+	timer_t  elapsed;
+
+	/*
+	 * reading CTRL clears COUNTFLAG, so it's kept from the read
+	 *	that stops SysTick, and read again for a run out since
+	 */
+	ctrl = *(NVIC_SYSTICK_CTRL);
+	*(NVIC_SYSTICK_CTRL) = ctrl & ~(NVIC_SYSTICK_ENABLE | NVIC_SYSTICK_COUNT);
+	load  = *(NVIC_SYSTICK_LOAD);
+	val   = *(NVIC_SYSTICK_VAL);
+	ctrl |= *(NVIC_SYSTICK_CTRL);
+	fired = (ctrl & NVIC_SYSTICK_COUNT) ? 1 : 0;
+	if (fired)
+	{
+		counts = (oneshot_ticks * systick_reload) + (load - val);
+	}
+	else
+	{
+		counts = (oneshot_ticks * systick_reload) - 1UL - val;
+	}
+	elapsed = (timer_t)(counts / systick_reload) - fired;
+	counts %= systick_reload;
+	if ((systick_reload - 1UL) == counts)
+	{
+		/*
+		 * a reload of 0 would stop SysTick; count the tick now
+		 */
+		elapsed++;
+		counts = 0;
+	}
+	*(NVIC_SYSTICK_LOAD) = systick_reload - 1UL - counts;
+	*(NVIC_SYSTICK_VAL)  = 0;
+	os_tick_start();
+	*(NVIC_SYSTICK_LOAD) = systick_reload - 1UL;
+	return (elapsed);
 }
+#endif
 
 /********************************************************************
  *  DESC
@@ -272,7 +468,7 @@ os_delay_us( uint32_t us )
 void
 os_delay_ms( uint16_t ms )
 {
-	os_tick_delay(ms);
+	os_tick_delay((uint16_t)os_ms_to_ticks(ms));
 }
 
 /********************************************************************
@@ -298,11 +494,6 @@ SysTick_Handler(void)
      *	and handle the event
      */
     os_timerHook();
-    if (0 == --one_sec_prescale)
-    {
-        one_sec_prescale = SYSTICKHZ;
-        os_seconds++;
-    }
 	system_interrupt_leave_critical_section();
 }
 /*
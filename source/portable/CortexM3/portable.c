@@ -20,6 +20,12 @@
  *   05-07-13   DS  	Add dsPIC, PIC24 support
  *   05-21-13   DS  	break out into platform specific directories
  *   08-12-15   DS  	support for the Arm Cortex-M
+ *   10-18-26   DS  	one-shot SysTick for tickless idle. os_seconds moved
+ *						to the kernel.
+ *   10-18-26   DS  	os_cycle_count() from the DWT cycle counter.
+ *   10-18-26   DS  	os_tick_fraction() from SysTick, for os_time_now().
+ *   10-18-26   DS  	the part tick is carried through a one-shot. WFI
+ *						os_sleep() for tickless idle.
  *
  *  Copyright (c) 2009 - 2015 Dave Sandler
  *
@@ -119,15 +125,28 @@ void SysTick_Handler(void);
  *
  *   Module Data
  */
-static uint16_t		one_sec_prescale;
+#if (PICO_TICKLESS)
+static timer_t		oneshot_ticks;
+#endif
 
 #define SYSTICK_RELOAD		(CPU_CLOCK_HZ/SYSTICKHZ)
+#define SYSTICK_MAX_TICKS	(0x00FFFFFFUL / SYSTICK_RELOAD)
 #define NVIC_SYSTICK_CTRL   ((volatile unsigned long *) 0xe000e010)
 #define NVIC_SYSTICK_LOAD   ((volatile unsigned long *) 0xe000e014)
-#define NVIC_SYSTICK_VAL	((volatile unsigned long *) 0xe000e014)
+#define NVIC_SYSTICK_VAL	((volatile unsigned long *) 0xe000e018)
+#define NVIC_INT_CTRL		((volatile unsigned long *) 0xe000ed04)
+#define NVIC_SYSCTRL		((volatile unsigned long *) 0xe000ed10)
+#define NVIC_SLEEPDEEP		0x00000004
+#define NVIC_PENDSTSET		0x04000000
 #define NVIC_SYSTICK_CLK    0x00000004
 #define NVIC_SYSTICK_INT    0x00000002
 #define NVIC_SYSTICK_ENABLE 0x00000001
+#define NVIC_SYSTICK_COUNT  0x00010000
+#define DWT_CTRL			((volatile unsigned long *) 0xe0001000)
+#define DWT_CYCCNT			((volatile unsigned long *) 0xe0001004)
+#define DEMCR				((volatile unsigned long *) 0xe000edfc)
+#define DEMCR_TRCENA		0x01000000
+#define DWT_CYCCNTENA		0x00000001
 
 /********************************************************************
  *  DESC
@@ -152,7 +171,203 @@ os_tick_init( void )
      */
 	*(NVIC_SYSTICK_LOAD) = (CPU_CLOCK_HZ / SYSTICKHZ) - 1UL;
 	*(NVIC_SYSTICK_CTRL) = NVIC_SYSTICK_CLK | NVIC_SYSTICK_INT | NVIC_SYSTICK_ENABLE;
+#if (OS_CYCLE_COUNT)
+	/*
+	 * and the DWT cycle counter, for os_cycle_count()
+	 */
+	*(DEMCR)      |= DEMCR_TRCENA;
+	*(DWT_CYCCNT)  = 0;
+	*(DWT_CTRL)   |= DWT_CYCCNTENA;
+#endif
+}
+
+#if (OS_CYCLE_COUNT)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_cycle_count
+ *
+ *  DESCRIPTION:	free running count of CPU cycles, for run time
+ *					accounting
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			DWT CYCCNT
+ *
+ *******************************************************************/
+
+uint32_t
+os_cycle_count( void )
+{
+	return (*(DWT_CYCCNT));
+}
+#endif
+
+#if (OS_TICK_FRACTION)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_fraction
+ *
+ *  DESCRIPTION:	SysTick counts since the last tick the kernel
+ *					counted, for os_time_now(). If the count has run
+ *					out but the interrupt is still pending, VAL is
+ *					read again after the reload and the pending tick
+ *					added. Through a tickless one-shot it's the
+ *					counts since the one-shot was set.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			the counts
+ *
+ *******************************************************************/
+
+os_time_t
+os_tick_fraction( void )
+{
+	uint32_t  load = *(NVIC_SYSTICK_LOAD);
+	uint32_t  val  = *(NVIC_SYSTICK_VAL);
+	os_time_t part = 0;
+
+	if (*(NVIC_INT_CTRL) & NVIC_PENDSTSET)
+	{
+		val  = *(NVIC_SYSTICK_VAL);
+		part = (os_time_t)load + 1UL;
+	}
+	return (part + (load - val));
+}
+#endif
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_sleep_init, os_sleep
+ *
+ *  DESCRIPTION:	sleep, not deep sleep, so SysTick keeps running.
+ *					With PICO_TICKLESS the kernel comes in with
+ *					PRIMASK set; WFI wakes for a pending interrupt
+ *					anyway, and it runs when PRIMASK is cleared.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+void
+os_sleep_init( void )
+{
+	*(NVIC_SYSCTRL) &= ~NVIC_SLEEPDEEP;
+}
+
+void
+os_sleep( void )
+{
+#if !(PICO_TICKLESS)
+	*(NVIC_SYSTICK_CTRL) = NVIC_SYSTICK_CLK | NVIC_SYSTICK_INT;
+#endif
+	__asm volatile (" dsb \n"
+					" wfi \n"
+					" isb \n" ::: "memory");
+#if !(PICO_TICKLESS)
+	*(NVIC_SYSTICK_CTRL) = NVIC_SYSTICK_CLK | NVIC_SYSTICK_INT | NVIC_SYSTICK_ENABLE;
+#endif
+}
+
+#if (PICO_TICKLESS)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_oneshot
+ *
+ *  DESCRIPTION:	reload SysTick to interrupt once after the given
+ *					number of ticks, bounded by the 24 bit counter.
+ *					The ticks are counted from the last tick, so the
+ *					counts already gone in this one are taken off.
+ *					The interrupt still counts as one tick.
+ *
+ *  INPUT:			ticks to sleep
+ *
+ *  OUTPUT:			ticks programmed
+ *
+ *******************************************************************/
+
+timer_t
+os_tick_oneshot( timer_t ticks )
+{
+	uint32_t part;
+
+	if (ticks > SYSTICK_MAX_TICKS)
+	{
+		ticks = SYSTICK_MAX_TICKS;
+	}
+	*(NVIC_SYSTICK_CTRL) = NVIC_SYSTICK_CLK | NVIC_SYSTICK_INT;
+	part = *(NVIC_SYSTICK_LOAD) - *(NVIC_SYSTICK_VAL);
+	*(NVIC_SYSTICK_LOAD) = (ticks * SYSTICK_RELOAD) - 1UL - part;
+	*(NVIC_SYSTICK_VAL)  = 0;
+	*(NVIC_SYSTICK_CTRL) = NVIC_SYSTICK_CLK | NVIC_SYSTICK_INT | NVIC_SYSTICK_ENABLE;
+	oneshot_ticks = ticks;
+	return (ticks);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_periodic
+ *
+ *  DESCRIPTION:	return SysTick to the periodic tick after a one-shot.
+ *					COUNTFLAG tells us the one-shot ran out, and its
+ *					interrupt counted a tick; the counts from the last
+ *					tick are then the one-shot and what the reload has
+ *					counted since. Whole ticks are returned, and the
+ *					part tick left is carried into the first reload,
+ *					so an early wake doesn't lose it. The reload for
+ *					the tick after that is set once SysTick is going.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			ticks elapsed that the kernel has yet to count
+ *
+ *******************************************************************/
+
+timer_t
+os_tick_periodic( void )
+{
+	uint32_t load;
+	uint32_t val;
+	uint32_t counts;
+	timer_t  fired;
+	timer_t  elapsed;
+
+	*(NVIC_SYSTICK_CTRL) = NVIC_SYSTICK_CLK | NVIC_SYSTICK_INT;
+	load  = *(NVIC_SYSTICK_LOAD);
+	val   = *(NVIC_SYSTICK_VAL);
+	fired = (*(NVIC_SYSTICK_CTRL) & NVIC_SYSTICK_COUNT) ? 1 : 0;
+	if (fired)
+	{
+		counts = (oneshot_ticks * SYSTICK_RELOAD) + (load - val);
+	}
+	else
+	{
+		counts = (oneshot_ticks * SYSTICK_RELOAD) - 1UL - val;
+	}
+	elapsed = (timer_t)(counts / SYSTICK_RELOAD) - fired;
+	counts %= SYSTICK_RELOAD;
+	if ((SYSTICK_RELOAD - 1UL) == counts)
+	{
+		/*
+		 * a reload of 0 would stop SysTick; count the tick now
+		 */
+		elapsed++;
+		counts = 0;
+	}
+	*(NVIC_SYSTICK_LOAD) = SYSTICK_RELOAD - 1UL - counts;
+	*(NVIC_SYSTICK_VAL)  = 0;
+	*(NVIC_SYSTICK_CTRL) = NVIC_SYSTICK_CLK | NVIC_SYSTICK_INT | NVIC_SYSTICK_ENABLE;
+	*(NVIC_SYSTICK_LOAD) = SYSTICK_RELOAD - 1UL;
+	return (elapsed);
 }
+#endif
 
 /********************************************************************
  *  DESC
@@ -213,11 +428,6 @@ SysTick_Handler(void)
      *	and handle the event
      */
     os_timerHook();
-    if (0 == --one_sec_prescale)
-    {
-        one_sec_prescale = SYSTICKHZ;
-        os_seconds++;
-    }
 }
 /*
  *  END OF portable.c
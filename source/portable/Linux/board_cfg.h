@@ -0,0 +1,29 @@
+/********************************************************************
+ * 	DESC			board_cfg.h
+ *
+ *  MODULE NAME:
+ *
+ *  AUTHOR:
+ *
+ *  DESCRIPTION:    Board configuration for a Linux host. There's no
+ *                  	board; the host needs nothing more.
+ *
+ *
+ *  EDIT HISTORY:
+ *  DATE    VERSION  INIT   DESCRIPTION OF CHANGE
+ *  ------  -------  ----   ----------------------
+ *	10-18-2026		DS		Creation
+ *
+ *  Copyright (c) 2009 - 2026 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *******************************************************************/
+
+#ifndef	_BOARD_CFG_H
+	#define	_BOARD_CFG_H
+#endif /* safety check for duplicate .h file */
+/*
+ *  END OF board_cfg.h
+ *
+ *******************************************************************/
@@ -0,0 +1,63 @@
+#!/bin/sh
+#********************************************************************
+#
+#  DESC
+#
+#  MODULE NAME:        build.sh
+#
+#  AUTHOR:             Dave Sandler
+#
+#  DESCRIPTION:        Build pico as a native Linux process: the kernel,
+#                      the Linux port and its uartstdio console, and the
+#                      application sources given, or main.c here if
+#                      none are. Frame pointers are kept for perf.
+#
+#                      source/portable/Linux/build.sh [-o out] [app.c ...]
+#
+#                      Kernel options go in CFLAGS, for example
+#                      CFLAGS="-O2 -DPICO_TICKLESS=1 -DPICO_STATS=1"
+#
+#  EDIT HISTORY:
+#  BASELINE
+#  VERSION     INIT    DESCRIPTION OF CHANGE
+#  --------    ----    ----------------------
+#   10-18-26   DS      Module creation.
+#   10-18-26   DS      picopool.c
+#   10-18-26   DS      picoheap.c
+#
+#  Copyright (c) 2009 - 2026 Dave Sandler
+#
+#  This file is part of pico, and is distributed under the GNU Lesser
+#  General Public License; see COPYING.LESSER.txt.
+#
+#*******************************************************************
+
+set -e
+
+PORT=$(cd "$(dirname "$0")" && pwd)
+ROOT=$(cd "$PORT/../../.." && pwd)
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:--O2}
+OUT=pico
+
+if [ "$1" = "-o" ]; then
+	OUT=$2
+	shift 2
+fi
+if [ $# -eq 0 ]; then
+	set -- "$PORT/main.c"
+fi
+
+$CC -std=gnu99 -Wall -g -fno-omit-frame-pointer $CFLAGS -DLINUX \
+	-I"$ROOT/include" -I"$PORT" -o "$OUT" "$@" \
+	"$ROOT/source/pico.c" \
+	"$ROOT/source/picosem.c" \
+	"$ROOT/source/picomsg.c" \
+	"$ROOT/source/picoque.c" \
+	"$ROOT/source/picocque.c" \
+	"$ROOT/source/picopool.c" \
+	"$ROOT/source/picoheap.c" \
+	"$ROOT/source/picotrace.c" \
+	"$ROOT/source/portable/portable.c" \
+	"$PORT/uartstdio.c" \
+	-lpthread -lrt
@@ -0,0 +1,119 @@
+/********************************************************************
+ * 	DESC			k_cfg.h
+ *
+ *  MODULE NAME:
+ *
+ *  AUTHOR:
+ *
+ *  DESCRIPTION:    This header file contains prototypes and variables
+ *                  	that require a scope outside of the home .C module.
+ *
+ *
+ *  EDIT HISTORY:
+ *  DATE    VERSION  INIT   DESCRIPTION OF CHANGE
+ *  ------  -------  ----   ----------------------
+ *	10-18-2026		DS		Linux host configuration
+ *	10-18-2026		DS		OS_HOST_TICK, OS_TICK_SIGNAL
+ *	10-18-2026		DS		virtual time, OS_SIM_EVENTS
+ *
+ *  Copyright (c) 2009 - 2021 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License 
+ *  as published by the Free Software Foundation, either version 3 
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contiki-OS protothreads license:
+ *  Copyright (c) 2004-2005, Swedish Institute of Computer Science.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the Institute nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ *  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *  OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *  HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *******************************************************************/
+
+#ifndef	_K_CONFIG_H
+	#define	_K_CONFIG_H
+
+	/*
+	 * tcb related stuff. a host build may set any of these on
+	 *	the command line.
+	 */
+	#ifndef N_TASKS
+		#define N_TASKS         	64
+	#endif
+	#ifndef PICO_SMP
+		#define PICO_SMP			0
+	#endif
+	#ifndef OS_N_CORES
+		#define OS_N_CORES			1
+	#endif
+
+	/*
+	 * the host tick. 1 runs a POSIX timer at TICK_RATE_HZ that
+	 *	signals os_timerHook(), as the tick interrupt would. 0 has
+	 *	no tick; the application calls os_timerHook() itself, as
+	 *	the benchmarks in tools/ do. 2 runs in virtual time, see
+	 *	sim.c; it idles tickless, and holds OS_SIM_EVENTS
+	 *	simulated interrupts.
+	 */
+	#ifndef OS_HOST_TICK
+		#define OS_HOST_TICK		1
+	#endif
+	#if (2 == OS_HOST_TICK)
+		#ifndef PICO_TICKLESS
+			#define PICO_TICKLESS	1
+		#endif
+		#ifndef OS_SIM_EVENTS
+			#define OS_SIM_EVENTS	64
+		#endif
+	#endif
+	#ifndef OS_TICK_SIGNAL
+		#define OS_TICK_SIGNAL		SIGALRM
+	#endif
+
+	#define	CPU_CLOCK_HZ		((uint32_t)1000000000)
+	#define	TICK_RATE_HZ		((uint32_t) 1000)
+	#define BYTE_ALIGNMENT  	8
+	#define	T_STK_SZE_MIN		(128 * 8)
+
+	#define	T_ONE_SEC			((uint32_t)TICK_RATE_HZ)
+	#define	T_ONE_MS			((uint32_t)(1000 / TICK_RATE_HZ))
+
+	#include	"board_cfg.h"
+#endif /* safety check for duplicate .h file */
+/*
+ *  END OF k_cfg.h
+ *
+ *******************************************************************/
@@ -0,0 +1,233 @@
+/********************************************************************
+ *
+ *  DESC
+ *
+ *  MODULE NAME:        main.c
+ *
+ *  AUTHOR:        		Dave Sandler
+ *
+ *  DESCRIPTION:        A small application for the Linux host, built
+ *						by build.sh when no other is given. A task
+ *						reports once a second on the console, while a
+ *						pair of tasks pass a semaphore back and forth
+ *						every few ticks. It stops after the seconds
+ *						given, 5 by default, and prints the idle
+ *						residency; build with -DPICO_TICKLESS=1 for
+ *						the kernel to sleep when idle.
+ *
+ *						Built with -DOS_HOST_TICK=2 it runs in virtual
+ *						time, and a schedule of simulated interrupts
+ *						can be given too. Its "ping" interrupt signals
+ *						the semaphore.
+ *
+ *						pico [seconds [schedule]]
+ *
+ *  EDIT HISTORY:
+ *  BASELINE
+ *  VERSION     INIT    DESCRIPTION OF CHANGE
+ *  --------    ----    ----------------------
+ *   10-18-26   DS  	Module creation.
+ *   10-18-26   DS  	Virtual time schedule.
+ *
+ *  Copyright (c) 2009 - 2026 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License 
+ *  as published by the Free Software Foundation, either version 3 
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contiki-OS protothreads license:
+ *  Copyright (c) 2004-2005, Swedish Institute of Computer Science.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the Institute nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ *  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *  OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *  HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *******************************************************************/
+
+/*
+ ********************************************************************
+ *
+ *   System Includes
+ */
+#include	"pico.h"
+#include	"picosem.h"
+#include	"uartstdio.h"
+#include	<stdlib.h>
+
+/*
+ ********************************************************************
+ *
+ *   Module Data
+ */
+static os_sem_t		ping;
+static uint32_t		pongs;
+static uint32_t		run_for = 5;
+
+#if (2 == OS_HOST_TICK)
+static void			ping_isr(uint32_t);
+
+static const os_sim_isr_t isrs[] =
+{
+	{ "ping", ping_isr },
+	{ NULL,   NULL     }
+};
+#endif
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	report_task
+ *
+ *  DESCRIPTION:	once a second, print the tick and the passes of
+ *					the semaphore, and stop when the time is up
+ *
+ *******************************************************************/
+
+static int
+report_task( tcb_pt_t *pt )
+{
+	static uint32_t		 secs;
+	os_sleep_stats_t	 st;
+
+	PT_BEGIN(pt);
+	FOREVER
+	{
+		PT_DELAY(pt, T_ONE_SEC);
+		os_get_sleep_stats(&st);
+		UARTprintf("%4u s  tick %8u  pongs %6u  asleep %3u%%\n",
+				   (unsigned)++secs, (unsigned)get_os_ticks(), (unsigned)pongs,
+				   (unsigned)(100 * st.asleep / (st.asleep + st.awake + 1)));
+		if (secs >= run_for)
+		{
+			UARTprintf("asleep %llu ns, awake %llu ns, %u sleeps\n",
+					   (unsigned long long)st.asleep, (unsigned long long)st.awake,
+					   (unsigned)st.sleeps);
+			exit(0);
+		}
+	}
+	PT_END(pt);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	ping_task, pong_task
+ *
+ *  DESCRIPTION:	ping signals every 5 ticks; pong waits for it
+ *
+ *******************************************************************/
+
+static int
+ping_task( tcb_pt_t *pt )
+{
+	PT_BEGIN(pt);
+	FOREVER
+	{
+		PT_DELAY(pt, 5);
+		os_sem_signal(&ping);
+	}
+	PT_END(pt);
+}
+
+static int
+pong_task( tcb_pt_t *pt )
+{
+	PT_BEGIN(pt);
+	FOREVER
+	{
+		os_sem_wait(pt, ping, NO_TIMEOUT);
+		pongs++;
+	}
+	PT_END(pt);
+}
+
+#if (2 == OS_HOST_TICK)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	ping_isr
+ *
+ *  DESCRIPTION:	a simulated interrupt from the schedule
+ *
+ *******************************************************************/
+
+static void
+ping_isr( uint32_t arg )
+{
+	(void)arg;
+	os_sem_signal(&ping);
+}
+#endif
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	main
+ *
+ *  DESCRIPTION:	start the kernel
+ *
+ *  INPUT:			seconds to run, and a schedule
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+int
+main( int argc, char **argv )
+{
+	if (argc > 1)
+	{
+		run_for = (uint32_t)strtoul(argv[1], NULL, 0);
+	}
+	os_init();
+	UARTStdioInit(0);
+	os_sem_init(&ping);
+#if (2 == OS_HOST_TICK)
+	if ((argc > 2) && (os_sim_script(argv[2], isrs) < 0))
+	{
+		return (1);
+	}
+#endif
+	os_resume_task(os_create_task(OS_MED_PRIO - 1, TCB_NULL_ENV, report_task));
+	os_resume_task(os_create_task(OS_MED_PRIO, TCB_NULL_ENV, ping_task));
+	os_resume_task(os_create_task(OS_MED_PRIO, TCB_NULL_ENV, pong_task));
+	os_start_sched();
+	return (0);
+}
+
+/*
+ *  END OF main.c
+ *
+ *******************************************************************/
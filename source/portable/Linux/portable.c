@@ -0,0 +1,823 @@
+/********************************************************************
+ *
+ *  DESC
+ *
+ *  MODULE NAME:        portable.c
+ *
+ *  AUTHOR:        		Dave Sandler
+ *
+ *  DESCRIPTION:        This module contains the pico micro-kernel
+ *						portable functions for a Linux host.
+ *
+ *  EDIT HISTORY:
+ *  BASELINE
+ *  VERSION     INIT    DESCRIPTION OF CHANGE
+ *  --------    ----    ----------------------
+ *   10-18-26   DS  	Module creation. pthreads for the PICO_SMP cores.
+ *   10-18-26   DS  	os_cycle_count() from the monotonic clock.
+ *   10-18-26   DS  	Tick signal from a POSIX timer, DI()/EI(), tickless
+ *						one-shot, os_sleep() and its residency, delays.
+ *   10-18-26   DS  	Virtual time, OS_HOST_TICK 2, from sim.c.
+ *   10-18-26   DS  	os_tick_fraction() for os_time_now(). Timer overruns
+ *						are counted as ticks.
+ *   10-18-26   DS  	os_irq_save() and os_irq_restore(). os_sleep() is
+ *						entered with the tick held.
+ *
+ *  Copyright (c) 2009 - 2026 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License 
+ *  as published by the Free Software Foundation, either version 3 
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contiki-OS protothreads license:
+ *  Copyright (c) 2004-2005, Swedish Institute of Computer Science.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the Institute nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ *  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *  OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *  HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *******************************************************************/
+
+/*
+ ********************************************************************
+ *
+ *   System Includes
+ */
+#define 	 PORTABLE_C
+#include	"pico.h"
+#include	"portable.h"
+#include	<errno.h>
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<sys/timerfd.h>
+/*
+ ********************************************************************
+ *
+ *   Module Data
+ */
+#define	TICK_NS				(1000000000UL / TICK_RATE_HZ)
+
+#if (PICO_SMP)
+static pthread_mutex_t		kernel_lock;
+static pthread_spinlock_t	core_lock[OS_N_CORES];
+static pthread_t			core_thread[OS_N_CORES];
+static __thread uint8_t		core_id;
+static void				   *core_main(void *);
+#endif
+#if ((1 == OS_HOST_TICK) && PICO_SMP)
+static int					tick_fd = -1;
+static pthread_t			tick_thread;
+static void				   *tick_main(void *);
+#elif (1 == OS_HOST_TICK)
+static posix_timer_t		tick_timer;
+static uint8_t				tick_made;
+static sigset_t				tick_set;
+static volatile sig_atomic_t tick_seen;
+static __thread volatile sig_atomic_t tick_masked;
+static __thread volatile sig_atomic_t tick_pending;
+static void					tick_handler(int);
+static void					tick_arm(uint64_t, uint64_t, struct itimerspec *);
+#endif
+#if (1 == OS_HOST_TICK)
+static uint64_t				tick_at;
+#endif
+#if (PICO_TICKLESS)
+static timer_t				oneshot_ticks;
+static uint64_t				oneshot_end;
+#endif
+static os_sleep_stats_t		sleep_stats;
+static uint64_t				sleep_since;
+static uint64_t				port_ns(void);
+
+#if (2 == OS_HOST_TICK)
+	#if (!PICO_TICKLESS)
+		#error virtual time, OS_HOST_TICK 2, needs PICO_TICKLESS
+	#endif
+	#include	"sim.c"
+#endif
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_init
+ *
+ *  DESCRIPTION:	set up the kernel locks, and start the tick. The
+ *					tick is a POSIX timer signalling the process. With
+ *					PICO_SMP a signal can't take the kernel lock, so a
+ *					thread waits on a timerfd instead, and calls
+ *					os_timerHook() holding the lock. os_init() may be
+ *					called again; the timer is only made once.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+void
+os_tick_init( void )
+{
+#if (PICO_SMP)
+	pthread_mutexattr_t attr;
+	uint8_t				core;
+#if (1 == OS_HOST_TICK)
+	struct itimerspec	it;
+#endif
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&kernel_lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+	for (core = 0; core < OS_N_CORES; core++)
+	{
+		pthread_spin_init(&core_lock[core], PTHREAD_PROCESS_PRIVATE);
+	}
+#if (1 == OS_HOST_TICK)
+	if (tick_fd < 0)
+	{
+		tick_fd = timerfd_create(CLOCK_MONOTONIC, 0);
+		if (tick_fd < 0)
+		{
+			perror("pico: timerfd_create");
+			exit(1);
+		}
+		pthread_create(&tick_thread, NULL, tick_main, NULL);
+	}
+	it.it_value.tv_sec     = it.it_interval.tv_sec  = 0;
+	it.it_value.tv_nsec    = it.it_interval.tv_nsec = TICK_NS;
+	tick_at = port_ns();
+	timerfd_settime(tick_fd, 0, &it, NULL);
+#endif
+#elif (1 == OS_HOST_TICK)
+	struct sigaction	sa;
+	struct sigevent		ev;
+
+	if (0 == tick_made)
+	{
+		sigemptyset(&tick_set);
+		sigaddset(&tick_set, OS_TICK_SIGNAL);
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler = tick_handler;
+		sa.sa_flags   = SA_RESTART;
+		sigemptyset(&sa.sa_mask);
+		sigaction(OS_TICK_SIGNAL, &sa, NULL);
+
+		memset(&ev, 0, sizeof(ev));
+		ev.sigev_notify = SIGEV_SIGNAL;
+		ev.sigev_signo  = OS_TICK_SIGNAL;
+		if (0 != timer_create(CLOCK_MONOTONIC, &ev, &tick_timer))
+		{
+			perror("pico: timer_create");
+			exit(1);
+		}
+		tick_made = 1;
+	}
+	tick_masked  = 0;
+	tick_pending = 0;
+	tick_at		 = port_ns();
+	tick_arm(TICK_NS, TICK_NS, NULL);
+#elif (2 == OS_HOST_TICK)
+	sim_init();
+#endif
+}
+
+#if ((1 == OS_HOST_TICK) && PICO_SMP)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	tick_main
+ *
+ *  DESCRIPTION:	the tick thread. Ticks the thread was late for are
+ *					all counted.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+static void *
+tick_main( void *arg )
+{
+	uint64_t n;
+
+	(void)arg;
+	FOREVER
+	{
+		if (sizeof(n) == read(tick_fd, &n, sizeof(n)))
+		{
+			os_kernel_lock();
+			while (n--)
+			{
+				tick_at += TICK_NS;
+				os_timerHook();
+			}
+			os_kernel_unlock();
+		}
+	}
+	return (NULL);
+}
+#elif (1 == OS_HOST_TICK)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	tick_arm
+ *
+ *  DESCRIPTION:	set the tick timer
+ *
+ *  INPUT:			ns to the first expiry, ns between them after (0
+ *					for a one-shot), and where to put the time that
+ *					was left on the old setting, or NULL
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+static void
+tick_arm( uint64_t first, uint64_t period, struct itimerspec *left )
+{
+	struct itimerspec it;
+
+	it.it_value.tv_sec	   = first / 1000000000UL;
+	it.it_value.tv_nsec	   = first % 1000000000UL;
+	it.it_interval.tv_sec  = period / 1000000000UL;
+	it.it_interval.tv_nsec = period % 1000000000UL;
+	timer_settime(tick_timer, 0, &it, left);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	tick_handler
+ *
+ *  DESCRIPTION:	the tick interrupt. A tick that comes between DI()
+ *					and EI() is held until EI(). The signal isn't
+ *					queued, so ticks it was late for are counted from
+ *					the timer's overrun.
+ *
+ *  INPUT:			the signal
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+static void
+tick_handler( int sig )
+{
+	int n = timer_getoverrun(tick_timer);
+
+	(void)sig;
+	tick_seen = 1;
+	n = (n > 0) ? n + 1 : 1;
+	if (tick_masked)
+	{
+		tick_pending += n;
+		return;
+	}
+	while (n--)
+	{
+		tick_at += TICK_NS;
+		os_timerHook();
+	}
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_irq_disable, os_irq_enable
+ *
+ *  DESCRIPTION:	DI() and EI(). The mask is a flag the handler
+ *					checks, so a critical section costs no system
+ *					calls. Like the targets, they don't nest.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+void
+os_irq_disable( void )
+{
+	tick_masked = 1;
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+void
+os_irq_enable( void )
+{
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+	FOREVER
+	{
+		while (tick_pending)
+		{
+			tick_pending--;
+			tick_at += TICK_NS;
+			os_timerHook();
+		}
+		tick_masked = 0;
+		__atomic_signal_fence(__ATOMIC_SEQ_CST);
+		/*
+		 * a tick after the last check, and before the unmask, was
+		 *	held too
+		 */
+		if (0 == tick_pending)
+		{
+			break;
+		}
+		tick_masked = 1;
+	}
+}
+#endif
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_irq_save, os_irq_restore
+ *
+ *  DESCRIPTION:	the mask that nests. The tick is held off, and
+ *					let go again only if it wasn't held before. Where
+ *					no signal makes the tick there's nothing to hold.
+ *
+ *  INPUT:			os_irq_restore: what os_irq_save() returned
+ *
+ *  OUTPUT:			os_irq_save: the mask as it was
+ *
+ *******************************************************************/
+
+os_irq_t
+os_irq_save( void )
+{
+#if ((1 == OS_HOST_TICK) && !PICO_SMP)
+	os_irq_t s = (os_irq_t)tick_masked;
+
+	os_irq_disable();
+	return (s);
+#else
+	return (0);
+#endif
+}
+
+void
+os_irq_restore( os_irq_t s )
+{
+#if ((1 == OS_HOST_TICK) && !PICO_SMP)
+	if (0 == s)
+	{
+		os_irq_enable();
+	}
+#else
+	(void)s;
+#endif
+}
+
+void
+os_wdt_init( void )
+{
+}
+
+void
+os_wdt_reset( void )
+{
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_sleep_init, os_sleep, os_get_sleep_stats
+ *
+ *  DESCRIPTION:	os_sleep() blocks the process until the next tick,
+ *					or, after os_tick_oneshot(), until the one-shot
+ *					runs out. The signal stays blocked up to the wait,
+ *					so a one-shot that has already run out returns at
+ *					once. Without a tick, it gives up the host cpu.
+ *
+ *					The time spent asleep is counted, to measure the
+ *					idle residency of tickless idle.
+ *
+ *  INPUT:			os_get_sleep_stats: where to put the counts
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+void
+os_sleep_init( void )
+{
+	memset(&sleep_stats, 0, sizeof(sleep_stats));
+	sleep_since = port_ns();
+}
+
+void
+os_sleep( void )
+{
+	uint64_t start = port_ns();
+#if ((1 == OS_HOST_TICK) && !PICO_SMP)
+	sigset_t old;
+
+	pthread_sigmask(SIG_BLOCK, &tick_set, &old);
+#if (PICO_TICKLESS)
+	if (0 == oneshot_ticks)
+#endif
+	{
+		tick_seen = 0;
+	}
+	if (0 == tick_seen)
+	{
+		sigsuspend(&old);
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+#elif (2 == OS_HOST_TICK)
+	sim_sleep();
+#else
+	sched_yield();
+#endif
+	sleep_stats.asleep += port_ns() - start;
+	sleep_stats.sleeps++;
+}
+
+void
+os_get_sleep_stats( os_sleep_stats_t *st )
+{
+	*st       = sleep_stats;
+	st->awake = port_ns() - sleep_since - sleep_stats.asleep;
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	port_ns
+ *
+ *  DESCRIPTION:	the monotonic clock in nanoseconds, or virtual
+ *					time
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			the time
+ *
+ *******************************************************************/
+
+static uint64_t
+port_ns( void )
+{
+#if (2 == OS_HOST_TICK)
+	return (sim_now);
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec);
+#endif
+}
+
+#if (OS_CYCLE_COUNT)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_cycle_count
+ *
+ *  DESCRIPTION:	free running count for run time accounting. The
+ *					host counts nanoseconds, matching CPU_CLOCK_HZ in
+ *					k_cfg.h, and wraps every 4.3 seconds. In virtual
+ *					time they're virtual nanoseconds.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			the count
+ *
+ *******************************************************************/
+
+uint32_t
+os_cycle_count( void )
+{
+	return ((uint32_t)port_ns());
+}
+#endif
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_fraction
+ *
+ *  DESCRIPTION:	nanoseconds since the last tick the kernel counted,
+ *					for os_time_now(). Ticks are counted at their place
+ *					on the timer's period, not when the signal lands,
+ *					so a late signal doesn't move time back. Through a
+ *					one-shot its signal counts the tick after the one
+ *					it was set at, and the rest is counted here. With
+ *					no tick, time moves a tick at a time.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			the nanoseconds
+ *
+ *******************************************************************/
+
+os_time_t
+os_tick_fraction( void )
+{
+#if (1 == OS_HOST_TICK)
+	return (port_ns() - tick_at);
+#elif (2 == OS_HOST_TICK)
+	return (sim_fraction());
+#else
+	return (0);
+#endif
+}
+
+#if (PICO_TICKLESS)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_oneshot
+ *
+ *  DESCRIPTION:	set the tick timer to run out once after the given
+ *					number of ticks, on the period the tick keeps, so
+ *					no part tick is lost. The signal still counts as
+ *					one tick. Without a tick there's nothing to set.
+ *
+ *  INPUT:			ticks to sleep
+ *
+ *  OUTPUT:			ticks programmed
+ *
+ *******************************************************************/
+
+timer_t
+os_tick_oneshot( timer_t ticks )
+{
+#if (1 == OS_HOST_TICK)
+	uint64_t now;
+#endif
+
+	oneshot_ticks = ticks;
+#if (1 == OS_HOST_TICK)
+	tick_seen	= 0;
+	oneshot_end = tick_at + (uint64_t)ticks * TICK_NS;
+	now			= port_ns();
+	tick_arm((oneshot_end > now) ? oneshot_end - now : 1, 0, NULL);
+#elif (2 == OS_HOST_TICK)
+	sim_oneshot(ticks);
+#endif
+	return (ticks);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_periodic
+ *
+ *  DESCRIPTION:	return to the periodic tick after a one-shot. If
+ *					the one-shot ran out its signal counted one tick,
+ *					and the rest are added. Whole ticks since are
+ *					recovered from the clock, and the tick starts
+ *					again on its period. The signal is held meanwhile,
+ *					so a one-shot signal that is late can't count its
+ *					tick in the middle.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			ticks elapsed that the kernel has yet to count
+ *
+ *******************************************************************/
+
+timer_t
+os_tick_periodic( void )
+{
+	timer_t elapsed = 0;
+#if (1 == OS_HOST_TICK)
+	struct itimerspec left;
+	uint64_t		  base;
+	uint64_t		  late;
+	uint64_t		  now;
+
+	DI();
+	tick_arm(0, 0, &left);
+	if ((0 == left.it_value.tv_sec) && (0 == left.it_value.tv_nsec))
+	{
+		elapsed  = oneshot_ticks - 1;
+		tick_at += (uint64_t)elapsed * TICK_NS;
+		base	 = oneshot_end;
+	}
+	else
+	{
+		base	 = tick_at;
+	}
+	now		 = port_ns();
+	late	 = (now - base) / TICK_NS;
+	elapsed += (timer_t)late;
+	tick_at += late * TICK_NS;
+	base	+= late * TICK_NS;
+	tick_arm(base + TICK_NS - now, TICK_NS, NULL);
+	EI();
+#elif (2 == OS_HOST_TICK)
+	elapsed = sim_periodic();
+#endif
+	oneshot_ticks = 0;
+	return (elapsed);
+}
+#endif
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_delay_us, os_delay_ms
+ *
+ *  DESCRIPTION:	os_delay in units of 1uS or 1mS. The process
+ *					sleeps to an absolute time, so ticks that come in
+ *					the meantime don't stretch it. In virtual time the
+ *					delay is time spent, and a task models its run
+ *					time with it.
+ *
+ *  INPUT:			Delay interval
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+void
+os_delay_us( uint32_t us )
+{
+#if (2 == OS_HOST_TICK)
+	sim_advance(sim_now + (uint64_t)us * 1000UL);
+#else
+	struct timespec until;
+	uint64_t		ns = port_ns() + (uint64_t)us * 1000UL;
+
+	until.tv_sec  = ns / 1000000000ULL;
+	until.tv_nsec = ns % 1000000000ULL;
+	while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL))
+	{
+	}
+#endif
+}
+
+void
+os_delay_ms( uint16_t ms )
+{
+	os_delay_us((uint32_t)ms * 1000UL);
+}
+
+#if (PICO_SMP)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_start_cores
+ *
+ *  DESCRIPTION:	start a thread for each of cores 1 to os_n_cores - 1.
+ *					The caller goes on to run core 0.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+void
+os_start_cores( void )
+{
+	uintptr_t core;
+
+	core_id = 0;
+	for (core = 1; core < os_n_cores; core++)
+	{
+		pthread_create(&core_thread[core], NULL, core_main, (void *)core);
+	}
+}
+
+static void *
+core_main( void *arg )
+{
+	core_id = (uint8_t)(uintptr_t)arg;
+	os_start_sched_core(core_id);
+	return (NULL);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_core_id
+ *
+ *  DESCRIPTION:	the number of the core calling
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			0 to os_n_cores - 1
+ *
+ *******************************************************************/
+
+uint8_t
+os_core_id( void )
+{
+	return (core_id);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_kernel_lock, os_kernel_unlock
+ *
+ *  DESCRIPTION:	the kernel lock. It's recursive, since kernel
+ *					calls nest.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+void
+os_kernel_lock( void )
+{
+	pthread_mutex_lock(&kernel_lock);
+}
+
+void
+os_kernel_unlock( void )
+{
+	pthread_mutex_unlock(&kernel_lock);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_core_lock, os_core_unlock
+ *
+ *  DESCRIPTION:	a core's ready list lock. It's only held for a
+ *					few list operations, so it spins.
+ *
+ *  INPUT:			the core's number
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+void
+os_core_lock( uint8_t core )
+{
+	pthread_spin_lock(&core_lock[core]);
+}
+
+void
+os_core_unlock( uint8_t core )
+{
+	pthread_spin_unlock(&core_lock[core]);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_core_idle
+ *
+ *  DESCRIPTION:	a core found nothing to run, or to steal. Give its
+ *					host cpu to another thread for a while.
+ *
+ *  INPUT:			the core's number
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+void
+os_core_idle( uint8_t core )
+{
+	(void)core;
+	sched_yield();
+}
+#endif
+/*
+ *  END OF portable.c
+ *
+ *******************************************************************/
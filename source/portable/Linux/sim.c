@@ -0,0 +1,516 @@
+/********************************************************************
+ *
+ *  DESC
+ *
+ *  MODULE NAME:        sim.c
+ *
+ *  AUTHOR:        		Dave Sandler
+ *
+ *  DESCRIPTION:        Virtual time for the Linux host, OS_HOST_TICK 2.
+ *						Time only moves when the kernel idles, or a
+ *						task spends it in os_delay_us(). An idle kernel
+ *						jumps straight to its next deadline, through
+ *						tickless idle, so days of device time run in
+ *						seconds.
+ *
+ *						Simulated interrupts are events at virtual
+ *						times: set one with os_sim_event(), or load a
+ *						schedule with os_sim_script(). An event runs
+ *						where the kernel would take the interrupt, in
+ *						os_sleep() or os_delay_us(), with ticks and
+ *						events in time order.
+ *
+ *						Nothing reads the host clock, and
+ *						os_sim_random() is seeded by os_sim_seed(), so a
+ *						run repeats exactly. os_cycle_count() counts
+ *						virtual nanoseconds.
+ *
+ *						Included by portable.c.
+ *
+ *  EDIT HISTORY:
+ *  BASELINE
+ *  VERSION     INIT    DESCRIPTION OF CHANGE
+ *  --------    ----    ----------------------
+ *   10-18-26   DS  	Module creation.
+ *   10-18-26   DS  	sim_fraction(), so os_time_now() is virtual time.
+ *   10-18-26   DS  	sim_advance() jumps the silent ticks of a one-shot.
+ *
+ *  Copyright (c) 2009 - 2026 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License 
+ *  as published by the Free Software Foundation, either version 3 
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contiki-OS protothreads license:
+ *  Copyright (c) 2004-2005, Swedish Institute of Computer Science.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the Institute nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ *  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *  OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *  HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *******************************************************************/
+
+/*
+ ********************************************************************
+ *
+ *   Module Data
+ */
+typedef struct
+{
+	k_list_t		link;
+	uint64_t		at;
+	uint64_t		period;
+	os_sim_isr_fn	isr;
+	uint32_t		arg;
+} sim_event_t;
+
+static uint64_t			sim_now;
+static uint64_t			sim_ticks;
+static uint64_t			sim_end;
+static uint64_t			oneshot_from;
+static uint64_t			oneshot_end;
+static uint8_t			oneshot_fired;
+static uint32_t			sim_seed = 1;
+static k_list_t			sim_events;
+static k_list_t			sim_free;
+static sim_event_t		sim_pool[OS_SIM_EVENTS];
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	sim_init
+ *
+ *  DESCRIPTION:	start virtual time at 0, with no events. Called
+ *					from os_tick_init(), so os_init() starts a new run.
+ *					The seed and end time stay as set.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+static void
+sim_init( void )
+{
+	uint16_t i;
+
+	sim_now		  = 0;
+	sim_ticks	  = 0;
+	oneshot_fired = 0;
+	sim_events.next = sim_events.last = &sim_events;
+	sim_free.next   = sim_free.last   = &sim_free;
+	for (i = 0; i < OS_SIM_EVENTS; i++)
+	{
+		kq_qinsert(sim_free.last, &sim_pool[i].link);
+	}
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	sim_insert
+ *
+ *  DESCRIPTION:	put an event in time order, behind any due at the
+ *					same time
+ *
+ *  INPUT:			the event
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+static void
+sim_insert( sim_event_t *ev )
+{
+	k_list_t *node;
+
+	for (node = sim_events.last; &sim_events != node; node = node->last)
+	{
+		if (((sim_event_t *)node)->at <= ev->at)
+		{
+			break;
+		}
+	}
+	kq_qinsert(node, &ev->link);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	sim_advance
+ *
+ *  DESCRIPTION:	move virtual time on, running the ticks and events
+ *					due on the way in time order. An event due with a
+ *					tick runs first. During a one-shot only its last
+ *					tick is delivered; os_tick_periodic() accounts for
+ *					the rest, so the ticks before it, or before the
+ *					next event, are jumped in one step. Reaching the
+ *					end time set by
+ *					os_sim_until() ends the process.
+ *
+ *  INPUT:			the virtual time to move to
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+static void
+sim_advance( uint64_t to )
+{
+	sim_event_t	*ev;
+	uint64_t	 tick_at;
+	uint64_t	 last;
+	uint8_t		 ending = 0;
+
+	if (sim_end && (to >= sim_end))
+	{
+		to	   = sim_end;
+		ending = 1;
+	}
+	FOREVER
+	{
+		ev = (sim_event_t *)sim_events.next;
+		if (oneshot_ticks)
+		{
+			last = to / TICK_NS;
+			if ((oneshot_end > sim_ticks) && (oneshot_end - 1 < last))
+			{
+				last = oneshot_end - 1;
+			}
+			if (((k_list_t *)ev != &sim_events) && (ev->at > sim_now) && ((ev->at - 1) / TICK_NS < last))
+			{
+				last = (ev->at - 1) / TICK_NS;
+			}
+			if (last > sim_ticks)
+			{
+				sim_ticks = last;
+				sim_now	  = last * TICK_NS;
+			}
+		}
+		tick_at = (sim_ticks + 1) * TICK_NS;
+		if (((k_list_t *)ev != &sim_events) && (ev->at <= tick_at) && (ev->at <= to))
+		{
+			sim_now = ev->at;
+			kq_ndelete(&ev->link);
+			if (ev->period)
+			{
+				ev->at += ev->period;
+				sim_insert(ev);
+			}
+			else
+			{
+				kq_qinsert(sim_free.last, &ev->link);
+			}
+			ev->isr(ev->arg);
+			continue;
+		}
+		if (tick_at > to)
+		{
+			break;
+		}
+		sim_now = tick_at;
+		sim_ticks++;
+		if (0 == oneshot_ticks)
+		{
+			os_timerHook();
+		}
+		else if (sim_ticks == oneshot_end)
+		{
+			oneshot_fired = 1;
+			os_timerHook();
+		}
+	}
+	sim_now = to;
+	if (ending)
+	{
+		exit(0);
+	}
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	sim_sleep
+ *
+ *  DESCRIPTION:	os_sleep() in virtual time: jump to the next tick,
+ *					or the end of the one-shot, or the next event,
+ *					whichever is first. With nothing left that could
+ *					wake the kernel, the run is over.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+static void
+sim_sleep( void )
+{
+	uint64_t wake = (sim_ticks + 1) * TICK_NS;
+
+	if (oneshot_ticks)
+	{
+		wake = (NO_TIMEOUT == oneshot_ticks) ? ~0ULL : oneshot_end * TICK_NS;
+	}
+	if ((&sim_events != sim_events.next) && (((sim_event_t *)sim_events.next)->at < wake))
+	{
+		wake = ((sim_event_t *)sim_events.next)->at;
+	}
+	if ((~0ULL == wake) && (0 == sim_end))
+	{
+		fprintf(stderr, "pico: nothing left to happen at %llu ns\n", (unsigned long long)sim_now);
+		exit(0);
+	}
+	sim_advance(wake);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	sim_oneshot, sim_periodic
+ *
+ *  DESCRIPTION:	the tickless one-shot. It's kept on the tick grid,
+ *					so a run ticks the same with or without tickless
+ *					idle.
+ *
+ *  INPUT:			sim_oneshot: ticks to sleep
+ *
+ *  OUTPUT:			sim_periodic: ticks elapsed that the kernel has
+ *					yet to count
+ *
+ *******************************************************************/
+
+static void
+sim_oneshot( timer_t ticks )
+{
+	oneshot_from  = sim_ticks;
+	oneshot_end	  = sim_ticks + ticks;
+	oneshot_fired = 0;
+}
+
+static timer_t
+sim_periodic( void )
+{
+	return (oneshot_fired ? oneshot_ticks - 1 : (timer_t)(sim_ticks - oneshot_from));
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	sim_fraction
+ *
+ *  DESCRIPTION:	virtual nanoseconds since the last tick the kernel
+ *					counted. Through a one-shot the kernel has counted
+ *					the tick it was set at, and the one it ran out on.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			the nanoseconds
+ *
+ *******************************************************************/
+
+static os_time_t
+sim_fraction( void )
+{
+	uint64_t counted = sim_ticks;
+
+	if (oneshot_ticks)
+	{
+		counted = oneshot_from + oneshot_fired;
+	}
+	return (sim_now - counted * TICK_NS);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_sim_event
+ *
+ *  DESCRIPTION:	set a simulated interrupt. It runs at the virtual
+ *					time given, and again every period after, if
+ *					there's one. Events at the same time run in the
+ *					order they were set.
+ *
+ *  INPUT:			virtual time in ns, period in ns or 0, the
+ *					interrupt handler and its argument
+ *
+ *  OUTPUT:			0 if there's no room; OS_SIM_EVENTS sets it
+ *
+ *******************************************************************/
+
+uint8_t
+os_sim_event( uint64_t at, uint64_t period, os_sim_isr_fn isr, uint32_t arg )
+{
+	sim_event_t *ev = (sim_event_t *)kq_qdelete(&sim_free);
+
+	if ((sim_event_t *)Q_NULL == ev)
+	{
+		return (0);
+	}
+	ev->at	   = (at < sim_now) ? sim_now : at;
+	ev->period = period;
+	ev->isr	   = isr;
+	ev->arg	   = arg;
+	sim_insert(ev);
+	return (1);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_sim_script
+ *
+ *  DESCRIPTION:	load a schedule of simulated interrupts. Each line
+ *					is
+ *
+ *						<time us> <name> [<arg> [<period us>]]
+ *
+ *					and the name is looked up in the table given,
+ *					which ends with a NULL name. Blank lines and lines
+ *					starting with # are skipped.
+ *
+ *  INPUT:			file name, handler table
+ *
+ *  OUTPUT:			events set, or -1 on an error, which is printed
+ *
+ *******************************************************************/
+
+int
+os_sim_script( const char *path, const os_sim_isr_t *isrs )
+{
+	FILE				*f;
+	char				 line[160];
+	char				 name[64];
+	unsigned long long	 at;
+	unsigned long long	 period;
+	unsigned long		 arg;
+	const os_sim_isr_t	*isr;
+	int					 n;
+	int					 count  = 0;
+	int					 lineno = 0;
+
+	if (NULL == (f = fopen(path, "r")))
+	{
+		perror(path);
+		return (-1);
+	}
+	while (NULL != fgets(line, sizeof(line), f))
+	{
+		lineno++;
+		arg	   = 0;
+		period = 0;
+		n	   = sscanf(line, "%llu %63s %lu %llu", &at, name, &arg, &period);
+		if ((n <= 0) || ('#' == line[strspn(line, " \t")]))
+		{
+			continue;
+		}
+		for (isr = isrs; (NULL != isr->name) && (0 != strcmp(isr->name, name)); isr++)
+		{
+		}
+		if ((n < 2) || (NULL == isr->name) ||
+			(0 == os_sim_event(at * 1000ULL, period * 1000ULL, isr->isr, (uint32_t)arg)))
+		{
+			fprintf(stderr, "%s:%d: bad event, or no room\n", path, lineno);
+			fclose(f);
+			return (-1);
+		}
+		count++;
+	}
+	fclose(f);
+	return (count);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_sim_until, os_sim_now
+ *
+ *  DESCRIPTION:	set the virtual time the run ends at; 0 runs until
+ *					nothing is left to happen. The process exits
+ *					there, so report with atexit(). And read virtual
+ *					time.
+ *
+ *  INPUT:			os_sim_until: virtual time in ns
+ *
+ *  OUTPUT:			os_sim_now: virtual time in ns
+ *
+ *******************************************************************/
+
+void
+os_sim_until( uint64_t ns )
+{
+	sim_end = ns;
+}
+
+uint64_t
+os_sim_now( void )
+{
+	return (sim_now);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_sim_seed, os_sim_random
+ *
+ *  DESCRIPTION:	repeatable random numbers for a simulation,
+ *					xorshift32
+ *
+ *  INPUT:			os_sim_seed: the seed; 0 is taken as 1
+ *
+ *  OUTPUT:			os_sim_random: the next number
+ *
+ *******************************************************************/
+
+void
+os_sim_seed( uint32_t seed )
+{
+	sim_seed = seed ? seed : 1;
+}
+
+uint32_t
+os_sim_random( void )
+{
+	sim_seed ^= sim_seed << 13;
+	sim_seed ^= sim_seed >> 17;
+	sim_seed ^= sim_seed << 5;
+	return (sim_seed);
+}
+
+/*
+ *  END OF sim.c
+ *
+ *******************************************************************/
@@ -0,0 +1,225 @@
+/********************************************************************
+ *
+ *  DESC
+ *
+ *  MODULE NAME:        uartstdio.c
+ *
+ *  AUTHOR:        		Dave Sandler
+ *
+ *  DESCRIPTION:        The uartstdio console on a Linux host. The UART
+ *						is the process's standard input and output, so
+ *						an application's console runs unchanged. Writes
+ *						go straight out, with no buffering; the terminal
+ *						does the echo. The UART_BUFFERED calls have no
+ *						host version.
+ *
+ *  EDIT HISTORY:
+ *  BASELINE
+ *  VERSION     INIT    DESCRIPTION OF CHANGE
+ *  --------    ----    ----------------------
+ *   10-18-26   DS  	Module creation.
+ *
+ *  Copyright (c) 2009 - 2026 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License 
+ *  as published by the Free Software Foundation, either version 3 
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Contiki-OS protothreads license:
+ *  Copyright (c) 2004-2005, Swedish Institute of Computer Science.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the Institute nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ *  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *  OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *  HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *******************************************************************/
+
+/*
+ ********************************************************************
+ *
+ *   System Includes
+ */
+#include	"pico.h"
+#include	"uartstdio.h"
+#include	<stdarg.h>
+#include	<stdio.h>
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	UARTStdioInit
+ *
+ *  DESCRIPTION:	nothing to set up; the port number is ignored
+ *
+ *  INPUT:			port
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+void
+UARTStdioInit( unsigned long ulPort )
+{
+	(void)ulPort;
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	UARTwrite
+ *
+ *  DESCRIPTION:	write to standard output
+ *
+ *  INPUT:			buffer, length
+ *
+ *  OUTPUT:			characters written
+ *
+ *******************************************************************/
+
+int
+UARTwrite( const char *pcBuf, unsigned long ulLen )
+{
+	unsigned long done = 0;
+	ssize_t		  n;
+
+	while (done < ulLen)
+	{
+		n = write(STDOUT_FILENO, pcBuf + done, ulLen - done);
+		if (n <= 0)
+		{
+			break;
+		}
+		done += (unsigned long)n;
+	}
+	return ((int)done);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	UARTgetc
+ *
+ *  DESCRIPTION:	wait for a character from standard input. At the
+ *					end of the input it returns 0x04, end of
+ *					transmission.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			the character
+ *
+ *******************************************************************/
+
+unsigned char
+UARTgetc( void )
+{
+	unsigned char c;
+
+	if (1 != read(STDIN_FILENO, &c, 1))
+	{
+		c = 0x04;
+	}
+	return (c);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	UARTgets
+ *
+ *  DESCRIPTION:	read a line from standard input. The line end
+ *					isn't kept, and the string is always terminated.
+ *					Characters past the buffer are dropped.
+ *
+ *  INPUT:			buffer, its length
+ *
+ *  OUTPUT:			characters in the buffer
+ *
+ *******************************************************************/
+
+int
+UARTgets( char *pcBuf, unsigned long ulLen )
+{
+	unsigned long count = 0;
+	unsigned char c;
+
+	if (0 == ulLen)
+	{
+		return (0);
+	}
+	FOREVER
+	{
+		c = UARTgetc();
+		if (('\n' == c) || ('\r' == c) || (0x04 == c))
+		{
+			break;
+		}
+		if (count < ulLen - 1)
+		{
+			pcBuf[count++] = (char)c;
+		}
+	}
+	pcBuf[count] = 0;
+	return ((int)count);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	UARTprintf
+ *
+ *  DESCRIPTION:	formatted write to standard output. The host
+ *					takes any printf format, a superset of the ones
+ *					the target version knows.
+ *
+ *  INPUT:			format, arguments
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+void
+UARTprintf( const char *pcString, ... )
+{
+	va_list vaArgP;
+
+	va_start(vaArgP, pcString);
+	vdprintf(STDOUT_FILENO, pcString, vaArgP);
+	va_end(vaArgP);
+}
+
+/*
+ *  END OF uartstdio.c
+ *
+ *******************************************************************/
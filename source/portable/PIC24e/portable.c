@@ -19,6 +19,12 @@
  *   09-19-12   DS  	Modified for the dsPic
  *   05-07-13   DS  	Add dsPIC, PIC24 support
  *   05-21-13   DS  	break out into platform specific directories
+ *   10-18-26   DS  	one-shot tick for tickless idle. os_seconds moved
+ *						to the kernel.
+ *   10-18-26   DS  	os_tick_fraction() from the tick timer, for
+ *						os_time_now().
+ *   10-18-26   DS  	the part tick is carried through a one-shot.
+ *   10-18-26   DS  	os_cycle_count() from the tick count and timer 1.
  *
  *  Copyright (c) 2009 - 2021 Dave Sandler
  *
@@ -133,7 +139,10 @@ void 	os_tick_init( void );
  *   Module Data
  */
 
-static uint16_t     one_sec_prescale;
+#if (PICO_TICKLESS)
+static timer_t          oneshot_ticks;
+static volatile uint8_t oneshot_fired;
+#endif
 extern tcb_entry_t  *current_task;
 extern k_list_t     k_ready_list, k_wait_list;
 extern tcb_entry_t  tcb[N_TASKS];
@@ -142,6 +151,7 @@ extern timer_t      last_tick;
 #define SYS_FREQ    CPU_CLOCK_HZ
 #define T1_PRESCALE 8
 #define T1_RELOAD   (SYS_FREQ/T1_PRESCALE/TICK_RATE_HZ)
+#define T1_PERIOD   (T1_RELOAD + 1UL)		/* counts per tick */
 
 /********************************************************************
  *  DESC
@@ -215,6 +225,41 @@ void os_tick_init( void )
     os_tick_start();
 }
 
+#if (OS_CYCLE_COUNT)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_cycle_count
+ *
+ *  DESCRIPTION:	free running count of CPU cycles, for run time
+ *					accounting and OS_RR_CYCLES. There's no cycle
+ *					counter, so the count is made from the tick count
+ *					and the timer 1 counts into the current tick, at
+ *					T1_PRESCALE cycles a count. It is read again if a
+ *					tick lands in between. With
+ *					interrupts masked past a tick, or across a
+ *					tickless one-shot, the count is only approximate.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			the count
+ *
+ *******************************************************************/
+
+uint32_t os_cycle_count( void )
+{
+    timer_t  tick;
+    uint16_t cnt;
+
+    do
+    {
+        tick = current_tick;
+        cnt  = TMR1;
+    } while (tick != current_tick);
+    return (((uint32_t)tick * T1_PERIOD + cnt) * T1_PRESCALE);
+}
+#endif
+
 /********************************************************************
  *  DESC
  *
@@ -264,13 +309,147 @@ void os_sleep_init(void)
 
 void os_sleep(void)
 {
+#if (PICO_TICKLESS)
+    /*
+     * idle with the tick running. The kernel has the CPU at IPL 7,
+     *	so an interrupt wakes us and carries on here; it runs when
+     *	the kernel puts the IPL back
+     */
+    __asm__ volatile ("pwrsav #1");
+#else
     os_tick_stop();
     /*
      * here we do whatever we need to sleep...
      */
     os_tick_start();
+#endif
 }
 
+#if (OS_TICK_FRACTION)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_fraction
+ *
+ *  DESCRIPTION:	Timer 1 counts since the last tick the kernel
+ *					counted, for os_time_now(). If the period has run
+ *					out but the interrupt is still pending, the timer
+ *					is read again after the reset and the pending tick
+ *					added. Through a one-shot it's the counts since
+ *					it was set.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			the counts
+ *
+ *******************************************************************/
+
+os_time_t
+os_tick_fraction( void )
+{
+	uint16_t  cnt  = TMR1;
+	os_time_t part = 0;
+
+	if (IFS0bits.T1IF)
+	{
+		cnt  = TMR1;
+		part = (os_time_t)PR1 + 1UL;
+	}
+	return (part + cnt);
+}
+#endif
+
+#if (PICO_TICKLESS)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_oneshot
+ *
+ *  DESCRIPTION:	reload the tick timer to interrupt once after the
+ *					given number of ticks, bounded by the 16 bit period
+ *					register. The ticks are counted from the last tick,
+ *					so the counts already gone in this one are taken
+ *					off. The interrupt still counts as one tick. With
+ *					a tick still to be taken nothing is set, as the
+ *					one-shot would take it for its own.
+ *
+ *  INPUT:		ticks to sleep
+ *
+ *  OUTPUT:		ticks programmed
+ *
+ *******************************************************************/
+
+timer_t os_tick_oneshot( timer_t ticks )
+{
+    uint16_t part;
+
+    if (ticks > (0xFFFFUL / T1_PERIOD))
+    {
+        ticks = 0xFFFFUL / T1_PERIOD;
+    }
+    if (IFS0bits.T1IF)
+    {
+        /*
+         * a tick is waiting to be taken, and ends the sleep
+         *	at once; the timer is left as it is
+         */
+        return (0);
+    }
+    os_tick_stop();
+    part = TMR1;
+    TMR1 = 0;
+    PR1 = (uint16_t)((ticks * T1_PERIOD) - 1UL - part);
+    oneshot_ticks = ticks;
+    oneshot_fired = 0;
+    os_tick_start();
+    return (ticks);
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_periodic
+ *
+ *  DESCRIPTION:	return the tick timer to the periodic tick after a
+ *					one-shot. If the one-shot ran out, or is about to
+ *					be taken, its interrupt counts a tick; the counts
+ *					from the last tick are then the one-shot and the
+ *					timer since. Whole ticks are returned, and the part
+ *					tick left is carried in the timer, so an early
+ *					wake doesn't lose it.
+ *
+ *  INPUT:		none
+ *
+ *  OUTPUT:		ticks elapsed that the kernel has yet to count
+ *
+ *******************************************************************/
+
+timer_t os_tick_periodic( void )
+{
+    uint32_t counts;
+    timer_t  fired;
+    timer_t  elapsed;
+
+    if (0 == oneshot_ticks)
+    {
+        return (0);
+    }
+    os_tick_stop();
+    fired  = (oneshot_fired || IFS0bits.T1IF) ? 1 : 0;
+    counts = (uint32_t)oneshot_ticks * T1_PERIOD + TMR1;
+    if (!fired)
+    {
+        counts -= (uint32_t)PR1 + 1UL;
+    }
+    elapsed = (timer_t)(counts / T1_PERIOD) - fired;
+    oneshot_ticks = 0;
+    TMR1 = (uint16_t)(counts % T1_PERIOD);
+    PR1 = T1_RELOAD;
+    os_tick_start();
+    return (elapsed);
+}
+#endif
+
 /********************************************************************
  *  DESC
  *
@@ -336,12 +515,13 @@ void __attribute__((interrupt, no_auto_psv)) _T1Interrupt(void)
      *	and handle the event
      */
     IFS0bits.T1IF	= 0;
-    os_timerHook();
-    if (0 == --one_sec_prescale)
+#if (PICO_TICKLESS)
+    if (0 != oneshot_ticks)
     {
-        one_sec_prescale = SYSTICKHZ;
-        os_seconds++;
+        oneshot_fired = 1;
     }
+#endif
+    os_timerHook();
 }
 
 /********************************************************************
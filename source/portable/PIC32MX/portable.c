@@ -19,6 +19,12 @@
  *   09-19-12   DS  	Modified for the dsPic
  *   05-07-13   DS  	Add dsPIC, PIC24 support
  *   05-21-13   DS  	break out into platform specific directories
+ *   10-18-26   DS  	one-shot tick for tickless idle. os_seconds moved
+ *						to the kernel.
+ *   10-18-26   DS  	os_cycle_count() from the core timer.
+ *   10-18-26   DS  	os_tick_fraction() from the tick timer, for
+ *						os_time_now().
+ *   10-18-26   DS  	the part tick is carried through a one-shot.
  *
  *  Copyright (c) 2009 - 2016 Dave Sandler
  *
@@ -131,7 +137,10 @@ void 	os_tick_init( void );
  *   Module Data
  */
 
-static uint16_t		one_sec_prescale;
+#if (PICO_TICKLESS)
+static timer_t          oneshot_ticks;
+static volatile uint8_t oneshot_fired;
+#endif
 extern tcb_entry_t  *current_task;
 extern k_list_t     k_ready_list, k_wait_list;
 extern tcb_entry_t  tcb[N_TASKS];
@@ -147,6 +156,7 @@ extern timer_t		last_tick;
 #define T2_PRIO		4
 #define T2_CONFIG	(T2_ON | T2_IDLE_CON | T2_GATE_OFF | T2_PS_1_64 | T2_32BIT_MODE_OFF | T2_SOURCE_INT)
 #define T2_RELOAD	(SYS_FREQ/(PB_DIV*T2_PRESCALE*TICK_RATE_HZ) - 1)
+#define T2_PERIOD	(T2_RELOAD + 1UL)		/* counts per tick */
 
 /********************************************************************
  *  DESC
@@ -205,7 +215,6 @@ void os_tick_init( void )
      *			and start it.
      */
     T2CONbits.ON = 0;       // timer2 is disabled       
-    one_sec_prescale = SYSTICKHZ;
     
     T2CONbits.TCS = 1;      // external clock source
     T2CONbits.TCKPS = 0;    // 1:1 prescaler  
@@ -220,6 +229,27 @@ void os_tick_init( void )
     T2CONbits.ON  = 1;      //timer is enabled
 }
 
+#if (OS_CYCLE_COUNT)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_cycle_count
+ *
+ *  DESCRIPTION:	free running count for run time accounting. The
+ *					MIPS core timer counts at half the CPU clock.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			the core timer count
+ *
+ *******************************************************************/
+
+uint32_t os_cycle_count( void )
+{
+    return (_CP0_GET_COUNT());
+}
+#endif
+
 /********************************************************************
  *  DESC
  *
@@ -286,13 +316,147 @@ void os_sleep_init(void)
 
 void os_sleep(void)
 {
+#if (PICO_TICKLESS)
+    /*
+     * idle with the tick running. The kernel has interrupts off;
+     *	the M4K leaves wait for an interrupt all the same, and it
+     *	runs when the kernel turns them back on
+     */
+    __asm__ volatile ("wait");
+#else
     os_tick_stop();
     /*
      * here we do whatever we need to sleep...
      */
     os_tick_start();
+#endif
+}
+
+#if (OS_TICK_FRACTION)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_fraction
+ *
+ *  DESCRIPTION:	Timer 2 counts since the last tick the kernel
+ *					counted, for os_time_now(). If the period has run
+ *					out but the interrupt is still pending, the timer
+ *					is read again after the reset and the pending tick
+ *					added. Through a one-shot it's the counts since
+ *					it was set.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			the counts
+ *
+ *******************************************************************/
+
+os_time_t
+os_tick_fraction( void )
+{
+	uint16_t  cnt  = TMR2;
+	os_time_t part = 0;
+
+	if (IFS0bits.T2IF)
+	{
+		cnt  = TMR2;
+		part = (os_time_t)PR2 + 1UL;
+	}
+	return (part + cnt);
+}
+#endif
+
+#if (PICO_TICKLESS)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_oneshot
+ *
+ *  DESCRIPTION:	reload the tick timer to interrupt once after the
+ *					given number of ticks, bounded by the 16 bit period
+ *					register. The ticks are counted from the last tick,
+ *					so the counts already gone in this one are taken
+ *					off. The interrupt still counts as one tick. With
+ *					a tick still to be taken nothing is set, as the
+ *					one-shot would take it for its own.
+ *
+ *  INPUT:		ticks to sleep
+ *
+ *  OUTPUT:		ticks programmed
+ *
+ *******************************************************************/
+
+timer_t os_tick_oneshot( timer_t ticks )
+{
+    uint16_t part;
+
+    if (ticks > (0xFFFFUL / T2_PERIOD))
+    {
+        ticks = 0xFFFFUL / T2_PERIOD;
+    }
+    if (IFS0bits.T2IF)
+    {
+        /*
+         * a tick is waiting to be taken, and ends the sleep
+         *	at once; the timer is left as it is
+         */
+        return (0);
+    }
+    os_tick_stop();
+    part = TMR2;
+    TMR2 = 0;
+    PR2 = (uint16_t)((ticks * T2_PERIOD) - 1UL - part);
+    oneshot_ticks = ticks;
+    oneshot_fired = 0;
+    os_tick_start();
+    return (ticks);
 }
 
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_periodic
+ *
+ *  DESCRIPTION:	return the tick timer to the periodic tick after a
+ *					one-shot. If the one-shot ran out, or is about to
+ *					be taken, its interrupt counts a tick; the counts
+ *					from the last tick are then the one-shot and the
+ *					timer since. Whole ticks are returned, and the part
+ *					tick left is carried in the timer, so an early
+ *					wake doesn't lose it.
+ *
+ *  INPUT:		none
+ *
+ *  OUTPUT:		ticks elapsed that the kernel has yet to count
+ *
+ *******************************************************************/
+
+timer_t os_tick_periodic( void )
+{
+    uint32_t counts;
+    timer_t  fired;
+    timer_t  elapsed;
+
+    if (0 == oneshot_ticks)
+    {
+        return (0);
+    }
+    os_tick_stop();
+    fired  = (oneshot_fired || IFS0bits.T2IF) ? 1 : 0;
+    counts = (uint32_t)oneshot_ticks * T2_PERIOD + TMR2;
+    if (!fired)
+    {
+        counts -= (uint32_t)PR2 + 1UL;
+    }
+    elapsed = (timer_t)(counts / T2_PERIOD) - fired;
+    oneshot_ticks = 0;
+    TMR2 = (uint16_t)(counts % T2_PERIOD);
+    PR2 = T2_RELOAD;
+    os_tick_start();
+    return (elapsed);
+}
+#endif
+
 /********************************************************************
  *  DESC
  *
@@ -357,12 +521,13 @@ os_delay_ms( uint16_t ms )
 void __ISR_AT_VECTOR(_TIMER_2_VECTOR, IPL1AUTO) os_tick_interrupt(void)
 {
     IFS0bits.T2IF = 0; //clear flag
-    os_timerHook();
-    if (0 == --one_sec_prescale)
+#if (PICO_TICKLESS)
+    if (0 != oneshot_ticks)
     {
-        one_sec_prescale = SYSTICKHZ;
-        os_seconds++;
+        oneshot_fired = 1;
     }
+#endif
+    os_timerHook();
 }
 /*
  *  END OF portable.c
@@ -19,6 +19,10 @@
  *   09-19-12   DS  	Modified for the dsPic
  *   05-07-13   DS  	Add dsPIC, PIC24 support
  *   05-21-13   DS  	break out into platform specific directories
+ *   10-18-26   DS  	os_seconds moved to the kernel
+ *   10-18-26   DS  	os_tick_fraction() from the tick timer, for
+ *						os_time_now().
+ *   10-18-26   DS  	os_cycle_count() from the tick count and timer 1.
  *
  *  Copyright (c) 2009 - 2016 Dave Sandler
  *
@@ -133,7 +137,9 @@ void 	os_tick_init( void );
  *   Module Data
  */
 
-static uint16_t		one_sec_prescale;
+#if (PICO_TICKLESS)
+	#error tickless idle is not supported on the dsPIC port
+#endif
 extern tcb_entry_t  *current_task;
 extern k_list_t     k_ready_list, k_wait_list;
 extern tcb_entry_t  tcb[N_TASKS];
@@ -143,6 +149,7 @@ extern timer_t		last_tick;
 #define SYS_FREQ 				CPU_CLOCK_HZ
 #define T1_PRESCALE		        8
 #define T1_RELOAD				(SYS_FREQ/T1_PRESCALE/TICK_RATE_HZ)
+#define T1_PERIOD				(T1_RELOAD + 1UL)	/* counts per tick */
 /********************************************************************
  *  DESC
  *
@@ -180,6 +187,74 @@ os_tick_init( void )
     T1CONbits.TON		= 1;			/* start the timer				*/
 }
 
+#if (OS_CYCLE_COUNT)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_cycle_count
+ *
+ *  DESCRIPTION:	free running count of CPU cycles, for run time
+ *					accounting and OS_RR_CYCLES. There's no cycle
+ *					counter, so the count is made from the tick count
+ *					and the timer 1 counts into the current tick, at
+ *					T1_PRESCALE cycles a count. It is read again if a
+ *					tick lands in between. With
+ *					interrupts masked past a tick, or across a
+ *					tickless one-shot, the count is only approximate.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			the count
+ *
+ *******************************************************************/
+
+uint32_t os_cycle_count( void )
+{
+    timer_t  tick;
+    uint16_t cnt;
+
+    do
+    {
+        tick = current_tick;
+        cnt  = TMR1;
+    } while (tick != current_tick);
+    return (((uint32_t)tick * T1_PERIOD + cnt) * T1_PRESCALE);
+}
+#endif
+
+#if (OS_TICK_FRACTION)
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	os_tick_fraction
+ *
+ *  DESCRIPTION:	Timer 1 counts since the last tick the kernel
+ *					counted, for os_time_now(). If the period has run
+ *					out but the interrupt is still pending, the timer
+ *					is read again after the reset and the pending tick
+ *					added.
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			the counts
+ *
+ *******************************************************************/
+
+os_time_t
+os_tick_fraction( void )
+{
+	uint16_t  cnt  = TMR1;
+	os_time_t part = 0;
+
+	if (IFS0bits.T1IF)
+	{
+		cnt  = TMR1;
+		part = (os_time_t)PR1 + 1UL;
+	}
+	return (part + cnt);
+}
+#endif
+
 /********************************************************************
  *  DESC
  *
@@ -204,11 +279,6 @@ __attribute__((interrupt, no_auto_psv)) _T1Interrupt(void)
      */
     IFS0bits.T1IF	= 0;
     os_timerHook();
-    if (0 == --one_sec_prescale)
-    {
-        one_sec_prescale = SYSTICKHZ;
-        os_seconds++;
-    }
 }
 
 /********************************************************************
@@ -20,6 +20,7 @@
  *   05-07-13   DS  	Add dsPIC, PIC24 support
  *   05-21-13   DS  	break out into platform specific directories
  *   08-12-15   DS  	support for the Arm Cortex-M
+ *   10-18-26   DS  	Linux host target
  *
  *  Copyright (c) 2009 - 2015 Dave Sandler
  *
@@ -93,6 +94,8 @@
 	#include    "CortexM3/portable.c"
 #elif defined(CORTEXM0)
 	#include    "CortexM0/portable.c"
+#elif defined(LINUX)
+	#include    "Linux/portable.c"
 #else
 	#error Unknown processor or compiler.
 #endif
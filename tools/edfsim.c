@@ -0,0 +1,337 @@
+/********************************************************************
+ *
+ *  DESC
+ *
+ *  MODULE NAME:        edfsim.c
+ *
+ *  AUTHOR:        		Dave Sandler
+ *
+ *  DESCRIPTION:        Host simulation of the pico EDF scheduling class
+ *						against fixed priorities. Random periodic task sets
+ *						are run under the kernel's dispatch rules, and the
+ *						deadline miss rates are printed as CSV.
+ *
+ *						The kernel is non-preemptive, so the model is too.
+ *						A job runs for at most a slice of ticks per
+ *						dispatch, as a protothread that yields would, and
+ *						the scheduler picks again in between. A job's
+ *						deadline is its release plus the relative deadline,
+ *						and a job finishing after that tick is a miss, as
+ *						counted by get_deadline_misses(). Fixed priorities
+ *						are assigned rate monotonic.
+ *
+ *						cc -O2 -o edfsim edfsim.c -lm
+ *						./edfsim [-n tasks] [-s sets] [-t ticks] [-q slice]
+ *								 [-r seed]
+ *
+ *						A slice of 0 runs each job to completion.
+ *
+ *  EDIT HISTORY:
+ *  BASELINE
+ *  VERSION     INIT    DESCRIPTION OF CHANGE
+ *  --------    ----    ----------------------
+ *   10-18-26   DS  	Module creation.
+ *
+ *  Copyright (c) 2009 - 2021 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ********************************************************************/
+
+/*
+ *********************************************************************
+ *
+ *   System Includes
+ */
+#include	<stdint.h>
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<math.h>
+#include	<unistd.h>
+
+/*
+ *********************************************************************
+ *
+ *   Constants
+ */
+#define	MAX_TASKS		32
+#define	PERIOD_MIN		10			/* ticks */
+#define	PERIOD_MAX		1000		/* ticks */
+#define	U_FIRST			50			/* percent */
+#define	U_LAST			100
+#define	U_STEP			5
+
+typedef struct
+{
+    uint32_t	period;
+    uint32_t	cost;
+    uint32_t	deadline;
+    uint32_t	prio;			/* rate monotonic; 0 is highest */
+    uint32_t	job;			/* next job to run */
+    uint32_t	left;			/* ticks left of that job */
+} sim_task_t;
+
+typedef struct
+{
+    uint32_t	jobs;
+    uint32_t	misses;
+} sim_result_t;
+
+enum { SIM_FP, SIM_EDF };
+
+/*
+ *********************************************************************
+ *
+ *   Module Globals
+ */
+static sim_task_t	tasks[MAX_TASKS];
+static uint32_t		n_tasks = 5;
+static uint32_t		slice   = 1;
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	uunifast
+ *
+ *  DESCRIPTION:	draw a task set of the given total utilisation. the
+ *					per task shares are uniform over the simplex. periods
+ *					are log uniform, deadlines implicit.
+ *
+ *  INPUT:			total utilisation
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+static void
+uunifast( double util )
+{
+    double		sum = util;
+    double		next;
+    double		share;
+    uint32_t	i;
+    uint32_t	j;
+
+    for (i = 0; i < n_tasks; i++)
+    {
+        if ((i + 1) < n_tasks)
+        {
+            next  = sum * pow(drand48(), 1.0 / (double)(n_tasks - i - 1));
+            share = sum - next;
+            sum   = next;
+        }
+        else
+        {
+            share = sum;
+        }
+        tasks[i].period   = (uint32_t)exp(log(PERIOD_MIN) +
+                                          drand48() * (log(PERIOD_MAX) - log(PERIOD_MIN)));
+        tasks[i].cost     = (uint32_t)(share * tasks[i].period + 0.5);
+        if (0 == tasks[i].cost)
+        {
+            tasks[i].cost = 1;
+        }
+        tasks[i].deadline = tasks[i].period;
+    }
+    for (i = 0; i < n_tasks; i++)
+    {
+        tasks[i].prio = 0;
+        for (j = 0; j < n_tasks; j++)
+        {
+            if ((tasks[j].period < tasks[i].period) ||
+                ((tasks[j].period == tasks[i].period) && (j < i)))
+            {
+                tasks[i].prio++;
+            }
+        }
+    }
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	simulate
+ *
+ *  DESCRIPTION:	run the current task set for a number of ticks. with
+ *					nothing ready, time skips to the next release.
+ *					otherwise the chosen job runs for a slice.
+ *
+ *  INPUT:			policy, ticks to run, result to add to
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+static void
+simulate( int policy, uint32_t horizon, sim_result_t *res )
+{
+    uint64_t	now = 0;
+    uint64_t	release;
+    uint64_t	key;
+    uint64_t	best_key;
+    uint64_t	next;
+    uint32_t	best;
+    uint32_t	run;
+    uint32_t	i;
+
+    for (i = 0; i < n_tasks; i++)
+    {
+        tasks[i].job  = 0;
+        tasks[i].left = tasks[i].cost;
+    }
+    while (now < horizon)
+    {
+        best     = n_tasks;
+        best_key = UINT64_MAX;
+        next     = UINT64_MAX;
+        for (i = 0; i < n_tasks; i++)
+        {
+            release = (uint64_t)tasks[i].job * tasks[i].period;
+            if (release > now)
+            {
+                if (release < next)
+                {
+                    next = release;
+                }
+                continue;
+            }
+            key = (SIM_EDF == policy) ? (release + tasks[i].deadline) : tasks[i].prio;
+            if (key < best_key)
+            {
+                best_key = key;
+                best     = i;
+            }
+        }
+        if (n_tasks == best)
+        {
+            now = next;
+            continue;
+        }
+        run = tasks[best].left;
+        if ((0 != slice) && (run > slice))
+        {
+            run = slice;
+        }
+        now              += run;
+        tasks[best].left -= run;
+        if (0 != tasks[best].left)
+        {
+            continue;
+        }
+        release = (uint64_t)tasks[best].job * tasks[best].period;
+        res->jobs++;
+        if (now > (release + tasks[best].deadline))
+        {
+            res->misses++;
+        }
+        tasks[best].job++;
+        tasks[best].left = tasks[best].cost;
+    }
+    /*
+     * jobs left over whose deadline fell inside the run missed it
+     */
+    for (i = 0; i < n_tasks; i++)
+    {
+        for (release = (uint64_t)tasks[i].job * tasks[i].period;
+             (release + tasks[i].deadline) < horizon;
+             release += tasks[i].period)
+        {
+            res->jobs++;
+            res->misses++;
+        }
+    }
+}
+
+/********************************************************************
+ *  DESC
+ *
+ *  ROUTINE NAME:	main
+ *
+ *  DESCRIPTION:	sweep the utilisation, printing one CSV row per step:
+ *					the job miss rate and the share of task sets with no
+ *					miss at all, for each policy.
+ *
+ *  INPUT:			command line
+ *
+ *  OUTPUT:			exit status
+ *
+ *******************************************************************/
+
+int
+main( int argc, char **argv )
+{
+    sim_result_t	fp;
+    sim_result_t	edf;
+    uint32_t		sets    = 200;
+    uint32_t		horizon = 100000;
+    uint32_t		fp_ok;
+    uint32_t		edf_ok;
+    uint32_t		fp_miss;
+    uint32_t		edf_miss;
+    uint32_t		util;
+    uint32_t		set;
+    long			seed = 1;
+    int				opt;
+
+    while (-1 != (opt = getopt(argc, argv, "n:s:t:q:r:")))
+    {
+        switch (opt)
+        {
+            case 'n': n_tasks = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 's': sets    = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 't': horizon = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'q': slice   = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'r': seed    = strtol(optarg, NULL, 0);            break;
+            default:
+                fprintf(stderr, "usage: %s [-n tasks] [-s sets] [-t ticks] [-q slice] [-r seed]\n", argv[0]);
+                return (1);
+        }
+    }
+    if ((n_tasks < 1) || (n_tasks > MAX_TASKS))
+    {
+        fprintf(stderr, "tasks must be 1 to %d\n", MAX_TASKS);
+        return (1);
+    }
+    srand48(seed);
+    printf("util,fp_miss_rate,edf_miss_rate,fp_sched,edf_sched\n");
+    for (util = U_FIRST; util <= U_LAST; util += U_STEP)
+    {
+        fp.jobs  = fp.misses  = 0;
+        edf.jobs = edf.misses = 0;
+        fp_ok    = edf_ok     = 0;
+        for (set = 0; set < sets; set++)
+        {
+            uunifast(util / 100.0);
+            fp_miss  = fp.misses;
+            edf_miss = edf.misses;
+            simulate(SIM_FP,  horizon, &fp);
+            simulate(SIM_EDF, horizon, &edf);
+            fp_ok   += (fp_miss  == fp.misses);
+            edf_ok  += (edf_miss == edf.misses);
+        }
+        printf("%.2f,%.6f,%.6f,%.3f,%.3f\n", util / 100.0,
+               (double)fp.misses  / (double)fp.jobs,
+               (double)edf.misses / (double)edf.jobs,
+               (double)fp_ok  / (double)sets,
+               (double)edf_ok / (double)sets);
+    }
+    return (0);
+}
+
+/*
+ *  END OF edfsim.c
+ *
+ *******************************************************************/
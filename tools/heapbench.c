@@ -0,0 +1,347 @@
+/********************************************************************
+ *
+ *  DESC
+ *
+ *  MODULE NAME:        heapbench.c
+ *
+ *  AUTHOR:        		Dave Sandler
+ *
+ *  DESCRIPTION:        A pico heap against the C library's malloc() on
+ *						a Linux host. One random run of allocations and
+ *						frees is made, with a mix of sizes like an
+ *						application's: many small records, frames, and a
+ *						few large blobs. Both allocators replay it, each
+ *						call timed alone, and the percentiles and worst
+ *						case are printed as CSV, with the pico heap's own
+ *						figures after. The times include the clock's.
+ *
+ *						cc -std=gnu99 -O2 -DLINUX -DOS_HOST_TICK=0
+ *						   -DOS_HEAP_FL_MAX=26 -Iinclude
+ *						   -Isource/portable/Linux -o heapbench
+ *						   tools/heapbench.c source/pico.c source/picosem.c
+ *						   source/picomsg.c source/picoheap.c
+ *						   source/portable/portable.c
+ *						./heapbench [-n ops] [-s live] [-m heap MB]
+ *
+ *						-DOS_HEAP_CHECK=1 times the heap with its guards.
+ *
+ *  EDIT HISTORY:
+ *  BASELINE
+ *  VERSION     INIT    DESCRIPTION OF CHANGE
+ *  --------    ----    ----------------------
+ *   10-18-26   DS  	Module creation.
+ *
+ *  Copyright (c) 2009 - 2021 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ********************************************************************/
+
+/*
+ *********************************************************************
+ *
+ *   System Includes
+ */
+#include	"pico.h"
+#include	"picoheap.h"
+#include	<stdlib.h>
+#include	<string.h>
+
+/*
+ *********************************************************************
+ *
+ *   Constants
+ */
+#define	MAX_LIVE		65536
+
+/*
+ * the size mix: percent of allocations, and their smallest and
+ *	largest sizes
+ */
+static const struct
+{
+    uint32_t	pct;
+    uint32_t	lo;
+    uint32_t	hi;
+} mix[] =
+{
+    { 60,    8,    64 },			/* records, list nodes			*/
+    { 25,   65,   256 },			/* messages						*/
+    { 12,  257,  2048 },			/* frames						*/
+    {  3, 2049, 16384 }				/* configuration blobs			*/
+};
+
+/*
+ *********************************************************************
+ *
+ *   Module Data
+ */
+static uint32_t			n_ops  = 1000000;
+static uint32_t			n_live = 4096;
+static uint32_t			heap_mb = 64;
+static uint32_t			seed = 1;
+
+static uint32_t			*op_slot;			/* the run: a slot, and the	*/
+static uint32_t			*op_size;			/* size to allocate if empty */
+static void				*live[MAX_LIVE];
+static double			*sample;
+static uint32_t			failed;
+
+static os_heap_t		heap;
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	now, rnd
+ *
+ *  DESCRIPTION:	the clock in ns, and xorshift
+ *
+ *******************************************************************/
+
+static uint64_t
+now( void )
+{
+    struct timespec	t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec);
+}
+
+static uint32_t
+rnd( void )
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return (seed);
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	make_run
+ *
+ *  DESCRIPTION:	pick the slot each operation works on, and a size
+ *					from the mix for it
+ *
+ *******************************************************************/
+
+static void
+make_run( void )
+{
+    uint32_t	i;
+    uint32_t	m;
+    uint32_t	p;
+
+    for (i = 0; i < n_ops; i++)
+    {
+        op_slot[i] = rnd() % n_live;
+        p          = rnd() % 100;
+        for (m = 0; p >= mix[m].pct; m++)
+        {
+            p -= mix[m].pct;
+        }
+        op_size[i] = mix[m].lo + rnd() % (mix[m].hi - mix[m].lo + 1);
+    }
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	cmp, report
+ *
+ *  DESCRIPTION:	sort the times and print a row of results
+ *
+ *  INPUT:			allocator name
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+static int
+cmp( const void *a, const void *b )
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return ((x > y) - (x < y));
+}
+
+static double
+pct( double p )
+{
+    return (sample[(uint32_t)(p * (n_ops - 1) + 0.5)]);
+}
+
+static void
+report( const char *name )
+{
+    double		sum = 0;
+    uint32_t	i;
+
+    qsort(sample, n_ops, sizeof(double), cmp);
+    for (i = 0; i < n_ops; i++)
+    {
+        sum += sample[i];
+    }
+    printf("%s,%u,%u,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%u\n", name, n_ops, n_live, sum / n_ops,
+           pct(0.5), pct(0.99), pct(0.999), pct(0.99999), sample[n_ops - 1], failed);
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	replay
+ *
+ *  DESCRIPTION:	run the operations with one allocator, timing each
+ *					call. A block allocated is written at each end, out
+ *					of the timing, so both allocators pay for touching
+ *					their memory alike.
+ *
+ *  INPUT:			non-zero for the pico heap
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+static void
+replay( int pico )
+{
+    uint64_t	t0;
+    uint64_t	t1;
+    uint32_t	i;
+    uint32_t	s;
+    uint8_t		*p;
+
+    memset(live, 0, sizeof(live));
+    failed = 0;
+    for (i = 0; i < n_ops; i++)
+    {
+        s = op_slot[i];
+        if ((void *)0 != live[s])
+        {
+            t0 = now();
+            if (pico)
+            {
+                os_heap_free(&heap, live[s]);
+            }
+            else
+            {
+                free(live[s]);
+            }
+            t1 = now();
+            live[s] = (void *)0;
+        }
+        else
+        {
+            t0 = now();
+            p  = pico ? (uint8_t *)os_heap_alloc(&heap, op_size[i]) : (uint8_t *)malloc(op_size[i]);
+            t1 = now();
+            if ((uint8_t *)0 == p)
+            {
+                failed++;
+            }
+            else
+            {
+                p[0]              = (uint8_t)i;
+                p[op_size[i] - 1] = (uint8_t)i;
+            }
+            live[s] = p;
+        }
+        sample[i] = (double)(t1 - t0);
+    }
+    for (s = 0; s < n_live; s++)
+    {
+        if (pico)
+        {
+            os_heap_free(&heap, live[s]);
+        }
+        else
+        {
+            free(live[s]);
+        }
+    }
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	main
+ *
+ *  DESCRIPTION:	make the run, and replay it with malloc() and with
+ *					a pico heap
+ *
+ *  INPUT:			command line
+ *
+ *  OUTPUT:			exit status
+ *
+ *******************************************************************/
+
+int
+main( int argc, char **argv )
+{
+    os_heap_stats_t	st;
+    void			*mem;
+    int				opt;
+
+    while (-1 != (opt = getopt(argc, argv, "n:s:m:")))
+    {
+        switch (opt)
+        {
+            case 'n': n_ops   = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 's': n_live  = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'm': heap_mb = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n ops] [-s live] [-m heap MB]\n", argv[0]);
+                return (1);
+        }
+    }
+    if ((n_live < 1) || (n_live > MAX_LIVE) || (0 == n_ops) || (0 == heap_mb) || (heap_mb > 2048))
+    {
+        fprintf(stderr, "live must be 1 to %d, and the heap 1 to 2048 MB\n", MAX_LIVE);
+        return (1);
+    }
+    op_slot = malloc(n_ops * sizeof(uint32_t));
+    op_size = malloc(n_ops * sizeof(uint32_t));
+    sample  = malloc(n_ops * sizeof(double));
+    mem     = malloc((size_t)heap_mb << 20);
+    if ((NULL == op_slot) || (NULL == op_size) || (NULL == sample) || (NULL == mem))
+    {
+        fprintf(stderr, "out of memory\n");
+        return (1);
+    }
+    memset(mem, 0, (size_t)heap_mb << 20);
+    os_init();
+    os_heap_init(&heap);
+    os_heap_add(&heap, mem, heap_mb << 20);
+    make_run();
+
+    printf("allocator,ops,live,mean,p50,p99,p99.9,p99.999,max,failed\n");
+    replay(0);
+    report("malloc");
+    replay(1);
+    report("pico_heap");
+    os_heap_stats(&heap, &st);
+    printf("\nsize,peak,free_blocks,largest,frag,failed,corrupt,check\n");
+    printf("%u,%u,%u,%u,%u,%u,%u,%u\n", st.size, st.peak, st.free_blocks, st.largest,
+           st.frag, st.failed, st.corrupt, os_heap_check(&heap));
+    return (0);
+}
+
+/*
+ *  END OF heapbench.c
+ *
+ *******************************************************************/
@@ -0,0 +1,237 @@
+/********************************************************************
+ *
+ *  DESC
+ *
+ *  MODULE NAME:        hookbench.c
+ *
+ *  AUTHOR:        		Dave Sandler
+ *
+ *  DESCRIPTION:        Timer hook overhead on a Linux host. A set of
+ *						hooks at mixed rates is driven through
+ *						os_timerHook(), first the old way, with every hook
+ *						called on every tick and counting ticks itself,
+ *						then with the rate given to the hook registry. The
+ *						cost per tick and the hook calls per tick are
+ *						printed as CSV.
+ *
+ *						Hook i runs once every rates[i % N_RATES] ticks.
+ *
+ *						cc -std=gnu99 -O2 -DLINUX -DOS_HOST_TICK=0 -Iinclude
+ *						   -Isource/portable/Linux -o hookbench
+ *						   tools/hookbench.c source/pico.c source/picosem.c
+ *						   source/picomsg.c source/portable/portable.c
+ *						./hookbench [-n hooks] [-t ticks]
+ *
+ *  EDIT HISTORY:
+ *  BASELINE
+ *  VERSION     INIT    DESCRIPTION OF CHANGE
+ *  --------    ----    ----------------------
+ *   10-18-26   DS  	Module creation.
+ *   10-18-26   DS  	Built without the host tick; it ticks itself.
+ *
+ *  Copyright (c) 2009 - 2021 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ********************************************************************/
+
+/*
+ *********************************************************************
+ *
+ *   System Includes
+ */
+#include	"pico.h"
+#include	<stdlib.h>
+
+/*
+ *********************************************************************
+ *
+ *   Constants
+ */
+#define	MAX_HOOKS		64
+#define	N_RATES			(sizeof(rates) / sizeof(rates[0]))
+
+static const uint16_t	rates[] = { 1, 10, 100, 1000 };
+
+/*
+ *********************************************************************
+ *
+ *   Module Data
+ */
+static t_hook_entry_t	hook[MAX_HOOKS];
+static uint16_t			left[MAX_HOOKS];	/* ticks to the next call, the old way */
+static uint32_t			n_hooks = 32;
+static volatile uint32_t work;
+static uint64_t			calls;
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	hook_work, hook_n, hook_div_n
+ *
+ *  DESCRIPTION:	the hooks. Each does a little work when it's time to.
+ *					A divided hook checks its own count first, as hooks
+ *					had to before the registry kept rates; one is made
+ *					for each slot by the macros below.
+ *
+ *******************************************************************/
+
+static void
+hook_work( void )
+{
+    work = work * 1103515245UL + 12345UL;
+    calls++;
+}
+
+#define HOOK_FNS(i)																\
+    static void hook_##i( void ) { hook_work(); }								\
+    static void hook_div_##i( void )											\
+    {																			\
+        if (0 == --left[i])														\
+        {																		\
+            left[i] = rates[i % N_RATES];										\
+            hook_work();														\
+        }																		\
+    }
+HOOK_FNS(0) HOOK_FNS(1) HOOK_FNS(2) HOOK_FNS(3) HOOK_FNS(4) HOOK_FNS(5) HOOK_FNS(6) HOOK_FNS(7)
+HOOK_FNS(8) HOOK_FNS(9) HOOK_FNS(10) HOOK_FNS(11) HOOK_FNS(12) HOOK_FNS(13) HOOK_FNS(14) HOOK_FNS(15)
+HOOK_FNS(16) HOOK_FNS(17) HOOK_FNS(18) HOOK_FNS(19) HOOK_FNS(20) HOOK_FNS(21) HOOK_FNS(22) HOOK_FNS(23)
+HOOK_FNS(24) HOOK_FNS(25) HOOK_FNS(26) HOOK_FNS(27) HOOK_FNS(28) HOOK_FNS(29) HOOK_FNS(30) HOOK_FNS(31)
+HOOK_FNS(32) HOOK_FNS(33) HOOK_FNS(34) HOOK_FNS(35) HOOK_FNS(36) HOOK_FNS(37) HOOK_FNS(38) HOOK_FNS(39)
+HOOK_FNS(40) HOOK_FNS(41) HOOK_FNS(42) HOOK_FNS(43) HOOK_FNS(44) HOOK_FNS(45) HOOK_FNS(46) HOOK_FNS(47)
+HOOK_FNS(48) HOOK_FNS(49) HOOK_FNS(50) HOOK_FNS(51) HOOK_FNS(52) HOOK_FNS(53) HOOK_FNS(54) HOOK_FNS(55)
+HOOK_FNS(56) HOOK_FNS(57) HOOK_FNS(58) HOOK_FNS(59) HOOK_FNS(60) HOOK_FNS(61) HOOK_FNS(62) HOOK_FNS(63)
+
+static void ( * const hook_fn[MAX_HOOKS] )( void ) =
+{
+    hook_0, hook_1, hook_2, hook_3, hook_4, hook_5, hook_6, hook_7,
+    hook_8, hook_9, hook_10, hook_11, hook_12, hook_13, hook_14, hook_15,
+    hook_16, hook_17, hook_18, hook_19, hook_20, hook_21, hook_22, hook_23,
+    hook_24, hook_25, hook_26, hook_27, hook_28, hook_29, hook_30, hook_31,
+    hook_32, hook_33, hook_34, hook_35, hook_36, hook_37, hook_38, hook_39,
+    hook_40, hook_41, hook_42, hook_43, hook_44, hook_45, hook_46, hook_47,
+    hook_48, hook_49, hook_50, hook_51, hook_52, hook_53, hook_54, hook_55,
+    hook_56, hook_57, hook_58, hook_59, hook_60, hook_61, hook_62, hook_63
+};
+static void ( * const hook_div_fn[MAX_HOOKS] )( void ) =
+{
+    hook_div_0, hook_div_1, hook_div_2, hook_div_3, hook_div_4, hook_div_5, hook_div_6, hook_div_7,
+    hook_div_8, hook_div_9, hook_div_10, hook_div_11, hook_div_12, hook_div_13, hook_div_14, hook_div_15,
+    hook_div_16, hook_div_17, hook_div_18, hook_div_19, hook_div_20, hook_div_21, hook_div_22, hook_div_23,
+    hook_div_24, hook_div_25, hook_div_26, hook_div_27, hook_div_28, hook_div_29, hook_div_30, hook_div_31,
+    hook_div_32, hook_div_33, hook_div_34, hook_div_35, hook_div_36, hook_div_37, hook_div_38, hook_div_39,
+    hook_div_40, hook_div_41, hook_div_42, hook_div_43, hook_div_44, hook_div_45, hook_div_46, hook_div_47,
+    hook_div_48, hook_div_49, hook_div_50, hook_div_51, hook_div_52, hook_div_53, hook_div_54, hook_div_55,
+    hook_div_56, hook_div_57, hook_div_58, hook_div_59, hook_div_60, hook_div_61, hook_div_62, hook_div_63
+};
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	run
+ *
+ *  DESCRIPTION:	register the hooks, one way or the other, and time
+ *					the ticks. One CSV row is printed.
+ *
+ *  INPUT:			non-zero to let the registry keep the rates; ticks
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+static void
+run( int registry, uint32_t ticks )
+{
+    struct timespec	t0;
+    struct timespec	t1;
+    uint32_t		i;
+    uint16_t		rate;
+    double			ns;
+
+    os_init();
+    for (i = 0; i < n_hooks; i++)
+    {
+        rate = rates[i % N_RATES];
+        if (registry)
+        {
+            /*
+             * spread the hooks of each rate over its period
+             */
+            os_add_timerhook_rate(&hook[i], hook_fn[i], rate, (uint16_t)((i / N_RATES) % rate), OS_HOOK_PRIO);
+        }
+        else
+        {
+            left[i] = (uint16_t)(1 + (i / N_RATES) % rate);
+            os_add_timerhook(&hook[i], hook_div_fn[i]);
+        }
+    }
+    calls = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < ticks; i++)
+    {
+        os_timerHook();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = (double)(t1.tv_sec - t0.tv_sec) * 1e9 + (double)(t1.tv_nsec - t0.tv_nsec);
+    printf("%s,%u,%u,%.1f,%.3f\n", registry ? "registry" : "every_tick", n_hooks, ticks,
+           ns / ticks, (double)calls / ticks);
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	main
+ *
+ *  DESCRIPTION:	time both ways of registering the hooks.
+ *
+ *  INPUT:			command line
+ *
+ *  OUTPUT:			exit status
+ *
+ *******************************************************************/
+
+int
+main( int argc, char **argv )
+{
+    uint32_t	ticks = 10000000;
+    int			opt;
+
+    while (-1 != (opt = getopt(argc, argv, "n:t:")))
+    {
+        switch (opt)
+        {
+            case 'n': n_hooks = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 't': ticks   = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n hooks] [-t ticks]\n", argv[0]);
+                return (1);
+        }
+    }
+    if ((n_hooks < 1) || (n_hooks > MAX_HOOKS) || (0 == ticks))
+    {
+        fprintf(stderr, "hooks must be 1 to %d\n", MAX_HOOKS);
+        return (1);
+    }
+    printf("mode,hooks,ticks,ns_per_tick,hook_calls_per_tick\n");
+    run(0, ticks);
+    run(1, ticks);
+    return (0);
+}
+
+/*
+ *  END OF hookbench.c
+ *
+ *******************************************************************/
@@ -0,0 +1,1289 @@
+/********************************************************************
+ *
+ *  DESC
+ *
+ *  MODULE NAME:        kbench.c
+ *
+ *  AUTHOR:        		Dave Sandler
+ *
+ *  DESCRIPTION:        Kernel micro-benchmarks on a Linux host. Each
+ *						benchmark takes a number of samples, and prints
+ *						the mean, percentiles and worst case, as JSON or
+ *						CSV, so that runs can be compared.
+ *
+ *						clock		cost of reading the clock, which the
+ *									latency figures include
+ *						dispatch	one pass of os_start_sched(), by ready
+ *									tasks
+ *						resume		os_suspend_task() and os_resume_task()
+ *									of one task, by ready tasks
+ *						timers		service_os_timers() per tick, by tasks
+ *									delayed 1 to 1000 ticks
+ *						sem_wake	os_sem_signal() to the waiter running
+ *						inversion	a high priority task's wait for a lock
+ *									held by a low one, while a middle one
+ *									runs, with a semaphore and a mutex
+ *						rr			dispatches per task of equal priority
+ *									tasks that yield, and Jain's fairness
+ *									index of them
+ *						que_byte	os_que_add() and os_que_remove(), per
+ *									byte
+ *						que_bulk	os_que_putarray() of 64 bytes, and
+ *									their removal, per byte
+ *						que_write	os_que_write() and os_que_read() of 64
+ *									bytes, per byte
+ *						que_span	64 bytes copied into os_que_reserve()
+ *									and out of os_que_peek_span(), per byte
+ *						ring_byte	os_ring_put() and os_ring_get(), per
+ *									byte
+ *						ring_write	os_ring_write() and os_ring_read() of 64
+ *									bytes, per byte
+ *						ring_xfer	bytes through the ring from a producer
+ *									thread to the consumer, by os_ring_put()
+ *									and os_ring_get(), and by 64 byte
+ *									os_ring_write() and os_ring_read(), per
+ *									byte
+ *						que_xfer	the same through os_que_add() and
+ *									os_que_remove(), with a pthread mutex
+ *									around each, per byte
+ *						mbox		os_msg_send() to the receiver running
+ *						msg_rpc		request and reply round trips between
+ *									two tasks, with pooled messages
+ *						pool		os_pool_alloc() and os_pool_free()
+ *						fletcher16	calc_fletcher16(), per byte
+ *
+ *						Scheduler loops are left with longjmp(). rr only
+ *						shares out the dispatches with PICO_RR set.
+ *
+ *						cc -std=gnu99 -O2 -DLINUX -DPICO_RR=1 -DN_TASKS=4200
+ *						   -DOS_HOST_TICK=0 -Iinclude -Isource/portable/Linux -o kbench
+ *						   tools/kbench.c source/pico.c source/picosem.c
+ *						   source/picomsg.c source/picoque.c
+ *						   source/picopool.c source/portable/portable.c -pthread
+ *						./kbench [-f json|csv] [-b bench] [-n samples]
+ *
+ *  EDIT HISTORY:
+ *  BASELINE
+ *  VERSION     INIT    DESCRIPTION OF CHANGE
+ *  --------    ----    ----------------------
+ *   10-18-26   DS  	Module creation.
+ *   10-18-26   DS  	Built without the host tick; it ticks itself.
+ *   10-18-26   DS  	mbox takes messages with os_msg_receive. msg_rpc.
+ *   10-18-26   DS  	pool.
+ *   10-18-26   DS  	que_write and que_span.
+ *   10-18-26   DS  	ring_byte and ring_write.
+ *   10-18-26   DS  	ring_xfer and que_xfer, across two threads.
+ *
+ *  Copyright (c) 2009 - 2021 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ********************************************************************/
+
+/*
+ *********************************************************************
+ *
+ *   System Includes
+ */
+#include	"pico.h"
+#include	"picosem.h"
+#include	"picomsg.h"
+#include	"picoque.h"
+#include	"picopool.h"
+#include	<pthread.h>
+#include	<sched.h>
+#include	<setjmp.h>
+#include	<stdlib.h>
+#include	<string.h>
+
+/*
+ *********************************************************************
+ *
+ *   Constants
+ */
+#define	BATCH			256		/* operations timed together			*/
+#define	MAX_SAMPLES		100000
+#define	RR_TASKS		8
+#define	INV_BURST		50		/* middle task dispatches per burst		*/
+#define	INV_HOLD		5		/* yields the low task holds the lock	*/
+#define	QUE_SIZE		1024
+#define	BULK			64
+#define	RPC_MSGS		4
+#define	RPC_SIZE		32
+#define	XFER			4096	/* bytes received per sample			*/
+
+/*
+ *********************************************************************
+ *
+ *   Module Data
+ */
+static double			sample[MAX_SAMPLES];
+static uint32_t			n_samples = 2000;
+static uint32_t			taken;
+static int				csv;
+static int				rows;
+static const char		*only;
+static jmp_buf			done;
+static tcb_entry_t		*handle[N_TASKS];
+static k_list_t			park;
+static uint32_t			seed = 1;
+
+static volatile uint32_t count;
+static uint64_t			t_mark;
+
+static os_sem_t			sem;
+static os_mutex_t		mtx;
+static int				use_mutex;
+static tcb_entry_t		*inv_high;
+static tcb_entry_t		*inv_mid;
+static uint32_t			inv_i;
+
+static uint32_t			rr_count[RR_TASKS];
+
+static os_mail_t		mbox;
+static os_mail_t		rpc_reply;
+static os_msg_t			msg;
+static os_msg_t			rpc_msgs[RPC_MSGS];
+static uint8_t			rpc_data[RPC_MSGS * RPC_SIZE];
+static os_msg_pool_t	rpc_pool;
+
+OS_POOL_DEFINE(blk_pool, 64, BULK);
+
+static volatile uint16_t check;
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	now, rnd
+ *
+ *  DESCRIPTION:	the clock in ns, and xorshift
+ *
+ *******************************************************************/
+
+static uint64_t
+now( void )
+{
+    struct timespec	t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec);
+}
+
+static uint32_t
+rnd( void )
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return (seed);
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	cmp, report
+ *
+ *  DESCRIPTION:	sort the samples taken and print a row of results
+ *
+ *  INPUT:			bench, parameter, unit
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+static int
+cmp( const void *a, const void *b )
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return ((x > y) - (x < y));
+}
+
+static double
+pct( double p )
+{
+    return (sample[(uint32_t)(p * (taken - 1) + 0.5)]);
+}
+
+static void
+report( const char *bench, const char *param, const char *unit )
+{
+    double		sum = 0;
+    uint32_t	i;
+
+    if (0 == taken)
+    {
+        return;
+    }
+    qsort(sample, taken, sizeof(double), cmp);
+    for (i = 0; i < taken; i++)
+    {
+        sum += sample[i];
+    }
+    if (csv)
+    {
+        printf("%s,%s,%s,%u,%.2f,%.2f,%.2f,%.2f,%.2f\n", bench, param, unit, taken,
+               sum / taken, pct(0.5), pct(0.9), pct(0.99), sample[taken - 1]);
+    }
+    else
+    {
+        printf("%s\n    {\"bench\":\"%s\",\"param\":\"%s\",\"unit\":\"%s\",\"samples\":%u,"
+               "\"mean\":%.2f,\"p50\":%.2f,\"p90\":%.2f,\"p99\":%.2f,\"max\":%.2f}",
+               rows ? "," : "", bench, param, unit, taken,
+               sum / taken, pct(0.5), pct(0.9), pct(0.99), sample[taken - 1]);
+    }
+    rows++;
+    taken = 0;
+}
+
+static void
+report_n( const char *bench, uint32_t param, const char *unit )
+{
+    char	p[16];
+
+    snprintf(p, sizeof(p), "%u", param);
+    report(bench, p, unit);
+}
+
+static void
+take( double v )
+{
+    if (taken < MAX_SAMPLES)
+    {
+        sample[taken++] = v;
+    }
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	fill
+ *
+ *  DESCRIPTION:	make tasks ready that never run, behind the ones
+ *					measured, at priorities 1 and below
+ *
+ *  INPUT:			number of tasks
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+static int
+idle_task( tcb_pt_t *pt )
+{
+    (void)pt;
+    return (PT_YIELDED);
+}
+
+static void
+fill( uint32_t n )
+{
+    uint32_t	i;
+
+    for (i = 0; i < n; i++)
+    {
+        handle[i] = os_create_task((uint8_t)(1 + i % (OS_N_PRIO - 1)), TCB_NULL_ENV, idle_task);
+        os_resume_task(handle[i]);
+    }
+}
+
+static void
+start( void )
+{
+    os_init();
+    park.next = park.last = &park;
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	bench_clock
+ *
+ *******************************************************************/
+
+static void
+bench_clock( void )
+{
+    uint64_t	t0;
+    uint32_t	i;
+    uint32_t	s;
+
+    for (s = 0; s < n_samples; s++)
+    {
+        t0 = now();
+        for (i = 0; i < BATCH; i++)
+        {
+            (void)now();
+        }
+        take((double)(now() - t0) / BATCH);
+    }
+    report("clock", "-", "ns");
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	bench_dispatch
+ *
+ *  DESCRIPTION:	a task at priority 0 yields, and times every batch
+ *					of its dispatches
+ *
+ *******************************************************************/
+
+static int
+dispatch_task( tcb_pt_t *pt )
+{
+    uint64_t	t;
+
+    if (0 == (++count % BATCH))
+    {
+        t = now();
+        take((double)(t - t_mark) / BATCH);
+        t_mark = t;
+        if (taken == n_samples)
+        {
+            longjmp(done, 1);
+        }
+    }
+    (void)pt;
+    return (PT_YIELDED);
+}
+
+static void
+bench_dispatch( uint32_t ready )
+{
+    start();
+    fill(ready - 1);
+    os_resume_task(os_create_task(0, TCB_NULL_ENV, dispatch_task));
+    count  = 0;
+    t_mark = now();
+    if (0 == setjmp(done))
+    {
+        os_start_sched();
+    }
+    report_n("dispatch", ready, "ns");
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	bench_resume
+ *
+ *  DESCRIPTION:	suspend and resume one task among others ready
+ *
+ *******************************************************************/
+
+static void
+bench_resume( uint32_t ready )
+{
+    tcb_entry_t	*t;
+    uint64_t	t0;
+    uint32_t	i;
+    uint32_t	s;
+
+    start();
+    fill(ready - 1);
+    t = os_create_task(OS_MED_PRIO, TCB_NULL_ENV, idle_task);
+    os_resume_task(t);
+    for (s = 0; s < n_samples; s++)
+    {
+        t0 = now();
+        for (i = 0; i < BATCH; i++)
+        {
+            os_suspend_task(&park, (k_list_t *)t);
+            os_resume_task(t);
+        }
+        take((double)(now() - t0) / BATCH);
+    }
+    report_n("resume", ready, "ns");
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	bench_timers
+ *
+ *  DESCRIPTION:	tasks are delayed from 1 to 1000 ticks, and put back
+ *					on a fresh delay when they expire. Each tick of
+ *					service_os_timers() is a sample.
+ *
+ *******************************************************************/
+
+static void
+bench_timers( uint32_t n )
+{
+    uint64_t	t0;
+    uint32_t	i;
+    uint32_t	s;
+
+    start();
+    for (i = 0; i < n; i++)
+    {
+        handle[i] = os_create_task(OS_MED_PRIO, TCB_NULL_ENV, idle_task);
+        os_delay(handle[i], 1 + rnd() % 1000);
+    }
+    for (s = 0; s < n_samples; s++)
+    {
+        os_timerHook();
+        t0 = now();
+        service_os_timers();
+        take((double)(now() - t0));
+        for (i = 0; i < n; i++)
+        {
+            if (TCB_READY == (handle[i]->flags & TCB_READY))
+            {
+                os_delay(handle[i], 1 + rnd() % 1000);
+            }
+        }
+    }
+    report_n("timers", n, "ns");
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	bench_sem_wake
+ *
+ *  DESCRIPTION:	a task signals, and the one waiting at a higher
+ *					priority takes the time it runs
+ *
+ *******************************************************************/
+
+static int
+sem_waiter( tcb_pt_t *pt )
+{
+    PT_BEGIN(pt);
+    FOREVER
+    {
+        os_sem_wait(pt, sem, NO_TIMEOUT);
+        take((double)(now() - t_mark));
+        if (taken == n_samples)
+        {
+            longjmp(done, 1);
+        }
+    }
+    PT_END(pt);
+}
+
+static int
+sem_signaller( tcb_pt_t *pt )
+{
+    (void)pt;
+    t_mark = now();
+    os_sem_signal(&sem);
+    return (PT_YIELDED);
+}
+
+static void
+bench_sem_wake( void )
+{
+    start();
+    os_sem_init(&sem);
+    os_resume_task(os_create_task(1, TCB_NULL_ENV, sem_waiter));
+    os_resume_task(os_create_task(2, TCB_NULL_ENV, sem_signaller));
+    if (0 == setjmp(done))
+    {
+        os_start_sched();
+    }
+    report("sem_wake", "-", "ns");
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	bench_inversion
+ *
+ *  DESCRIPTION:	the low task takes the lock, wakes the high and
+ *					middle tasks, and holds the lock for a few yields.
+ *					The high task times its wait for the lock. With a
+ *					semaphore the middle task's burst runs first; a
+ *					mutex lends the low task the high one's priority.
+ *
+ *******************************************************************/
+
+static int
+inv_low_task( tcb_pt_t *pt )
+{
+    PT_BEGIN(pt);
+    FOREVER
+    {
+        if (use_mutex)
+        {
+            os_mutex_lock(pt, mtx, NO_TIMEOUT);
+        }
+        else
+        {
+            os_sem_wait(pt, sem, NO_TIMEOUT);
+        }
+        os_resume_task(inv_high);
+        os_resume_task(inv_mid);
+        for (inv_i = 0; inv_i < INV_HOLD; inv_i++)
+        {
+            PT_YIELD(pt);
+        }
+        if (use_mutex)
+        {
+            os_mutex_unlock(&mtx);
+        }
+        else
+        {
+            os_sem_signal(&sem);
+        }
+        PT_YIELD(pt);
+    }
+    PT_END(pt);
+}
+
+static int
+inv_mid_task( tcb_pt_t *pt )
+{
+    PT_BEGIN(pt);
+    FOREVER
+    {
+        for (count = 0; count < INV_BURST; count++)
+        {
+            PT_YIELD(pt);
+        }
+        os_suspend_task(&park, (k_list_t *)ME);
+        PT_YIELD(pt);
+    }
+    PT_END(pt);
+}
+
+static int
+inv_high_task( tcb_pt_t *pt )
+{
+    PT_BEGIN(pt);
+    FOREVER
+    {
+        t_mark = now();
+        if (use_mutex)
+        {
+            os_mutex_lock(pt, mtx, NO_TIMEOUT);
+        }
+        else
+        {
+            os_sem_wait(pt, sem, NO_TIMEOUT);
+        }
+        take((double)(now() - t_mark));
+        if (use_mutex)
+        {
+            os_mutex_unlock(&mtx);
+        }
+        else
+        {
+            os_sem_signal(&sem);
+        }
+        if (taken == n_samples)
+        {
+            longjmp(done, 1);
+        }
+        os_suspend_task(&park, (k_list_t *)ME);
+        PT_YIELD(pt);
+    }
+    PT_END(pt);
+}
+
+static void
+bench_inversion( int mutex )
+{
+    start();
+    use_mutex = mutex;
+    os_sem_init(&sem);
+    os_sem_signal(&sem);
+    os_mutex_init(&mtx);
+    inv_high = os_create_task(1, TCB_NULL_ENV, inv_high_task);
+    inv_mid  = os_create_task(5, TCB_NULL_ENV, inv_mid_task);
+    os_resume_task(os_create_task(10, TCB_NULL_ENV, inv_low_task));
+    if (0 == setjmp(done))
+    {
+        os_start_sched();
+    }
+    report("inversion", mutex ? "mutex" : "sem", "ns");
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	bench_rr
+ *
+ *  DESCRIPTION:	equal priority tasks yield. Batches of dispatches
+ *					are timed, and the dispatches each task got, and
+ *					their fairness, are reported after.
+ *
+ *******************************************************************/
+
+static int
+rr_task( tcb_pt_t *pt )
+{
+    uint64_t	t;
+
+    rr_count[gettask_env(ME)]++;
+    if (0 == (++count % BATCH))
+    {
+        t = now();
+        take((double)(t - t_mark) / BATCH);
+        t_mark = t;
+        if (taken == n_samples)
+        {
+            longjmp(done, 1);
+        }
+    }
+    (void)pt;
+    return (PT_YIELDED);
+}
+
+static void
+bench_rr( void )
+{
+    double		sum;
+    double		sq;
+    uint32_t	i;
+
+    start();
+    for (i = 0; i < RR_TASKS; i++)
+    {
+        rr_count[i] = 0;
+        os_resume_task(os_create_task(3, (uint8_t)i, rr_task));
+    }
+    count  = 0;
+    t_mark = now();
+    if (0 == setjmp(done))
+    {
+        os_start_sched();
+    }
+    report_n("rr_dispatch", RR_TASKS, "ns");
+    sum = 0;
+    sq  = 0;
+    for (i = 0; i < RR_TASKS; i++)
+    {
+        take(rr_count[i]);
+        sum += rr_count[i];
+        sq  += (double)rr_count[i] * rr_count[i];
+    }
+    report_n("rr_share", RR_TASKS, "dispatches");
+    take((sum * sum) / (RR_TASKS * sq));
+    report_n("rr_jain", RR_TASKS, "index");
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	bench_que
+ *
+ *  DESCRIPTION:	byte at a time, and bulk, queue throughput
+ *
+ *******************************************************************/
+
+static void
+bench_que( int bulk )
+{
+    static q_type_t	buffer[QUE_SIZE];
+    os_queue_t		q;
+    q_type_t		data[BULK];
+    q_type_t		c = 0;
+    uint64_t		t0;
+    uint32_t		i;
+    uint32_t		j;
+    uint32_t		s;
+
+    os_que_init(&q, QUE_SIZE, buffer);
+    memset(data, 0x55, sizeof(data));
+    for (s = 0; s < n_samples; s++)
+    {
+        t0 = now();
+        for (i = 0; i < BATCH; i++)
+        {
+            if (bulk)
+            {
+                os_que_putarray(&q, data, BULK);
+                for (j = 0; j < BULK; j++)
+                {
+                    os_que_remove(&q, &c);
+                }
+            }
+            else
+            {
+                os_que_add(&q, &c);
+                os_que_remove(&q, &c);
+            }
+        }
+        take((double)(now() - t0) / (BATCH * (bulk ? BULK : 1)));
+    }
+    report(bulk ? "que_bulk" : "que_byte", bulk ? "64" : "1", "ns/byte");
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	bench_que_copy
+ *
+ *  DESCRIPTION:	queue throughput of blocks copied in and out,
+ *					by os_que_write() and os_que_read(), or by hand
+ *					into and out of the spans. The spans are taken
+ *					again when a block wraps.
+ *
+ *******************************************************************/
+
+static void
+bench_que_copy( int span )
+{
+    static q_type_t	buffer[QUE_SIZE];
+    os_queue_t		q;
+    q_type_t		data[BULK];
+    q_type_t		*p;
+    uint64_t		t0;
+    uint32_t		i;
+    uint32_t		s;
+    q_size_t		n;
+    q_size_t		done_n;
+
+    os_que_init(&q, QUE_SIZE, buffer);
+    memset(data, 0x55, sizeof(data));
+    for (s = 0; s < n_samples; s++)
+    {
+        t0 = now();
+        for (i = 0; i < BATCH; i++)
+        {
+            if (span)
+            {
+                for (done_n = 0; done_n < BULK; done_n += n)
+                {
+                    n = os_que_reserve(&q, &p);
+                    n = (n > BULK - done_n) ? (q_size_t)(BULK - done_n) : n;
+                    memcpy(p, data + done_n, n * sizeof(q_type_t));
+                    os_que_commit(&q, n);
+                }
+                for (done_n = 0; done_n < BULK; done_n += n)
+                {
+                    n = os_que_peek_span(&q, &p);
+                    memcpy(data + done_n, p, n * sizeof(q_type_t));
+                    os_que_consume(&q, n);
+                }
+            }
+            else
+            {
+                os_que_write(&q, data, BULK);
+                os_que_read(&q, data, BULK);
+            }
+        }
+        take((double)(now() - t0) / (BATCH * BULK));
+    }
+    report(span ? "que_span" : "que_write", "64", "ns/byte");
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	bench_ring
+ *
+ *  DESCRIPTION:	byte at a time, and bulk, throughput of the lock
+ *					free ring, as bench_que() has the queue's
+ *
+ *******************************************************************/
+
+static void
+bench_ring( int bulk )
+{
+    static q_type_t	buffer[QUE_SIZE];
+    os_ring_t		r;
+    q_type_t		data[BULK];
+    q_type_t		c = 0;
+    uint64_t		t0;
+    uint32_t		i;
+    uint32_t		s;
+
+    os_ring_init(&r, QUE_SIZE, buffer);
+    memset(data, 0x55, sizeof(data));
+    for (s = 0; s < n_samples; s++)
+    {
+        t0 = now();
+        for (i = 0; i < BATCH; i++)
+        {
+            if (bulk)
+            {
+                os_ring_write(&r, data, BULK);
+                os_ring_read(&r, data, BULK);
+            }
+            else
+            {
+                os_ring_put(&r, &c);
+                os_ring_get(&r, &c);
+            }
+        }
+        take((double)(now() - t0) / (BATCH * (bulk ? BULK : 1)));
+    }
+    report(bulk ? "ring_write" : "ring_byte", bulk ? "64" : "1", "ns/byte");
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	bench_xfer
+ *
+ *  DESCRIPTION:	bytes streamed from a producer thread to this one,
+ *					through the lock free ring, or through the queue
+ *					with a mutex, as a queue shared by two threads
+ *					needs. An end that finds the ring full or empty
+ *					yields, so on a host of one core the figures
+ *					include the thread switches.
+ *
+ *******************************************************************/
+
+static os_ring_t		xfer_ring;
+static os_queue_t		xfer_que;
+static pthread_mutex_t	xfer_lock = PTHREAD_MUTEX_INITIALIZER;
+static volatile int		xfer_stop;
+
+static void *
+xfer_producer( void *arg )
+{
+    q_type_t	data[BULK];
+    q_type_t	c = 0;
+    int			mode = *(int *)arg;
+    uint8_t		r;
+
+    memset(data, 0x55, sizeof(data));
+    while (!xfer_stop)
+    {
+        if (2 == mode)
+        {
+            pthread_mutex_lock(&xfer_lock);
+            r = os_que_add(&xfer_que, &c);
+            pthread_mutex_unlock(&xfer_lock);
+        }
+        else if (1 == mode)
+        {
+            r = (0 == os_ring_write(&xfer_ring, data, BULK)) ? Q_FULL : Q_SUCCESS;
+        }
+        else
+        {
+            r = os_ring_put(&xfer_ring, &c);
+        }
+        if (Q_SUCCESS != r)
+        {
+            sched_yield();
+        }
+    }
+    return (NULL);
+}
+
+static void
+bench_xfer( int mode )
+{
+    static q_type_t	buffer[QUE_SIZE];
+    pthread_t		producer;
+    q_type_t		data[BULK];
+    q_type_t		c;
+    uint64_t		t0;
+    uint32_t		got;
+    uint32_t		n;
+    uint32_t		s;
+    uint8_t			r;
+
+    os_ring_init(&xfer_ring, QUE_SIZE, buffer);
+    os_que_init(&xfer_que, QUE_SIZE, buffer);
+    xfer_stop = 0;
+    if (0 != pthread_create(&producer, NULL, xfer_producer, &mode))
+    {
+        return;
+    }
+    for (s = 0; s < n_samples; s++)
+    {
+        t0 = now();
+        for (got = 0; got < XFER; got += n)
+        {
+            if (2 == mode)
+            {
+                pthread_mutex_lock(&xfer_lock);
+                r = os_que_remove(&xfer_que, &c);
+                pthread_mutex_unlock(&xfer_lock);
+                n = (Q_SUCCESS == r);
+            }
+            else if (1 == mode)
+            {
+                n = os_ring_read(&xfer_ring, data, BULK);
+            }
+            else
+            {
+                n = (Q_SUCCESS == os_ring_get(&xfer_ring, &c));
+            }
+            if (0 == n)
+            {
+                sched_yield();
+            }
+        }
+        take((double)(now() - t0) / got);
+    }
+    xfer_stop = 1;
+    pthread_join(producer, NULL);
+    report((2 == mode) ? "que_xfer" : "ring_xfer", (1 == mode) ? "64" : "1", "ns/byte");
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	bench_mbox
+ *
+ *  DESCRIPTION:	a task sends, and the receiver waiting at a higher
+ *					priority takes the time it has the message
+ *
+ *******************************************************************/
+
+static int
+mbox_receiver( tcb_pt_t *pt )
+{
+    static os_msg_t	*got;
+
+    PT_BEGIN(pt);
+    FOREVER
+    {
+        os_msg_receive(pt, &mbox, got, NO_TIMEOUT);
+        if ((os_msg_t *)0 != got)
+        {
+            take((double)(now() - t_mark));
+        }
+        if (taken == n_samples)
+        {
+            longjmp(done, 1);
+        }
+    }
+    PT_END(pt);
+}
+
+static int
+mbox_sender( tcb_pt_t *pt )
+{
+    (void)pt;
+    os_msg_init(&msg);
+    t_mark = now();
+    os_msg_send(&msg, &mbox);
+    return (PT_YIELDED);
+}
+
+static void
+bench_mbox( void )
+{
+    start();
+    os_mbox_init(&mbox);
+    os_resume_task(os_create_task(1, TCB_NULL_ENV, mbox_receiver));
+    os_resume_task(os_create_task(2, TCB_NULL_ENV, mbox_sender));
+    if (0 == setjmp(done))
+    {
+        os_start_sched();
+    }
+    report("mbox", "-", "ns");
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	bench_rpc
+ *
+ *  DESCRIPTION:	a client sends a request from a message pool, and
+ *					waits for the reply; a server at the same priority
+ *					answers in the buffer it was sent. Batches of round
+ *					trips are timed.
+ *
+ *******************************************************************/
+
+static int
+rpc_server( tcb_pt_t *pt )
+{
+    static os_msg_t	*req;
+
+    PT_BEGIN(pt);
+    FOREVER
+    {
+        os_msg_receive(pt, &mbox, req, NO_TIMEOUT);
+        req->message[0]++;
+        os_msg_reply(req);
+    }
+    PT_END(pt);
+}
+
+static int
+rpc_client( tcb_pt_t *pt )
+{
+    static os_msg_t	*req;
+    uint64_t		t;
+
+    PT_BEGIN(pt);
+    FOREVER
+    {
+        req = os_msg_alloc(&rpc_pool);
+        req->message[0] = 0;
+        req->length     = 1;
+        os_msg_request(req, &mbox, &rpc_reply);
+        os_msg_receive(pt, &rpc_reply, req, NO_TIMEOUT);
+        os_msg_free(req);
+        if (0 == (++count % BATCH))
+        {
+            t = now();
+            take((double)(t - t_mark) / BATCH);
+            t_mark = t;
+            if (taken == n_samples)
+            {
+                longjmp(done, 1);
+            }
+        }
+    }
+    PT_END(pt);
+}
+
+static void
+bench_rpc( void )
+{
+    start();
+    os_mbox_init(&mbox);
+    os_mbox_init(&rpc_reply);
+    os_msg_pool_init(&rpc_pool, rpc_msgs, rpc_data, RPC_MSGS, RPC_SIZE);
+    os_resume_task(os_create_task(2, TCB_NULL_ENV, rpc_server));
+    os_resume_task(os_create_task(2, TCB_NULL_ENV, rpc_client));
+    count  = 0;
+    t_mark = now();
+    if (0 == setjmp(done))
+    {
+        os_start_sched();
+    }
+    report("msg_rpc", "-", "ns");
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	bench_pool
+ *
+ *  DESCRIPTION:	an allocation and a free, per pair, with half the
+ *					pool in use
+ *
+ *******************************************************************/
+
+static void
+bench_pool( void )
+{
+    void		*blk[BULK / 2];
+    uint64_t	t0;
+    uint32_t	i;
+    uint32_t	s;
+
+    for (i = 0; i < BULK / 2; i++)
+    {
+        blk[i] = os_pool_alloc(&blk_pool);
+    }
+    for (s = 0; s < n_samples; s++)
+    {
+        t0 = now();
+        for (i = 0; i < BATCH; i++)
+        {
+            os_pool_free(&blk_pool, blk[i % (BULK / 2)]);
+            blk[i % (BULK / 2)] = os_pool_alloc(&blk_pool);
+        }
+        take((double)(now() - t0) / BATCH);
+    }
+    for (i = 0; i < BULK / 2; i++)
+    {
+        os_pool_free(&blk_pool, blk[i]);
+    }
+    report("pool", "64", "ns");
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	bench_fletcher
+ *
+ *******************************************************************/
+
+static void
+bench_fletcher( uint16_t len )
+{
+    static uint8_t		block[1024];
+    uint64_t			t0;
+    uint32_t			i;
+    uint32_t			s;
+
+    for (i = 0; i < sizeof(block); i++)
+    {
+        block[i] = (uint8_t)rnd();
+    }
+    for (s = 0; s < n_samples; s++)
+    {
+        t0 = now();
+        for (i = 0; i < BATCH / 16; i++)
+        {
+            check = calc_fletcher16(block, len);
+        }
+        take((double)(now() - t0) / ((BATCH / 16) * len));
+    }
+    report_n("fletcher16", len, "ns/byte");
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	main
+ *
+ *  DESCRIPTION:	run the benchmarks asked for
+ *
+ *  INPUT:			command line
+ *
+ *  OUTPUT:			exit status
+ *
+ *******************************************************************/
+
+static int
+want( const char *bench )
+{
+    return ((NULL == only) || (0 == strcmp(only, bench)));
+}
+
+int
+main( int argc, char **argv )
+{
+    static const uint32_t	ready[] = { 8, 64, 1024 };
+    static const uint32_t	tasks[] = { 16, 256, 4096 };
+    uint32_t				i;
+    int						opt;
+
+    while (-1 != (opt = getopt(argc, argv, "f:b:n:")))
+    {
+        switch (opt)
+        {
+            case 'f': csv       = (0 == strcmp(optarg, "csv"));            break;
+            case 'b': only      = optarg;                                 break;
+            case 'n': n_samples = (uint32_t)strtoul(optarg, NULL, 0);     break;
+            default:
+                fprintf(stderr, "usage: %s [-f json|csv] [-b bench] [-n samples]\n", argv[0]);
+                return (1);
+        }
+    }
+    if ((n_samples < 1) || (n_samples > MAX_SAMPLES))
+    {
+        fprintf(stderr, "samples must be 1 to %d\n", MAX_SAMPLES);
+        return (1);
+    }
+    if (csv)
+    {
+        printf("bench,param,unit,samples,mean,p50,p90,p99,max\n");
+    }
+    else
+    {
+        printf("{\"config\":{\"N_TASKS\":%u,\"OS_N_PRIO\":%u,\"OS_TMR_SLOTS\":%u,"
+               "\"PICO_RR\":%u,\"OS_RR_QUANTUM\":%u,\"samples\":%u},\n \"results\":[",
+               N_TASKS, OS_N_PRIO, OS_TMR_SLOTS, PICO_RR, OS_RR_QUANTUM, n_samples);
+    }
+    if (want("clock"))
+    {
+        bench_clock();
+    }
+    for (i = 0; i < sizeof(ready) / sizeof(ready[0]); i++)
+    {
+        if (ready[i] > N_TASKS - 1)
+        {
+            break;
+        }
+        if (want("dispatch"))
+        {
+            bench_dispatch(ready[i]);
+        }
+        if (want("resume"))
+        {
+            bench_resume(ready[i]);
+        }
+    }
+    for (i = 0; i < sizeof(tasks) / sizeof(tasks[0]); i++)
+    {
+        if ((tasks[i] <= N_TASKS) && want("timers"))
+        {
+            bench_timers(tasks[i]);
+        }
+    }
+    if (want("sem_wake"))
+    {
+        bench_sem_wake();
+    }
+    if (want("inversion"))
+    {
+        bench_inversion(0);
+        bench_inversion(1);
+    }
+    if (want("rr"))
+    {
+        bench_rr();
+    }
+    if (want("que_byte"))
+    {
+        bench_que(0);
+    }
+    if (want("que_bulk"))
+    {
+        bench_que(1);
+    }
+    if (want("que_write"))
+    {
+        bench_que_copy(0);
+    }
+    if (want("que_span"))
+    {
+        bench_que_copy(1);
+    }
+    if (want("ring_byte"))
+    {
+        bench_ring(0);
+    }
+    if (want("ring_write"))
+    {
+        bench_ring(1);
+    }
+    if (want("ring_xfer"))
+    {
+        bench_xfer(0);
+        bench_xfer(1);
+    }
+    if (want("que_xfer"))
+    {
+        bench_xfer(2);
+    }
+    if (want("mbox"))
+    {
+        bench_mbox();
+    }
+    if (want("msg_rpc"))
+    {
+        bench_rpc();
+    }
+    if (want("pool"))
+    {
+        bench_pool();
+    }
+    if (want("fletcher16"))
+    {
+        bench_fletcher(64);
+        bench_fletcher(1024);
+    }
+    if (!csv)
+    {
+        printf("\n ]}\n");
+    }
+    return (0);
+}
+
+/*
+ *  END OF kbench.c
+ *
+ *******************************************************************/
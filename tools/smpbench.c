@@ -0,0 +1,271 @@
+/********************************************************************
+ *
+ *  DESC
+ *
+ *  MODULE NAME:        smpbench.c
+ *
+ *  AUTHOR:        		Dave Sandler
+ *
+ *  DESCRIPTION:        Scaling benchmark for the PICO_SMP scheduler on a
+ *						Linux host. For each core count from 1 up, a
+ *						fresh kernel runs a set of protothreads that do a
+ *						fixed amount of work per dispatch and yield. After
+ *						the run time, the dispatches are counted and one
+ *						CSV row is printed per core count, with the
+ *						speedup over one core.
+ *
+ *						Tasks are spread over the cores as they're
+ *						created; idle cores steal. Each core count runs in
+ *						its own process, since the scheduler loops never
+ *						return.
+ *
+ *						cc -std=gnu99 -O2 -DLINUX -DPICO_SMP=1 -DPICO_RR=1
+ *						   -DOS_N_CORES=16 -DN_TASKS=250 -Iinclude
+ *						   -Isource/portable/Linux -o smpbench
+ *						   tools/smpbench.c source/pico.c source/picosem.c
+ *						   source/picomsg.c source/portable/portable.c
+ *						   -lpthread
+ *						./smpbench [-c cores] [-n tasks] [-w work] [-t ms]
+ *
+ *  EDIT HISTORY:
+ *  BASELINE
+ *  VERSION     INIT    DESCRIPTION OF CHANGE
+ *  --------    ----    ----------------------
+ *   10-18-26   DS  	Module creation.
+ *
+ *  Copyright (c) 2009 - 2021 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ********************************************************************/
+
+/*
+ *********************************************************************
+ *
+ *   System Includes
+ */
+#include	"pico.h"
+#include	<stdlib.h>
+#include	<sys/wait.h>
+
+/*
+ *********************************************************************
+ *
+ *   Constants
+ */
+#if (!PICO_SMP)
+	#error smpbench needs PICO_SMP
+#endif
+
+typedef struct
+{
+    volatile uint64_t	count;
+    uint8_t				pad[64 - sizeof(uint64_t)];	/* a cache line per core */
+} core_count_t;
+
+/*
+ *********************************************************************
+ *
+ *   Module Data
+ */
+static core_count_t		dispatches[OS_N_CORES];
+static uint32_t			work   = 200;
+static uint32_t			run_ms = 500;
+static struct timespec	started;
+static int				result_fd;
+static t_hook_entry_t	timeout_hook;
+static volatile uint32_t sink;
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	worker
+ *
+ *  DESCRIPTION:	one benchmark task. It does its work, counts the
+ *					dispatch against the core it ran on, and yields.
+ *
+ *******************************************************************/
+
+static int
+worker( tcb_pt_t *pt )
+{
+    uint32_t x = (uint32_t)(uintptr_t)pt | 1;
+    uint32_t i;
+
+    for (i = 0; i < work; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+    }
+    sink = x;
+    dispatches[os_core_id()].count++;
+    return (PT_YIELDED);
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	timeout
+ *
+ *  DESCRIPTION:	scheduler hook on core 0. Once the run time is up,
+ *					the total dispatches go back to the parent and the
+ *					process ends, taking the other cores with it.
+ *
+ *******************************************************************/
+
+static void
+timeout( void )
+{
+    struct timespec	now;
+    uint64_t		total = 0;
+    uint8_t			core;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (((now.tv_sec - started.tv_sec) * 1000 +
+         (now.tv_nsec - started.tv_nsec) / 1000000) < (long)run_ms)
+    {
+        return;
+    }
+    for (core = 0; core < os_n_cores; core++)
+    {
+        total += dispatches[core].count;
+    }
+    if (sizeof(total) != write(result_fd, &total, sizeof(total)))
+    {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	run
+ *
+ *  DESCRIPTION:	run the kernel on the given number of cores, in a
+ *					child process.
+ *
+ *  INPUT:			cores, tasks
+ *
+ *  OUTPUT:			dispatches counted; 0 on failure
+ *
+ *******************************************************************/
+
+static uint64_t
+run( uint8_t cores, uint32_t tasks )
+{
+    uint64_t	total = 0;
+    int			fds[2];
+    int			status;
+    pid_t		pid;
+    uint32_t	n;
+
+    if (0 != pipe(fds))
+    {
+        return (0);
+    }
+    pid = fork();
+    if (0 == pid)
+    {
+        close(fds[0]);
+        result_fd  = fds[1];
+        os_n_cores = cores;
+        os_init();
+        for (n = 0; n < tasks; n++)
+        {
+            os_resume_task(os_create_task((uint8_t)(n % OS_N_PRIO), 0, worker));
+        }
+        os_add_schedhook(&timeout_hook, timeout);
+        clock_gettime(CLOCK_MONOTONIC, &started);
+        os_start_sched();
+        _exit(1);
+    }
+    close(fds[1]);
+    if (pid > 0)
+    {
+        if (sizeof(total) != read(fds[0], &total, sizeof(total)))
+        {
+            total = 0;
+        }
+        waitpid(pid, &status, 0);
+    }
+    close(fds[0]);
+    return (total);
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	main
+ *
+ *  DESCRIPTION:	print one CSV row per core count.
+ *
+ *  INPUT:			command line
+ *
+ *  OUTPUT:			exit status
+ *
+ *******************************************************************/
+
+int
+main( int argc, char **argv )
+{
+    uint32_t	max_cores = OS_N_CORES;
+    uint32_t	tasks     = N_TASKS;
+    uint32_t	cores;
+    uint64_t	total;
+    double		base = 0.0;
+    double		rate;
+    int			opt;
+
+    while (-1 != (opt = getopt(argc, argv, "c:n:w:t:")))
+    {
+        switch (opt)
+        {
+            case 'c': max_cores = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'n': tasks     = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'w': work      = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 't': run_ms    = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-c cores] [-n tasks] [-w work] [-t ms]\n", argv[0]);
+                return (1);
+        }
+    }
+    if ((max_cores < 1) || (max_cores > OS_N_CORES) || (tasks < 1) || (tasks > N_TASKS))
+    {
+        fprintf(stderr, "cores must be 1 to %d, tasks 1 to %d\n", OS_N_CORES, N_TASKS);
+        return (1);
+    }
+    printf("cores,tasks,work,ms,dispatches,dispatches_per_sec,speedup\n");
+    for (cores = 1; cores <= max_cores; cores++)
+    {
+        total = run((uint8_t)cores, tasks);
+        rate  = (double)total * 1000.0 / (double)run_ms;
+        if (1 == cores)
+        {
+            base = rate;
+        }
+        printf("%u,%u,%u,%u,%llu,%.0f,%.2f\n", cores, tasks, work, run_ms,
+               (unsigned long long)total, rate, (base > 0.0) ? rate / base : 0.0);
+        fflush(stdout);
+    }
+    return (0);
+}
+
+/*
+ *  END OF smpbench.c
+ *
+ *******************************************************************/
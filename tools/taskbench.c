@@ -0,0 +1,281 @@
+/********************************************************************
+ *
+ *  DESC
+ *
+ *  MODULE NAME:        taskbench.c
+ *
+ *  AUTHOR:        		Dave Sandler
+ *
+ *  DESCRIPTION:        Task table scaling on a Linux host. The table is
+ *						filled to a number of tasks, then tasks are killed
+ *						and spawned at random slots, each kill returning
+ *						its tcb with os_release_tcb() and each spawn
+ *						taking one with os_create_task() and making it
+ *						ready. A probe task is then looked up by function
+ *						with os_get_task_handle(). The cost of a kill and
+ *						spawn pair, and of a lookup, is printed as CSV for
+ *						1k and 16k tasks.
+ *
+ *						Build with OS_TASK_HASH=0 to time the scan of
+ *						tcb[] that lookups fall back to.
+ *
+ *						cc -std=gnu99 -O2 -DLINUX -DN_TASKS=16384 -Iinclude
+ *						   -Isource/portable/Linux -o taskbench
+ *						   tools/taskbench.c source/pico.c source/picosem.c
+ *						   source/picomsg.c source/portable/portable.c
+ *						./taskbench [-i iterations]
+ *
+ *  EDIT HISTORY:
+ *  BASELINE
+ *  VERSION     INIT    DESCRIPTION OF CHANGE
+ *  --------    ----    ----------------------
+ *   10-18-26   DS  	Module creation.
+ *
+ *  Copyright (c) 2009 - 2021 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ********************************************************************/
+
+/*
+ *********************************************************************
+ *
+ *   System Includes
+ */
+#include	"pico.h"
+#include	<stdlib.h>
+
+/*
+ *********************************************************************
+ *
+ *   Constants
+ */
+#define	N_FNS			16
+
+static const uint32_t	sizes[] = { 1024, 16384 };
+
+/*
+ *********************************************************************
+ *
+ *   Module Data
+ */
+static tcb_entry_t		*handle[N_TASKS];
+static uint32_t			seed = 1;
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	worker_n, probe
+ *
+ *  DESCRIPTION:	task functions. The tasks are never run; the workers
+ *					are spread over N_FNS functions so that handles are
+ *					looked up among tasks that share them, and the probe
+ *					is the one task looked up.
+ *
+ *******************************************************************/
+
+#define WORKER_FN(i)															\
+    static int worker_##i( tcb_pt_t *pt ) { (void)pt; return (PT_ENDED); }
+WORKER_FN(0) WORKER_FN(1) WORKER_FN(2) WORKER_FN(3) WORKER_FN(4) WORKER_FN(5) WORKER_FN(6) WORKER_FN(7)
+WORKER_FN(8) WORKER_FN(9) WORKER_FN(10) WORKER_FN(11) WORKER_FN(12) WORKER_FN(13) WORKER_FN(14) WORKER_FN(15)
+
+static int ( * const worker_fn[N_FNS] )( tcb_pt_t * ) =
+{
+    worker_0, worker_1, worker_2, worker_3, worker_4, worker_5, worker_6, worker_7,
+    worker_8, worker_9, worker_10, worker_11, worker_12, worker_13, worker_14, worker_15
+};
+
+static int
+probe( tcb_pt_t *pt )
+{
+    (void)pt;
+    return (PT_ENDED);
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	rnd
+ *
+ *  DESCRIPTION:	xorshift, to pick the slot to churn
+ *
+ *  INPUT:			none
+ *
+ *  OUTPUT:			next random number
+ *
+ *******************************************************************/
+
+static uint32_t
+rnd( void )
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return (seed);
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	spawn
+ *
+ *  DESCRIPTION:	create the task for a slot and make it ready
+ *
+ *  INPUT:			slot
+ *
+ *  OUTPUT:			the task's handle
+ *
+ *******************************************************************/
+
+static tcb_entry_t *
+spawn( uint32_t slot )
+{
+    tcb_entry_t	*t;
+
+    t = os_create_task((uint8_t)(slot % OS_N_PRIO), TCB_NULL_ENV, worker_fn[slot % N_FNS]);
+    if ((tcb_entry_t *)Q_NULL == t)
+    {
+        fprintf(stderr, "task table full at %u\n", slot);
+        exit(1);
+    }
+    os_resume_task(t);
+    return (t);
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	elapsed
+ *
+ *  DESCRIPTION:	nanoseconds between two clock readings
+ *
+ *******************************************************************/
+
+static double
+elapsed( struct timespec *t0, struct timespec *t1 )
+{
+    return ((double)(t1->tv_sec - t0->tv_sec) * 1e9 + (double)(t1->tv_nsec - t0->tv_nsec));
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	run
+ *
+ *  DESCRIPTION:	fill the table, churn it, and look up the probe.
+ *					One CSV row is printed.
+ *
+ *  INPUT:			tasks; churn iterations
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+static void
+run( uint32_t n, uint32_t iter )
+{
+    struct timespec	t0;
+    struct timespec	t1;
+    tcb_entry_t		*found = (tcb_entry_t *)Q_NULL;
+    double			ns_churn;
+    double			ns_look;
+    uint32_t		i;
+    uint32_t		slot;
+
+    os_init();
+    /*
+     * one slot is left for the probe
+     */
+    for (i = 0; i < n - 1; i++)
+    {
+        handle[i] = spawn(i);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < iter; i++)
+    {
+        slot = rnd() % (n - 1);
+        os_release_tcb(handle[slot]);
+        handle[slot] = spawn(slot);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns_churn = elapsed(&t0, &t1) / iter;
+
+    os_resume_task(os_create_task(OS_LO_PRIO, TCB_NULL_ENV, probe));
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < iter; i++)
+    {
+        found = os_get_task_handle(probe);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns_look = elapsed(&t0, &t1) / iter;
+    if (((tcb_entry_t *)Q_NULL == found) || (found->p_thread != probe))
+    {
+        fprintf(stderr, "probe not found\n");
+        exit(1);
+    }
+    printf("%u,%u,%u,%.1f,%.1f\n", n, OS_TASK_HASH, iter, ns_churn, ns_look);
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	main
+ *
+ *  DESCRIPTION:	time each table size that fits in N_TASKS
+ *
+ *  INPUT:			command line
+ *
+ *  OUTPUT:			exit status
+ *
+ *******************************************************************/
+
+int
+main( int argc, char **argv )
+{
+    uint32_t	iter = 1000000;
+    uint32_t	i;
+    int			opt;
+
+    while (-1 != (opt = getopt(argc, argv, "i:")))
+    {
+        switch (opt)
+        {
+            case 'i': iter = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-i iterations]\n", argv[0]);
+                return (1);
+        }
+    }
+    if (0 == iter)
+    {
+        fprintf(stderr, "iterations must be at least 1\n");
+        return (1);
+    }
+    printf("tasks,hash_buckets,iterations,spawn_kill_ns,lookup_ns\n");
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        if (sizes[i] <= N_TASKS)
+        {
+            run(sizes[i], iter);
+        }
+    }
+    return (0);
+}
+
+/*
+ *  END OF taskbench.c
+ *
+ *******************************************************************/
@@ -0,0 +1,421 @@
+/********************************************************************
+ *
+ *  DESC
+ *
+ *  MODULE NAME:        trace2json.c
+ *
+ *  AUTHOR:        		Dave Sandler
+ *
+ *  DESCRIPTION:        Decode the binary event trace that os_trace_dump()
+ *						drains from the target into Chrome trace JSON, for
+ *						chrome://tracing or ui.perfetto.dev. Dumps may be
+ *						captured back to back into one file.
+ *
+ *						Each core is a thread. Tasks and hooks become
+ *						slices from dispatch to return, and entry to exit;
+ *						the other events are instants. Given a symbol map
+ *						from nm, task and hook functions are named.
+ *						Timestamps are unwrapped from the 32 bit
+ *						os_cycle_count(), so the gap between records must
+ *						stay under a wrap of the counter.
+ *
+ *						cc -std=gnu99 -O2 -DLINUX -Iinclude
+ *						   -Isource/portable/Linux -o trace2json
+ *						   tools/trace2json.c
+ *						nm firmware.elf > firmware.map
+ *						./trace2json [-m firmware.map] trace.bin > trace.json
+ *
+ *  EDIT HISTORY:
+ *  BASELINE
+ *  VERSION     INIT    DESCRIPTION OF CHANGE
+ *  --------    ----    ----------------------
+ *   10-18-26   DS  	Module creation.
+ *   10-18-26   DS  	isr events.
+ *
+ *  Copyright (c) 2009 - 2021 Dave Sandler
+ *
+ *  This file is part of pico.
+ *
+ *  pico is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  pico is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with pico.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ********************************************************************/
+
+/*
+ *********************************************************************
+ *
+ *   System Includes
+ */
+#include	"picotrace.h"
+#include	<stdlib.h>
+#include	<string.h>
+
+/*
+ *********************************************************************
+ *
+ *   Constants
+ */
+#define	MAX_CORES		32
+#define	MAX_DEPTH		8
+#define	REC_MIN			12		/* bytes of a version 1 record			*/
+
+/*
+ *********************************************************************
+ *
+ *   Module Data
+ */
+typedef struct
+{
+    uint32_t	addr;
+    char		*name;
+} sym_t;
+
+static sym_t	*syms;
+static size_t	n_syms;
+static uint8_t	open_ev[MAX_CORES][MAX_DEPTH];	/* slices open per core, by event */
+static uint8_t	depth[MAX_CORES];
+static uint32_t	cores_seen;
+static double	last_us;
+static int		first = 1;
+
+static const char * const ev_name[] =
+{
+    "reset", "dispatch", "return", "resume", "suspend", "timer",
+    "sem_signal", "msg_send", "que_write", "que_read",
+    "hook_enter", "hook_exit", "sleep", "wake", "isr"
+};
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	sym_cmp, load_syms, sym_name
+ *
+ *  DESCRIPTION:	a sorted table of text symbols from nm output, and
+ *					an exact lookup by the low 32 bits of an address.
+ *
+ *******************************************************************/
+
+static int
+sym_cmp( const void *a, const void *b )
+{
+    uint32_t x = ((const sym_t *)a)->addr;
+    uint32_t y = ((const sym_t *)b)->addr;
+
+    return ((x > y) - (x < y));
+}
+
+static void
+load_syms( const char *path )
+{
+    FILE				*f = fopen(path, "r");
+    char				line[512];
+    char				name[400];
+    unsigned long long	addr;
+    char				type;
+    size_t				room = 0;
+
+    if (NULL == f)
+    {
+        perror(path);
+        exit(1);
+    }
+    while (NULL != fgets(line, sizeof(line), f))
+    {
+        if ((3 != sscanf(line, "%llx %c %399s", &addr, &type, name)) ||
+            (('T' != type) && ('t' != type)))
+        {
+            continue;
+        }
+        if (n_syms == room)
+        {
+            room = room ? room * 2 : 256;
+            syms = realloc(syms, room * sizeof(sym_t));
+        }
+        syms[n_syms].addr   = (uint32_t)addr;
+        syms[n_syms++].name = strdup(name);
+    }
+    fclose(f);
+    qsort(syms, n_syms, sizeof(sym_t), sym_cmp);
+}
+
+static const char *
+sym_name( uint32_t addr )
+{
+    sym_t	key;
+    sym_t	*s;
+
+    if (0 == n_syms)
+    {
+        return (NULL);
+    }
+    key.addr = addr;
+    s = bsearch(&key, syms, n_syms, sizeof(sym_t), sym_cmp);
+    return (s ? s->name : NULL);
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	emit, begin, end
+ *
+ *  DESCRIPTION:	write one trace event; instants are scoped to the
+ *					thread. A slice is only ended if
+ *					it's the one open on the core, so that records
+ *					lost from the ring don't unbalance the output.
+ *
+ *******************************************************************/
+
+static void
+emit( const char *ph, const char *cat, const char *name, double us, uint8_t core,
+      const char *args )
+{
+    printf("%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%s\",%s\"ts\":%.3f,"
+           "\"pid\":1,\"tid\":%u%s%s}",
+           first ? "" : ",", name, cat, ph, ('i' == ph[0]) ? "\"s\":\"t\"," : "", us, core,
+           args ? "," : "", args ? args : "");
+    first = 0;
+}
+
+static void
+begin( uint8_t ev, const char *cat, const char *name, double us, uint8_t core,
+       const char *args )
+{
+    if (depth[core] < MAX_DEPTH)
+    {
+        open_ev[core][depth[core]++] = ev;
+        emit("B", cat, name, us, core, args);
+    }
+}
+
+static void
+end( uint8_t ev, const char *cat, double us, uint8_t core )
+{
+    if (depth[core] && (open_ev[core][depth[core] - 1] == ev))
+    {
+        depth[core]--;
+        emit("E", cat, "", us, core, NULL);
+    }
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	record
+ *
+ *  DESCRIPTION:	turn one trace record into trace events
+ *
+ *  INPUT:			the record; its time in microseconds
+ *
+ *  OUTPUT:			none
+ *
+ *******************************************************************/
+
+static void
+record( const os_trace_rec_t *r, double us )
+{
+    char		name[480];
+    char		args[96];
+    const char	*sym = sym_name(r->obj);
+    uint8_t		core = r->core;
+
+    if (core >= MAX_CORES)
+    {
+        return;
+    }
+    if (0 == (cores_seen & (1UL << core)))
+    {
+        cores_seen |= 1UL << core;
+        printf("%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+               "\"args\":{\"name\":\"core %u\"}}", first ? "" : ",", core, core);
+        first = 0;
+    }
+    if (OS_TRACE_NO_TASK == r->task)
+    {
+        snprintf(args, sizeof(args), "\"args\":{\"obj\":\"0x%08x\"}", r->obj);
+    }
+    else
+    {
+        snprintf(args, sizeof(args), "\"args\":{\"task\":%u,\"obj\":\"0x%08x\"}",
+                 r->task, r->obj);
+    }
+    switch (r->event)
+    {
+        case TR_DISPATCH:
+            if (sym)
+            {
+                snprintf(name, sizeof(name), "%s", sym);
+            }
+            else
+            {
+                snprintf(name, sizeof(name), "task %u", r->task);
+            }
+            begin(TR_DISPATCH, "task", name, us, core, args);
+            break;
+        case TR_RETURN:
+            end(TR_DISPATCH, "task", us, core);
+            break;
+        case TR_HOOK_ENTER:
+            if (sym)
+            {
+                snprintf(name, sizeof(name), "%s", sym);
+            }
+            else
+            {
+                snprintf(name, sizeof(name), "hook 0x%08x", r->obj);
+            }
+            begin(TR_HOOK_ENTER, "hook", name, us, core, args);
+            break;
+        case TR_HOOK_EXIT:
+            end(TR_HOOK_ENTER, "hook", us, core);
+            break;
+        case TR_SLEEP:
+            snprintf(args, sizeof(args), "\"args\":{\"ticks\":%u}", r->obj);
+            begin(TR_SLEEP, "idle", "sleep", us, core, args);
+            break;
+        case TR_WAKE:
+            end(TR_SLEEP, "idle", us, core);
+            break;
+        case TR_BOOT:
+            printf("%s\n{\"name\":\"reset\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,"
+                   "\"pid\":1,\"tid\":%u}", first ? "" : ",", us, core);
+            first = 0;
+            break;
+        default:
+            if (r->event < sizeof(ev_name) / sizeof(ev_name[0]))
+            {
+                if (OS_TRACE_NO_TASK == r->task)
+                {
+                    snprintf(name, sizeof(name), "%s", ev_name[r->event]);
+                }
+                else
+                {
+                    snprintf(name, sizeof(name), "%s %u", ev_name[r->event], r->task);
+                }
+                emit("i", "kernel", name, us, core, args);
+            }
+            break;
+    }
+}
+
+/*
+ *********************************************************************
+ *
+ *  ROUTINE NAME:	main
+ *
+ *  DESCRIPTION:	read the dumps and write the JSON
+ *
+ *  INPUT:			command line
+ *
+ *  OUTPUT:			exit status
+ *
+ *******************************************************************/
+
+int
+main( int argc, char **argv )
+{
+    FILE			*in = stdin;
+    os_trace_hdr_t	hdr;
+    os_trace_rec_t	rec;
+    uint8_t			raw[256];
+    uint64_t		cycles = 0;
+    uint32_t		stamp  = 0;
+    uint32_t		delta;
+    uint32_t		i;
+    uint32_t		dumps  = 0;
+    uint32_t		core;
+    int				started = 0;
+    int				opt;
+
+    while (-1 != (opt = getopt(argc, argv, "m:")))
+    {
+        switch (opt)
+        {
+            case 'm': load_syms(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-m nm_map] [trace.bin]\n", argv[0]);
+                return (1);
+        }
+    }
+    if ((optind < argc) && (NULL == (in = fopen(argv[optind], "rb"))))
+    {
+        perror(argv[optind]);
+        return (1);
+    }
+    printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    while (1 == fread(&hdr, sizeof(hdr), 1, in))
+    {
+        if ((OS_TRACE_MAGIC != hdr.magic) || (OS_TRACE_VERSION != hdr.version) ||
+            (hdr.rec_size < REC_MIN) || (hdr.rec_size > sizeof(raw)) || (0 == hdr.cycle_hz))
+        {
+            fprintf(stderr, "dump %u: not a version %u little endian trace\n",
+                    dumps, OS_TRACE_VERSION);
+            return (1);
+        }
+        if (hdr.lost)
+        {
+            printf("%s\n{\"name\":\"lost %u\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,"
+                   "\"pid\":1,\"tid\":0}", first ? "" : ",", hdr.lost, last_us);
+            first = 0;
+        }
+        for (i = 0; i < hdr.count; i++)
+        {
+            if (1 != fread(raw, hdr.rec_size, 1, in))
+            {
+                fprintf(stderr, "dump %u: cut short at record %u\n", dumps, i);
+                hdr.count = 0;
+                break;
+            }
+            memcpy(&rec, raw, sizeof(rec));
+            /*
+             * records from other cores, or an ISR, may step back a little
+             */
+            delta = rec.stamp - stamp;
+            if (!started || (TR_BOOT == rec.event))
+            {
+                /*
+                 * the counter restarts with the target
+                 */
+                started = 1;
+            }
+            else if (delta & 0x80000000UL)
+            {
+                cycles -= (uint32_t)(0UL - delta);
+            }
+            else
+            {
+                cycles += delta;
+            }
+            stamp   = rec.stamp;
+            last_us = (double)cycles * 1e6 / (double)hdr.cycle_hz;
+            record(&rec, last_us);
+        }
+        dumps++;
+    }
+    /*
+     * close what the last dump left open
+     */
+    for (core = 0; core < MAX_CORES; core++)
+    {
+        while (depth[core])
+        {
+            end(open_ev[core][depth[core] - 1], "", last_us, (uint8_t)core);
+        }
+    }
+    printf("\n]}\n");
+    return (0);
+}
+
+/*
+ *  END OF trace2json.c
+ *
+ *******************************************************************/